@@ -0,0 +1,58 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Bench {
+    /**
+    * allocations returns the number of calls made to the global operator new
+    * since the benchmark binary started.
+    */
+    uint64_t allocations();
+
+    /**
+    * live_bytes returns the number of bytes currently held by memory obtained
+    * from the global operator new.
+    */
+    int64_t live_bytes();
+
+    /**
+    * report prints a single benchmark result in a form which is easy to grep
+    * out of the gtest output.
+    */
+    void report(const std::string& name, double value, const std::string& unit);
+
+    /**
+    * Stopwatch measures the wall time of a benchmarked section.
+    */
+    class Stopwatch {
+    public:
+        Stopwatch() : begin(std::chrono::steady_clock::now()) {}
+
+        void restart() {
+            begin = std::chrono::steady_clock::now();
+        }
+
+        double elapsed_ns() const {
+            return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - begin).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point begin;
+    };
+}  // namespace Bench
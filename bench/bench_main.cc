@@ -0,0 +1,67 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include <malloc.h>
+
+#include "gtest/gtest.h"
+
+static std::atomic<uint64_t> allocation_count{0};
+static std::atomic<int64_t> live_byte_count{0};
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        live_byte_count.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        live_byte_count.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    }
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+uint64_t Bench::allocations() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+int64_t Bench::live_bytes() {
+    return live_byte_count.load(std::memory_order_relaxed);
+}
+
+void Bench::report(const std::string& name, double value, const std::string& unit) {
+    std::cout << "[ BENCH    ] " << std::left << std::setw(56) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+              << value << " " << unit << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include "bench.h"
+
+using Plugin::CollectContext;
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int source_count = 16;
+static const int call_count = 3;
+
+/**
+* StallingCollector reads each source in 2ms, except "source0", which
+* stalls for 2s. Reads give up once the context expires.
+*/
+class StallingCollector final : public Plugin::CollectorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        return collect_metrics_until(metrics, CollectContext());
+    }
+
+    std::vector<Metric> collect_metrics_until(std::vector<Metric> &metrics,
+                                              const CollectContext& context) {
+        std::vector<Metric> result;
+        for (auto& met : metrics) {
+            const bool stalled = met.ns_view()[2].value() == "source0";
+            const auto until = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(stalled ? 2000 : 2);
+            while (std::chrono::steady_clock::now() < until && !context.expired()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (context.expired()) {
+                break;
+            }
+            met.set_data((int64_t)42);
+            result.push_back(std::move(met));
+        }
+        return result;
+    }
+};
+
+/**
+* Collects one metric from each of 16 sources, sharded on 4 threads, one
+* source stalling for 2s, with a call deadline of 5s and of 500ms. Reports
+* the latency of a CollectMetrics call and the metrics replied.
+*/
+TEST(CollectDeadlineBench, StalledSource) {
+    StallingCollector plugin;
+    Meta meta(Plugin::Collector, "bench", 1);
+    meta.collect_threads = 4;
+    CollectorImpl impl(&plugin, &meta);
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&impl);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    auto stub = rpc::Collector::NewStub(grpc::CreateChannel(
+        "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+    rpc::MetricsArg arg;
+    for (int s = 0; s < source_count; s++) {
+        Metric met(Namespace({"intel", "bench", "source" + std::to_string(s), "reads"}), "", "");
+        *arg.add_metrics() = *met.get_rpc_metric_ptr();
+    }
+
+    for (int timeout_ms : {5000, 500}) {
+        int replied = 0;
+        Bench::Stopwatch watch;
+        for (int i = 0; i < call_count; i++) {
+            grpc::ClientContext context;
+            context.set_deadline(std::chrono::system_clock::now() +
+                                 std::chrono::milliseconds(timeout_ms));
+            rpc::MetricsReply reply;
+            EXPECT_TRUE(stub->CollectMetrics(&context, arg, &reply).ok());
+            replied += reply.metrics_size();
+        }
+        const std::string name = std::to_string(timeout_ms) + "ms deadline";
+        Bench::report(name + " latency", watch.elapsed_ns() / call_count / 1e6, "ms");
+        Bench::report(name + " metrics replied", replied / call_count, "");
+    }
+    server->Shutdown();
+}
@@ -0,0 +1,175 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/compiled_config_policy.h>
+#include <snap/config.h>
+#include <snap/config_state_cache.h>
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::CompiledConfigPolicy;
+using Plugin::Config;
+using Plugin::ConfigKey;
+using Plugin::ConfigPolicy;
+using Plugin::ConfigStateCache;
+
+static const int key_count = 40;
+static const int read_count = 200000;
+
+template<class F>
+static void measure(const std::string& name, F read) {
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    int64_t sum = 0;
+    for (int i = 0; i < read_count; i++) {
+        sum += read();
+    }
+    const double ns = watch.elapsed_ns();
+    Bench::report(name + " reads/s", read_count / ns * 1e9, "");
+    Bench::report(name + " allocs/read",
+                  double(Bench::allocations() - allocs) / read_count, "");
+    EXPECT_NE(0, sum);
+}
+
+/**
+* Reads an int and a string out of a config of 40 keys of each type, the
+* way a publisher does on every Publish call.
+*/
+TEST(ConfigBench, Reads) {
+    ConfigPolicy policy;
+    rpc::ConfigMap config_map;
+    Config config(config_map);
+    for (int i = 0; i < key_count; i++) {
+        const std::string suffix = std::to_string(i);
+        policy.add_rule({""}, Plugin::IntRule{"batch_size_" + suffix, {i, false}});
+        policy.add_rule({""}, Plugin::StringRule{"output_path_" + suffix, {"/tmp", false}});
+        config.set_int("batch_size_" + suffix, i + 1);
+        config.set_string("output_path_" + suffix, "/var/log/snap/" + suffix);
+    }
+
+    measure("map copy (previous get_int)", [&] {
+        auto int_map = config_map.intmap();
+        return int_map.at("batch_size_7");
+    });
+    measure("get_int", [&] {
+        return config.get_int("batch_size_7");
+    });
+    measure("get_string", [&] {
+        return config.get_string("output_path_7").size();
+    });
+
+    const ConfigKey<int> batch_size(policy, "batch_size_7");
+    const ConfigKey<std::string> output_path(policy, "output_path_7");
+    measure("ConfigKey<int>", [&] {
+        return config.get(batch_size);
+    });
+    measure("ConfigKey<std::string>", [&] {
+        return config.get(output_path).size();
+    });
+}
+
+/**
+* Gets the tags the graffiti processor adds, by splitting the "tags" string
+* on every call, then through a ConfigStateCache, from a task config of 8
+* keys and from one of 80.
+*/
+TEST(ConfigBench, StateCache) {
+    typedef std::vector<std::pair<std::string, std::string>> Tags;
+    rpc::ConfigMap small_map, large_map;
+    Config small(small_map), large(large_map);
+    for (int i = 0; i < key_count; i++) {
+        const std::string suffix = std::to_string(i);
+        large.set_int("batch_size_" + suffix, i + 1);
+        large.set_string("output_path_" + suffix, "/var/log/snap/" + suffix);
+        if (i < 4) {
+            small.set_int("batch_size_" + suffix, i + 1);
+            small.set_string("output_path_" + suffix, "/var/log/snap/" + suffix);
+        }
+    }
+    small.set_string("tags", "production,eu-west,rack-12,cpu-bound,canary");
+    large.set_string("tags", "production,eu-west,rack-12,cpu-bound,canary");
+
+    auto parse = [](const Config& cfg) {
+        Tags tags;
+        std::stringstream stream(cfg.get_string("tags"));
+        std::string tag;
+        while (std::getline(stream, tag, ',')) {
+            tags.emplace_back(tag, "present");
+        }
+        return tags;
+    };
+
+    measure("parse tags per call", [&] {
+        return parse(small).size();
+    });
+    for (const auto& sized : {std::make_pair("9 keys", &small), std::make_pair("81 keys", &large)}) {
+        const Config& config = *sized.second;
+        measure(std::string("fingerprint, ") + sized.first, [&] {
+            return config.fingerprint();
+        });
+        ConfigStateCache<Tags> cache(16);
+        measure(std::string("ConfigStateCache, ") + sized.first, [&] {
+            return cache.get(config, parse)->size();
+        });
+    }
+}
+
+/**
+* Validates and default-fills a task config of 20 keys against a policy of
+* 80 rules, through Config::apply_defaults (which checks neither required
+* keys nor ranges), then through a CompiledConfigPolicy without and with its
+* outcome cache. Every run starts from a copy of the task config, which is
+* measured alone first.
+*/
+TEST(ConfigBench, Policy) {
+    ConfigPolicy policy;
+    rpc::ConfigMap task_map;
+    Config task(task_map);
+    for (int i = 0; i < key_count; i++) {
+        const std::string suffix = std::to_string(i);
+        policy.add_rule({""}, Plugin::IntRule{"batch_size_" + suffix, {i, i % 4 == 0, 0, 1 << 20}});
+        policy.add_rule({""}, Plugin::StringRule{"output_path_" + suffix, {"/tmp", false}});
+        if (i % 4 == 0) {
+            task.set_int("batch_size_" + suffix, i + 1);
+            task.set_string("output_path_" + suffix, "/var/log/snap/" + suffix);
+        }
+    }
+
+    measure("copy config", [&] {
+        rpc::ConfigMap map(task_map);
+        return map.intmap_size();
+    });
+    measure("apply_defaults", [&] {
+        rpc::ConfigMap map(task_map);
+        Config(map).apply_defaults(policy);
+        return map.intmap_size();
+    });
+    CompiledConfigPolicy uncached(policy, 0);
+    measure("CompiledConfigPolicy, uncached", [&] {
+        rpc::ConfigMap map(task_map);
+        uncached.apply(map);
+        return map.intmap_size();
+    });
+    CompiledConfigPolicy cached(policy);
+    measure("CompiledConfigPolicy, cached", [&] {
+        rpc::ConfigMap map(task_map);
+        cached.apply(map);
+        return map.intmap_size();
+    });
+}
@@ -0,0 +1,80 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+
+static const int metric_count = 50000;
+static const int rounds = 20;
+
+template<class F>
+static double measure(const std::string& name, F sum) {
+    double total = 0;
+    Bench::Stopwatch watch;
+    for (int i = 0; i < rounds; i++) {
+        total += sum();
+    }
+    Bench::report(name + " time/metric",
+                  watch.elapsed_ns() / (metric_count * rounds), "ns");
+    return total;
+}
+
+/**
+* Sums a batch of numeric metrics of mixed types, the way a publisher
+* aggregating a cycle would.
+*/
+TEST(MetricDataBench, SumMixedBatch) {
+    std::vector<Metric> metrics(metric_count);
+    for (int i = 0; i < metric_count; i++) {
+        switch (i % 4) {
+            case 0: metrics[i].set_data((int64_t)i); break;
+            case 1: metrics[i].set_data((double)i); break;
+            case 2: metrics[i].set_data((uint32_t)i); break;
+            case 3: metrics[i].set_data((float)i); break;
+        }
+    }
+
+    double by_switch = measure("switch on data_type", [&] {
+        double sum = 0;
+        for (const Metric& met : metrics) {
+            switch (met.data_type()) {
+                case Metric::Int32: sum += met.get_int_data(); break;
+                case Metric::Int64: sum += met.get_int64_data(); break;
+                case Metric::Uint32: sum += met.get_uint32_data(); break;
+                case Metric::Uint64: sum += met.get_uint64_data(); break;
+                case Metric::Float32: sum += met.get_float32_data(); break;
+                case Metric::Float64: sum += met.get_float64_data(); break;
+                default: break;
+            }
+        }
+        return sum;
+    });
+    std::vector<double> values;
+    double by_extract = measure("extract_data", [&] {
+        values.clear();
+        Metric::extract_data(metrics, values);
+        double sum = 0;
+        for (double v : values) {
+            sum += v;
+        }
+        return sum;
+    });
+    EXPECT_EQ(by_switch, by_extract);
+}
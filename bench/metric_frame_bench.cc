@@ -0,0 +1,161 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/config.h>
+#include <snap/metric.h>
+#include <snap/metric_frame.h>
+#include <snap/metric_prototype.h>
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::MetricFrame;
+using Plugin::MetricFrames;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int series_count = 50000;
+
+static MetricPrototype disk_prototype() {
+    return MetricPrototype(Namespace({"intel", "disk"}).add_dynamic_element("disk", "disk id")
+                                                       .add_static_element("ops"),
+                           "ops/s", "operations per second");
+}
+
+/**
+* DiskCollector samples series_count per-disk counters, either as individual
+* metrics or as a single frame.
+*/
+class DiskCollector final : public Plugin::CollectorInterface {
+public:
+    explicit DiskCollector(bool use_frame) : use_frame(use_frame) {
+        for (int i = 0; i < series_count; i++) {
+            disks.push_back("disk" + std::to_string(i));
+        }
+    }
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::vector<Metric> result;
+        if (use_frame) {
+            return result;
+        }
+        result.reserve(series_count);
+        for (int i = 0; i < series_count; i++) {
+            result.push_back(prototype.make({disks[i]}));
+            result.back().set_data((double)i);
+        }
+        Metric::set_timestamps(result);
+        return result;
+    }
+
+    MetricFrames collect_frames(const std::vector<Metric> &metrics) {
+        MetricFrames frames;
+        if (!use_frame) {
+            return frames;
+        }
+        std::unique_ptr<MetricFrame<double>> frame(new MetricFrame<double>(prototype));
+        frame->reserve(series_count);
+        for (int i = 0; i < series_count; i++) {
+            frame->add({frame->encode(0, disks[i])}, (double)i);
+        }
+        frame->set_timestamps();
+        frames.push_back(std::move(frame));
+        return frames;
+    }
+
+private:
+    bool use_frame;
+    std::vector<std::string> disks;
+    MetricPrototype prototype = disk_prototype();
+};
+
+TEST(MetricFrameBench, CollectCycle) {
+    for (bool use_frame : {false, true}) {
+        DiskCollector plugin(use_frame);
+        CollectorImpl collector(&plugin);
+        rpc::MetricsArg args;
+        uint64_t allocs = Bench::allocations();
+        Bench::Stopwatch watch;
+        {
+            rpc::MetricsReply resp;
+            collector.CollectMetrics(nullptr, &args, &resp);
+            EXPECT_EQ(series_count, resp.metrics_size());
+        }
+        std::string name = use_frame ? "frame" : "metrics";
+        Bench::report(name + " CollectMetrics time/metric",
+                      watch.elapsed_ns() / series_count, "ns");
+        Bench::report(name + " CollectMetrics allocs/metric",
+                      double(Bench::allocations() - allocs) / series_count, "");
+    }
+}
+
+/**
+* Holds one cycle of samples and scales every value, the way a processor
+* converting units would.
+*/
+TEST(MetricFrameBench, TransformAndWorkingSet) {
+    MetricPrototype prototype = disk_prototype();
+    std::vector<std::string> disks;
+    for (int i = 0; i < series_count; i++) {
+        disks.push_back("disk" + std::to_string(i));
+    }
+
+    {
+        int64_t before = Bench::live_bytes();
+        std::vector<Metric> metrics;
+        metrics.reserve(series_count);
+        for (int i = 0; i < series_count; i++) {
+            metrics.push_back(prototype.make({disks[i]}));
+            metrics.back().set_data((double)i);
+        }
+        Metric::set_timestamps(metrics);
+        Bench::report("metrics bytes/metric",
+                      double(Bench::live_bytes() - before) / series_count, "B");
+        Bench::Stopwatch watch;
+        for (Metric& met : metrics) {
+            met.set_data(met.get<double>() * 100);
+        }
+        Bench::report("metrics scale time/metric", watch.elapsed_ns() / series_count, "ns");
+    }
+    {
+        int64_t before = Bench::live_bytes();
+        MetricFrame<double> frame(prototype);
+        frame.reserve(series_count);
+        for (int i = 0; i < series_count; i++) {
+            frame.add({frame.encode(0, disks[i])}, (double)i);
+        }
+        frame.set_timestamps();
+        Bench::report("frame bytes/metric",
+                      double(Bench::live_bytes() - before) / series_count, "B");
+        Bench::Stopwatch watch;
+        double* values = frame.values_data();
+        for (size_t i = 0; i < frame.size(); i++) {
+            values[i] *= 100;
+        }
+        Bench::report("frame scale time/metric", watch.elapsed_ns() / series_count, "ns");
+    }
+}
@@ -0,0 +1,132 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/config.h>
+#include <snap/metric.h>
+#include <snap/metric_pool.h>
+#include <snap/metric_prototype.h>
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::MetricPool;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int metric_count = 20000;
+static const int cycles = 5;
+
+/**
+* PoolCollector produces metric_count metrics of a dynamic metric type each
+* cycle, either stamped out of the prototype or acquired from a pool.
+*/
+class PoolCollector final : public Plugin::CollectorInterface {
+public:
+    explicit PoolCollector(bool pooled) : pooled(pooled) {
+        for (int i = 0; i < metric_count; i++) {
+            hosts.push_back("host" + std::to_string(i));
+        }
+    }
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::vector<Metric> result;
+        result.reserve(metric_count);
+        for (int i = 0; i < metric_count; i++) {
+            result.push_back(pooled ? pool.acquire(prototype, {hosts[i]})
+                                    : prototype.make({hosts[i]}));
+            result.back().set_data((int64_t)i);
+        }
+        return result;
+    }
+
+private:
+    bool pooled;
+    std::vector<std::string> hosts;
+    MetricPool pool;
+    MetricPrototype prototype{
+        Namespace({"intel", "cpp", "bench"}).add_dynamic_element("host", "host name")
+                                            .add_static_element("load"),
+        "load", "a metric used by the pool benchmark"};
+};
+
+TEST(MetricPoolBench, CollectCycles) {
+    for (bool pooled : {false, true}) {
+        PoolCollector plugin(pooled);
+        CollectorImpl collector(&plugin);
+        rpc::MetricsArg args;
+        {
+            // the first cycle fills the pool.
+            rpc::MetricsReply resp;
+            collector.CollectMetrics(nullptr, &args, &resp);
+        }
+
+        std::string name = std::string("collect cycle, ") + (pooled ? "pooled" : "prototype");
+        uint64_t allocs = Bench::allocations();
+        Bench::Stopwatch watch;
+        for (int c = 0; c < cycles; c++) {
+            rpc::MetricsReply resp;
+            collector.CollectMetrics(nullptr, &args, &resp);
+            EXPECT_EQ(metric_count, resp.metrics_size());
+        }
+        double elapsed = watch.elapsed_ns();
+        allocs = Bench::allocations() - allocs;
+        Bench::report(name + " allocations/metric", double(allocs) / (metric_count * cycles), "allocs");
+        Bench::report(name + " time/metric", elapsed / (metric_count * cycles), "ns");
+    }
+}
+
+/**
+* The stream collector keeps one MetricsReply and clears it after each send,
+* so with pooled metrics neither side of the copy allocates.
+*/
+TEST(MetricPoolBench, StreamReplyCycles) {
+    for (bool pooled : {false, true}) {
+        PoolCollector plugin(pooled);
+        std::vector<Metric> requested;
+        rpc::MetricsReply reply;
+        for (int c = 0; c < 2; c++) {
+            for (Metric& met : plugin.collect_metrics(requested)) {
+                met.move_into(reply.mutable_metrics());
+            }
+            reply.clear_metrics();
+        }
+
+        std::string name = std::string("stream cycle, ") + (pooled ? "pooled" : "prototype");
+        uint64_t allocs = Bench::allocations();
+        Bench::Stopwatch watch;
+        for (int c = 0; c < cycles; c++) {
+            for (Metric& met : plugin.collect_metrics(requested)) {
+                met.move_into(reply.mutable_metrics());
+            }
+            EXPECT_EQ(metric_count, reply.metrics_size());
+            reply.clear_metrics();
+        }
+        double elapsed = watch.elapsed_ns();
+        allocs = Bench::allocations() - allocs;
+        Bench::report(name + " allocations/metric", double(allocs) / (metric_count * cycles), "allocs");
+        Bench::report(name + " time/metric", elapsed / (metric_count * cycles), "ns");
+    }
+}
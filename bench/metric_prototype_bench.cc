@@ -0,0 +1,55 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include <snap/metric_prototype.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+
+static const int metric_count = 20000;
+
+template<class F>
+static void measure(const std::string& name, F make) {
+    std::vector<Metric> metrics;
+    metrics.reserve(metric_count);
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    for (int i = 0; i < metric_count; i++) {
+        metrics.push_back(make());
+    }
+    double elapsed = watch.elapsed_ns();
+    allocs = Bench::allocations() - allocs;
+    Bench::report(name + " allocations/metric", double(allocs) / metric_count, "allocs");
+    Bench::report(name + " time/metric", elapsed / metric_count, "ns");
+}
+
+TEST(MetricPrototypeBench, Make) {
+    measure("Metric(Namespace, unit, description)", [] {
+        return Metric(Namespace({"intel", "cpp", "bench", "prototype", "int64"}),
+                      "bytes", "a metric used by the prototype benchmark");
+    });
+
+    MetricPrototype prototype(Namespace({"intel", "cpp", "bench", "prototype", "int64"}),
+                              "bytes", "a metric used by the prototype benchmark");
+    measure("MetricPrototype::make()", [&] {
+        return prototype.make();
+    });
+}
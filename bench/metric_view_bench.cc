@@ -0,0 +1,93 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include <snap/metric_view.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+using Plugin::MetricBatchView;
+using Plugin::MetricView;
+using Plugin::Namespace;
+
+static const int metric_count = 10000;
+static const int rounds = 10;
+
+template<class F>
+static void measure(const std::string& name, F run) {
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    for (int i = 0; i < rounds; i++) {
+        run();
+    }
+    Bench::report(name + " time/metric", watch.elapsed_ns() / (rounds * metric_count), "ns");
+    Bench::report(name + " allocs/metric",
+                  double(Bench::allocations() - allocs) / (rounds * metric_count), "");
+}
+
+/**
+* Reads a serialized Publish request of 10k metrics, each with a 5 element
+* namespace, 3 tags and a double, the way the log publisher does: once
+* through a parsed rpc::PubProcArg wrapped in Metrics, once through
+* MetricViews over the buffer.
+*/
+TEST(MetricViewBench, ReadPublishRequest) {
+    rpc::PubProcArg args;
+    for (int i = 0; i < metric_count; i++) {
+        Namespace ns({"intel", "procfs", "cpu", std::to_string(i % 64), "utilization"});
+        Metric met(ns, "percent", "cpu utilization");
+        met.add_tags({{"host", "host0"}, {"rack", "r1"}, {"dc", "eu"}});
+        met.set_data(i * 0.5);
+        met.set_timestamp();
+        *args.add_metrics() = *met.get_rpc_metric_ptr();
+    }
+    const std::string wire = args.SerializeAsString();
+
+    size_t seen = 0;
+    double sum = 0;
+    measure("PubProcArg + Metric", [&] {
+        rpc::PubProcArg req;
+        req.ParseFromString(wire);
+        std::vector<Metric> metrics;
+        metrics.reserve(req.metrics_size());
+        for (int i = 0; i < req.metrics_size(); i++) {
+            metrics.emplace_back(req.mutable_metrics(i));
+        }
+        for (const Metric& met : metrics) {
+            for (const auto& element : met.ns_view()) {
+                seen += element.value().size();
+            }
+            seen += met.tag_view().get("dc").size();
+            sum += met.get<double>();
+        }
+    });
+
+    MetricBatchView batch;
+    measure("MetricBatchView", [&] {
+        batch.parse(wire);
+        for (const MetricView& met : batch.metrics()) {
+            for (unsigned int i = 0; i < met.ns_size(); i++) {
+                seen += met.ns_element(i).value.size();
+            }
+            seen += met.tag_value("dc").size();
+            sum += met.get<double>();
+        }
+    });
+    EXPECT_LT(0, seen);
+    EXPECT_LT(0, sum);
+}
@@ -0,0 +1,68 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+
+static const int metric_count = 20000;
+static const int rounds = 10;
+
+/**
+* Each round wraps the request metrics anew, the same way the proxies do on
+* every call, so the memoized namespace of ns() always starts out empty.
+*/
+template<class F>
+static void measure(const std::string& name,
+                    google::protobuf::RepeatedPtrField<rpc::Metric>& rpc_mets,
+                    F read) {
+    size_t total = 0;
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    for (int r = 0; r < rounds; r++) {
+        for (rpc::Metric& rpc_met : rpc_mets) {
+            Metric met(&rpc_met);
+            total += read(met);
+        }
+    }
+    double elapsed = watch.elapsed_ns();
+    allocs = Bench::allocations() - allocs;
+    Bench::report(name + " allocations/metric",
+                  double(allocs) / (metric_count * rounds), "allocs");
+    Bench::report(name + " time/metric", elapsed / (metric_count * rounds), "ns");
+    EXPECT_EQ(size_t(rounds) * metric_count * 5, total);
+}
+
+TEST(NamespaceBench, ElementValue) {
+    google::protobuf::RepeatedPtrField<rpc::Metric> rpc_mets;
+    for (int i = 0; i < metric_count; i++) {
+        rpc::Metric* met = rpc_mets.Add();
+        for (auto& node : {"intel", "cpp", "mock", "rando"}) {
+            met->add_namespace_()->set_value(node);
+        }
+        met->add_namespace_()->set_value("int64");
+    }
+
+    measure("ns()[4].get_value()", rpc_mets, [](const Metric& met) {
+        return met.ns()[4].get_value().size();
+    });
+    measure("ns_view()[4].value()", rpc_mets, [](const Metric& met) {
+        return met.ns_view()[4].value().size();
+    });
+}
@@ -0,0 +1,111 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int source_count = 32;
+static const int metrics_per_source = 4;
+static const int call_count = 5;
+
+/**
+* SlowCollector spends `per_source` on each source of the metrics it is
+* given, either waiting as for a device or socket read, or spinning as for
+* parsing.
+*/
+class SlowCollector final : public Plugin::CollectorInterface {
+public:
+    SlowCollector(std::chrono::microseconds per_source, bool spin) :
+                  per_source(per_source), spin(spin) {}
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::string source;
+        for (auto& met : metrics) {
+            const std::string key = shard_key(met);
+            if (key != source) {
+                source = key;
+                read_source();
+            }
+            met.set_data((int64_t)42);
+        }
+        return metrics;
+    }
+
+private:
+    std::chrono::microseconds per_source;
+    bool spin;
+
+    void read_source() {
+        if (!spin) {
+            std::this_thread::sleep_for(per_source);
+            return;
+        }
+        const auto until = std::chrono::steady_clock::now() + per_source;
+        while (std::chrono::steady_clock::now() < until) {}
+    }
+};
+
+/**
+* Collects 4 metrics from each of 32 sources taking 1ms each, serially and
+* on pools of 1 to 16 threads, for sources waiting on I/O and for sources
+* busy on the CPU. Reports the latency of a CollectMetrics call.
+*/
+TEST(ParallelCollectBench, SlowSources) {
+    rpc::MetricsArg args;
+    for (int s = 0; s < source_count; s++) {
+        for (int m = 0; m < metrics_per_source; m++) {
+            Metric met(Namespace({"intel", "bench", "source" + std::to_string(s),
+                                  "metric" + std::to_string(m)}), "", "");
+            *args.add_metrics() = *met.get_rpc_metric_ptr();
+        }
+    }
+    Bench::report("cores", std::thread::hardware_concurrency(), "");
+
+    for (bool spin : {false, true}) {
+        SlowCollector plugin(std::chrono::microseconds(1000), spin);
+        for (int threads : {0, 1, 2, 4, 8, 16}) {
+            Meta meta(Plugin::Collector, "bench", 1);
+            meta.collect_threads = threads;
+            CollectorImpl collector(&plugin, &meta);
+            Bench::Stopwatch watch;
+            for (int i = 0; i < call_count; i++) {
+                rpc::MetricsArg call_args(args);
+                rpc::MetricsReply resp;
+                collector.CollectMetrics(nullptr, &call_args, &resp);
+                EXPECT_EQ(source_count * metrics_per_source, resp.metrics_size());
+            }
+            const std::string name = std::string(spin ? "cpu-bound" : "io-bound") +
+                (threads ? ", " + std::to_string(threads) + " threads" : ", serial");
+            Bench::report(name + " latency", watch.elapsed_ns() / call_count / 1e6, "ms");
+        }
+    }
+}
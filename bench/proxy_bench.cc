@@ -0,0 +1,153 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/config.h>
+#include <snap/metric.h>
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include <snap/proxy/processor_proxy.h>
+#include <snap/proxy/publisher_proxy.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+using Plugin::Proxy::ProcessorImpl;
+using Plugin::Proxy::PublisherImpl;
+
+static const int metric_count = 20000;
+
+class BenchCollector final : public Plugin::CollectorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::vector<Metric> result;
+        result.reserve(metrics.size());
+        for (auto& met : metrics) {
+            met.set_data((int64_t)42);
+            result.push_back(met);
+        }
+        return result;
+    }
+};
+
+class BenchProcessor final : public Plugin::ProcessorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    void process_metrics(std::vector<Metric> &metrics, const Config& config) {
+        for (auto& met : metrics) {
+            met.add_tag({"processed", "true"});
+        }
+    }
+};
+
+class BenchPublisher final : public Plugin::PublisherInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    void publish_metrics(std::vector<Metric> &metrics, const Config& config) {
+        for (auto& met : metrics) {
+            sum += met.get_int64_data();
+        }
+    }
+
+    int64_t sum = 0;
+};
+
+template<class Arg>
+static void fill_request(Arg& arg) {
+    for (int i = 0; i < metric_count; i++) {
+        rpc::Metric* met = arg.add_metrics();
+        for (auto& node : {"intel", "cpp", "bench", "proxy"}) {
+            met->add_namespace_()->set_value(node);
+        }
+        met->add_namespace_()->set_value(std::to_string(i));
+        met->set_unit("unit");
+        met->set_description("a metric used by the proxy benchmarks");
+        (*met->mutable_tags())["host"] = "localhost";
+        met->set_int64_data(i);
+    }
+}
+
+template<class F>
+static void measure(const std::string& name, F call) {
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    call();
+    double elapsed = watch.elapsed_ns();
+    allocs = Bench::allocations() - allocs;
+    Bench::report(name + " allocations/metric", double(allocs) / metric_count, "allocs");
+    Bench::report(name + " time/metric", elapsed / metric_count, "ns");
+}
+
+TEST(ArenaBench, CollectMetrics) {
+    BenchCollector plugin;
+    rpc::MetricsArg args;
+    fill_request(args);
+
+    for (bool arena : {false, true}) {
+        Meta meta(Plugin::Collector, "bench", 1);
+        meta.arena_allocation = arena;
+        CollectorImpl collector(&plugin, &meta);
+        rpc::MetricsReply resp;
+        measure(std::string("CollectMetrics ") + (arena ? "arena" : "heap"), [&] {
+            collector.CollectMetrics(nullptr, &args, &resp);
+        });
+        EXPECT_EQ(metric_count, resp.metrics_size());
+    }
+}
+
+TEST(ArenaBench, Process) {
+    BenchProcessor plugin;
+    rpc::PubProcArg args;
+    fill_request(args);
+
+    for (bool arena : {false, true}) {
+        Meta meta(Plugin::Processor, "bench", 1);
+        meta.arena_allocation = arena;
+        ProcessorImpl processor(&plugin, &meta);
+        rpc::MetricsReply resp;
+        measure(std::string("Process ") + (arena ? "arena" : "heap"), [&] {
+            processor.Process(nullptr, &args, &resp);
+        });
+        EXPECT_EQ(metric_count, resp.metrics_size());
+    }
+}
+
+TEST(ArenaBench, Publish) {
+    BenchPublisher plugin;
+    rpc::PubProcArg args;
+    fill_request(args);
+
+    for (bool arena : {false, true}) {
+        Meta meta(Plugin::Publisher, "bench", 1);
+        meta.arena_allocation = arena;
+        PublisherImpl publisher(&plugin, &meta);
+        rpc::ErrReply resp;
+        measure(std::string("Publish ") + (arena ? "arena" : "heap"), [&] {
+            publisher.Publish(nullptr, &args, &resp);
+        });
+    }
+}
@@ -0,0 +1,79 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include <snap/metric_frame.h>
+#include <snap/metric_prototype.h>
+#include <snap/reply_encoder.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+using Plugin::MetricFrame;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::ReplyEncoder;
+
+static const int series_count = 50000;
+static const int cycles = 5;
+
+template<class F>
+static void measure(const std::string& name, F cycle) {
+    cycle();  // warm up
+    uint64_t allocs = Bench::allocations();
+    Bench::Stopwatch watch;
+    for (int i = 0; i < cycles; i++) {
+        cycle();
+    }
+    Bench::report(name + " time/metric",
+                  watch.elapsed_ns() / (series_count * cycles), "ns");
+    Bench::report(name + " allocs/metric",
+                  double(Bench::allocations() - allocs) / (series_count * cycles), "");
+}
+
+/**
+* Serializes the reply of a collector sampling 50k per-disk counters, the
+* way the generated service does and with a ReplyEncoder.
+*/
+TEST(ReplyEncoderBench, SerializeReply) {
+    MetricPrototype prototype(Namespace({"intel", "disk"}).add_dynamic_element("disk", "disk id")
+                                                          .add_static_element("ops"),
+                              "ops/s", "operations per second");
+    MetricFrame<double> frame(prototype);
+    frame.reserve(series_count);
+    for (int i = 0; i < series_count; i++) {
+        frame.add({frame.encode(0, "disk" + std::to_string(i))}, i * 0.5);
+    }
+    frame.set_timestamps();
+
+    size_t serialized = 0;
+    size_t encoded = 0;
+    measure("MetricsReply + SerializeToString", [&] {
+        rpc::MetricsReply reply;
+        frame.append_to(reply.mutable_metrics());
+        std::string payload;
+        reply.SerializeToString(&payload);
+        serialized = payload.size();
+    });
+    ReplyEncoder encoder;
+    measure("ReplyEncoder", [&] {
+        std::string payload;
+        encoder.add(frame, &payload);
+        encoded = payload.size();
+    });
+    EXPECT_EQ(serialized, encoded);
+}
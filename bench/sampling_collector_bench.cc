@@ -0,0 +1,94 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/sampling_collector.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int metric_count = 100;
+static const int call_count = 50;
+
+/**
+* sample reads `metric_count` metrics from a source taking 5ms per read.
+*/
+static std::vector<Metric> sample() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::vector<Metric> metrics;
+    for (int m = 0; m < metric_count; m++) {
+        metrics.emplace_back(Namespace({"intel", "bench", "metric" + std::to_string(m)}), "", "");
+        metrics.back().set_data((int64_t)m);
+    }
+    return metrics;
+}
+
+class DirectCollector final : public Plugin::CollectorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        return sample();
+    }
+};
+
+class BackgroundCollector final : public Plugin::SamplingCollector {
+public:
+    BackgroundCollector() {
+        register_sampler(sample, std::chrono::milliseconds(10));
+    }
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+};
+
+/**
+* Collects 100 metrics from a source taking 5ms per read, on request and
+* from a SamplingCollector sampling every 10ms. Reports the latency of a
+* CollectMetrics call.
+*/
+TEST(SamplingCollectorBench, ExpensiveSource) {
+    rpc::MetricsArg args;
+    Metric pattern(Namespace({"intel", "bench"}).add_dynamic_element("metric"), "", "");
+    *args.add_metrics() = *pattern.get_rpc_metric_ptr();
+
+    DirectCollector direct;
+    BackgroundCollector background;
+    for (Plugin::CollectorInterface* plugin :
+         std::vector<Plugin::CollectorInterface*>{&direct, &background}) {
+        CollectorImpl collector(plugin);
+        Bench::Stopwatch watch;
+        for (int i = 0; i < call_count; i++) {
+            rpc::MetricsArg call_args(args);
+            rpc::MetricsReply resp;
+            collector.CollectMetrics(nullptr, &call_args, &resp);
+            EXPECT_EQ(metric_count, resp.metrics_size());
+        }
+        const std::string name = plugin == &direct ? "on request" : "from snapshot";
+        Bench::report(name + " latency", watch.elapsed_ns() / call_count / 1e3, "us");
+    }
+}
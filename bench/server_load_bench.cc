@@ -0,0 +1,160 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/async_server.h>
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include "snap/rpc/plugin.grpc.pb.h"
+
+#include "bench.h"
+
+using Plugin::AsyncServer;
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Proxy::CollectorImpl;
+
+static const int client_count = 16;
+static const int calls_per_client = 250;
+static const int metrics_per_call = 10;
+
+/**
+* LoadCollector sets the data of the requested metrics, after waiting for
+* `latency` as a collector reading a remote source would.
+*/
+class LoadCollector final : public Plugin::CollectorInterface {
+public:
+    explicit LoadCollector(std::chrono::microseconds latency) : latency(latency) {}
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        if (latency.count() > 0) {
+            std::this_thread::sleep_for(latency);
+        }
+        for (auto& met : metrics) {
+            met.set_data((int64_t)42);
+        }
+        return metrics;
+    }
+
+private:
+    std::chrono::microseconds latency;
+};
+
+/**
+* Calls CollectMetrics from `client_count` threads at once, and reports the
+* throughput and the median and 99th percentile latencies.
+*/
+static void load(const std::string& name, const std::shared_ptr<grpc::Channel>& channel) {
+    auto stub = rpc::Collector::NewStub(channel);
+    rpc::MetricsArg arg;
+    for (int i = 0; i < metrics_per_call; i++) {
+        rpc::Metric* met = arg.add_metrics();
+        for (auto& node : {"intel", "cpp", "bench", "load"}) {
+            met->add_namespace_()->set_value(node);
+        }
+        met->add_namespace_()->set_value(std::to_string(i));
+    }
+
+    std::vector<std::vector<double>> latencies(client_count);
+    std::vector<std::thread> clients;
+    Bench::Stopwatch watch;
+    for (int c = 0; c < client_count; c++) {
+        clients.emplace_back([&, c] {
+            for (int i = 0; i < calls_per_client; i++) {
+                Bench::Stopwatch call;
+                grpc::ClientContext context;
+                rpc::MetricsReply reply;
+                grpc::Status status = stub->CollectMetrics(&context, arg, &reply);
+                latencies[c].push_back(call.elapsed_ns());
+                EXPECT_TRUE(status.ok()) << status.error_message();
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    const double elapsed = watch.elapsed_ns();
+
+    std::vector<double> all;
+    for (const auto& client : latencies) {
+        all.insert(all.end(), client.begin(), client.end());
+    }
+    std::sort(all.begin(), all.end());
+    Bench::report(name + " calls/s", all.size() / elapsed * 1e9, "");
+    Bench::report(name + " p50", all[all.size() / 2] / 1000, "us");
+    Bench::report(name + " p99", all[all.size() * 99 / 100] / 1000, "us");
+}
+
+static std::shared_ptr<grpc::Channel> connect(int port) {
+    return grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                               grpc::InsecureChannelCredentials());
+}
+
+static void sync_load(const std::string& name, Plugin::CollectorInterface* plugin) {
+    Meta meta(Plugin::Collector, "bench", 1);
+    CollectorImpl collector(plugin, &meta);
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&collector);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    load(name + ", sync", connect(port));
+    server->Shutdown();
+}
+
+static void async_load(const std::string& name, Plugin::CollectorInterface* plugin,
+                       int polling_threads) {
+    Meta meta(Plugin::Collector, "bench", 1);
+    meta.polling_threads = polling_threads;
+    AsyncServer async(plugin, &meta);
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    async.configure(builder);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    async.start();
+    load(name + ", async " + std::to_string(async.thread_count()) + " threads", connect(port));
+    async.shutdown(*server);
+}
+
+/**
+* Serves CollectMetrics of 10 metrics to 16 concurrent clients through the
+* synchronous server and through AsyncServer, with one polling thread per
+* core and with 4, for a collector returning at once and for one taking
+* 1ms per call.
+*/
+TEST(ServerLoadBench, CollectMetrics) {
+    for (int latency : {0, 1000}) {
+        LoadCollector plugin{std::chrono::microseconds(latency)};
+        const std::string name = latency ? "1ms collector" : "instant collector";
+        sync_load(name, &plugin);
+        async_load(name, &plugin, 0);
+        async_load(name, &plugin, 4);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+
+static const int caller_count = 8;
+static const int calls_per_caller = 20;
+
+/**
+* ExclusiveCollector spends 2ms on each collection, like a plugin reading a
+* device it owns, and lets one collection run at a time.
+*/
+class ExclusiveCollector final : public Plugin::CollectorInterface {
+public:
+    std::atomic<int> collections{0};
+
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::lock_guard<std::mutex> lock(device);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        for (auto& met : metrics) {
+            met.set_data((int64_t)42);
+        }
+        collections++;
+        return metrics;
+    }
+
+private:
+    std::mutex device;
+};
+
+/**
+* Runs 8 callers each making 20 identical CollectMetrics calls of 16
+* metrics at once, with and without Meta::coalesce_collects. Reports the
+* mean latency of a call and the collections made by the plugin.
+*/
+TEST(SingleFlightBench, IdenticalConcurrentCalls) {
+    rpc::MetricsArg args;
+    for (int m = 0; m < 16; m++) {
+        Metric met(Namespace({"intel", "bench", "metric" + std::to_string(m)}), "", "");
+        *args.add_metrics() = *met.get_rpc_metric_ptr();
+    }
+
+    for (bool coalesce : {false, true}) {
+        ExclusiveCollector plugin;
+        Meta meta(Plugin::Collector, "bench", 1);
+        meta.coalesce_collects = coalesce;
+        CollectorImpl collector(&plugin, &meta);
+        std::atomic<int64_t> latency_ns(0);
+        std::vector<std::thread> callers;
+        for (int c = 0; c < caller_count; c++) {
+            callers.emplace_back([&] {
+                for (int i = 0; i < calls_per_caller; i++) {
+                    rpc::MetricsArg call_args(args);
+                    rpc::MetricsReply resp;
+                    Bench::Stopwatch watch;
+                    collector.CollectMetrics(nullptr, &call_args, &resp);
+                    latency_ns += (int64_t)watch.elapsed_ns();
+                    EXPECT_EQ(16, resp.metrics_size());
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        const std::string name = coalesce ? "coalesced" : "uncoalesced";
+        Bench::report(name + " call latency",
+                      latency_ns.load() / (caller_count * calls_per_caller) / 1e6, "ms");
+        Bench::report(name + " collections", plugin.collections.load(), "");
+    }
+}
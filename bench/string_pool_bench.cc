@@ -0,0 +1,93 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include <snap/string_pool.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Namespace;
+
+static const int catalog_size = 100000;
+
+/**
+* The catalog mimics a collector exposing 100 metric types for each of 1000
+* hosts: the prefix, the dynamic element and the metric names all repeat.
+*/
+static std::vector<std::string> catalog_entry(int i) {
+    return {"intel", "cpp", "bench", "catalog", "*",
+            "metric_type_of_catalog_entry_" + std::to_string(i % 100)};
+}
+
+static const std::string host_name = "hostname";
+static const std::string host_description = "name of the host the metric was collected on";
+
+static Namespace catalog_namespace(int i) {
+    Namespace ns;
+    for (auto& value : catalog_entry(i)) {
+        ns.push_back({value,
+                      value == "*" ? host_name : "",
+                      value == "*" ? host_description : ""});
+    }
+    return ns;
+}
+
+TEST(StringPoolBench, NamespaceCatalog) {
+    int64_t before = Bench::live_bytes();
+    std::vector<Namespace> plain;
+    plain.reserve(catalog_size);
+    for (int i = 0; i < catalog_size; i++) {
+        plain.push_back(catalog_namespace(i));
+    }
+    int64_t plain_bytes = Bench::live_bytes() - before;
+
+    before = Bench::live_bytes();
+    Plugin::StringPool pool;
+    std::vector<Namespace> interned;
+    interned.reserve(catalog_size);
+    for (int i = 0; i < catalog_size; i++) {
+        interned.push_back(std::move(catalog_namespace(i).intern(pool)));
+    }
+    int64_t interned_bytes = Bench::live_bytes() - before;
+
+    Bench::report("namespace catalog, plain strings", plain_bytes / 1048576.0, "MiB");
+    Bench::report("namespace catalog, interned strings", interned_bytes / 1048576.0, "MiB");
+    Bench::report("namespace catalog, saved", (plain_bytes - interned_bytes) / 1048576.0, "MiB");
+    EXPECT_LT(interned_bytes, plain_bytes);
+}
+
+/**
+* Counts the allocations of namespaces and metrics which are not interned,
+* the path of every plugin not using a StringPool.
+*/
+TEST(StringPoolBench, PlainNamespaceAllocations) {
+    const int rounds = 10000;
+    uint64_t before = Bench::allocations();
+    for (int i = 0; i < rounds; i++) {
+        Namespace ns({"intel", "cpp", "bench", "catalog", "metric"});
+    }
+    Bench::report("Namespace of 5 elements, allocs",
+                  double(Bench::allocations() - before) / rounds, "");
+
+    Namespace ns({"intel", "cpp", "bench", "catalog", "metric"});
+    before = Bench::allocations();
+    for (int i = 0; i < rounds; i++) {
+        Plugin::Metric met(ns, "bytes", "size of the catalog entry");
+    }
+    Bench::report("Metric(ns, unit, description), allocs",
+                  double(Bench::allocations() - before) / rounds, "");
+}
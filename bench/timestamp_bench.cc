@@ -0,0 +1,54 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <snap/metric.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using Plugin::Metric;
+
+static const int metric_count = 50000;
+
+template<class F>
+static void measure(const std::string& name, F stamp) {
+    Bench::Stopwatch watch;
+    stamp();
+    Bench::report(name + " time/metric", watch.elapsed_ns() / metric_count, "ns");
+}
+
+/**
+* Stamps a 50k-metric catalog the way GetMetricTypes does: timestamp and last
+* advertised time for every metric.
+*/
+TEST(TimestampBench, Catalog) {
+    std::vector<Metric> metrics(metric_count);
+    // allocate the rpc::Time sub-messages before measuring.
+    Metric::set_advertised_times(metrics);
+
+    measure("per metric set_timestamp()", [&] {
+        for (Metric& met : metrics) {
+            met.set_timestamp();
+            met.set_last_advertised_time();
+        }
+    });
+    measure("batch, realtime clock", [&] {
+        Metric::set_advertised_times(metrics, Plugin::RealtimeClock);
+    });
+    measure("batch, coarse clock", [&] {
+        Metric::set_advertised_times(metrics, Plugin::RealtimeCoarseClock);
+    });
+}
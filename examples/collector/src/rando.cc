@@ -22,11 +22,13 @@ limitations under the License.
 #include <snap/config.h>
 #include <snap/plugin.h>
 #include <snap/metric.h>
+#include <snap/metric_prototype.h>
 #include <snap/flags.h>
 
 using Plugin::Config;
 using Plugin::ConfigPolicy;
 using Plugin::Metric;
+using Plugin::MetricPrototype;
 using Plugin::Meta;
 using Plugin::Type;
 using Plugin::Flags;
@@ -79,14 +81,20 @@ const ConfigPolicy Rando::get_config_policy() {
     return policy;
 }
 
-std::vector<Metric> Rando::get_metric_types(Config cfg) {
+static const std::vector<MetricPrototype> catalog = {
+    MetricPrototype(Namespace({"intel","cpp","mock","rando"}).add_static_element("int32"), "example_unit","example_description" ),
+    MetricPrototype(Namespace({"intel","cpp","mock","rando"}).add_static_element("int64")),
+    MetricPrototype(Namespace({"intel","cpp","mock","rando"}).add_static_element("string")),
+    MetricPrototype(Namespace({"intel","cpp","mock","rando"}).add_static_element("boolean")),
+    MetricPrototype(Namespace({"intel","cpp","mock","dynamic"}).add_dynamic_element("dynamo").add_static_element("int64")),
+};
 
-    std::vector<Metric> metrics = { Metric(Namespace({"intel","cpp","mock","rando"}).add_static_element("int32"), "example_unit","example_description" ),
-                                    Metric(Namespace({"intel","cpp","mock","rando"}).add_static_element("int64"),"",""),
-                                    Metric(Namespace({"intel","cpp","mock","rando"}).add_static_element("string"),"",""),
-                                    Metric(Namespace({"intel","cpp","mock","rando"}).add_static_element("boolean"),"",""),
-                                    Metric(Namespace({"intel","cpp","mock","dynamic"}).add_dynamic_element("dynamo").add_static_element("int64"),"",""),
-                                    };
+std::vector<Metric> Rando::get_metric_types(Config cfg) {
+    std::vector<Metric> metrics;
+    metrics.reserve(catalog.size());
+    for (const MetricPrototype& prototype : catalog) {
+        metrics.push_back(prototype.make());
+    }
     return metrics;
 }
 
@@ -13,6 +13,7 @@ limitations under the License.
 */
 #include "graffiti.h"
 
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -32,6 +33,9 @@ using Plugin::Flags;
 
 static inline std::vector<std::string> split_tags(std::string);
 
+Graffiti::Graffiti() : tags_key(get_config_policy(), "tags"),
+                       tags_cache(16) {}
+
 const ConfigPolicy Graffiti::get_config_policy() {
     ConfigPolicy policy(Plugin::StringRule{
         "tags",
@@ -43,21 +47,23 @@ const ConfigPolicy Graffiti::get_config_policy() {
 void Graffiti::process_metrics(std::vector<Metric> &metrics,
                                const Config& config) {
     std::vector<Metric>::iterator mets_iter;
-    std::string tags_str = config.get_string("tags");
-
-    std::vector<std::string> tags = split_tags(tags_str);
+    std::shared_ptr<Tags> tags = tags_cache.get(config, [this](const Config& cfg) {
+        Tags parsed;
+        for (std::string& tag : split_tags(cfg.get(tags_key))) {
+            parsed.emplace_back(std::move(tag), "present");
+        }
+        return parsed;
+    });
 
     for (mets_iter = metrics.begin(); mets_iter != metrics.end(); mets_iter++) {
-        for (std::string tag : tags) {
-        mets_iter->add_tag(std::pair<std::string, std::string>(tag, "present"));
-        }
+        mets_iter->add_tags(*tags);
     }
 }
 
 int main(int argc, char **argv) {
 
     Meta meta(Type::Processor, "graffiti", 1);
-    Graffiti plg = Graffiti();
+    Graffiti plg;
     start_processor(argc, argv, &plg, meta);
 }
 
@@ -13,15 +13,27 @@ limitations under the License.
 */
 #pragma once
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <snap/config.h>
+#include <snap/config_state_cache.h>
 #include <snap/metric.h>
 #include <snap/plugin.h>
 
 class Graffiti final : public Plugin::ProcessorInterface {
 public:
+    Graffiti();
+
     const Plugin::ConfigPolicy get_config_policy();
     void process_metrics(std::vector<Plugin::Metric> &metrics,
                         const Plugin::Config& config);
+
+private:
+    typedef std::vector<std::pair<std::string, std::string>> Tags;
+
+    Plugin::ConfigKey<std::string> tags_key;
+    // The tags parsed from each config, so that they are split once.
+    Plugin::ConfigStateCache<Tags> tags_cache;
 };
@@ -13,10 +13,10 @@ limitations under the License.
 */
 #include "log.h"
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <fstream>
-#include <map>
 #include <string>
 #include <vector>
 
@@ -32,11 +32,13 @@ using std::chrono::milliseconds;
 using Plugin::Config;
 using Plugin::ConfigPolicy;
 using Plugin::Metric;
+using Plugin::MetricView;
 using Plugin::Meta;
 using Plugin::Type;
 using Plugin::Flags;
 using Plugin::Namespace;
 using Plugin::NamespaceElement;
+using Plugin::TagView;
 
 const ConfigPolicy Log::get_config_policy() {
     ConfigPolicy policy(Plugin::StringRule{
@@ -46,6 +48,15 @@ const ConfigPolicy Log::get_config_policy() {
     return policy;
 }
 
+static void write_timestamp(std::ostream& out, system_clock::time_point ts) {
+    std::time_t c_ts = system_clock::to_time_t(ts);
+    char str_time_b[50];
+    if (std::strftime(str_time_b, sizeof(str_time_b),
+                    "%F %T", std::gmtime(&c_ts))) {
+        out << str_time_b << " ";
+    }
+}
+
 /**
  * {ISO 8601 timestamp} {namespace} tags: [{tags}] data: {data}
  */
@@ -59,13 +70,7 @@ void Log::publish_metrics(std::vector<Metric> &metrics,
 
     for (mets_iter = metrics.begin(); mets_iter != metrics.end(); mets_iter++) {
         // timestamp
-        system_clock::time_point ts = mets_iter->timestamp();
-        std::time_t c_ts = system_clock::to_time_t(ts);
-        char str_time_b[50];
-        if (std::strftime(str_time_b, sizeof(str_time_b),
-                        "%F %T", std::gmtime(&c_ts))) {
-            outfile << str_time_b << " ";
-        }
+        write_timestamp(outfile, mets_iter->timestamp());
 
         // namespace
         for ( NamespaceElement nse : mets_iter->ns().get_namespace_elements()) {
@@ -74,54 +79,59 @@ void Log::publish_metrics(std::vector<Metric> &metrics,
 
         // tags
         outfile << " tags: [";
-        std::map<std::string, std::string>::iterator tags_iter;
-        std::map<std::string, std::string> tags = mets_iter->tags();
-        int tags_size = tags.size();
-        int idx = 1;
-        for (tags_iter = tags.begin(); tags_iter != tags.end();
-            tags_iter++) {
-            outfile << tags_iter->first;
-            if (idx != tags_size) outfile << ", ";
-            idx++;
+        std::vector<TagView::Tag> tags = mets_iter->tag_view().sorted();
+        for (size_t idx = 0; idx < tags.size(); idx++) {
+            if (idx != 0) outfile << ", ";
+            outfile << tags[idx].first;
         }
 
         // data
         outfile << "] " << "data: ";
-        switch (mets_iter->data_type()) {
-        case Metric::DataType::Float32:
-            outfile << mets_iter->get_float32_data() << "\n";
-            break;
-        case Metric::DataType::Float64:
-            outfile << mets_iter->get_float64_data() << "\n";
-            break;
-        case Metric::DataType::Int32:
-            outfile << mets_iter->get_int_data() << "\n";
-            break;
-        case Metric::DataType::Int64:
-            outfile << mets_iter->get_int64_data() << "\n";
-            break;
-        case Metric::DataType::Uint32:
-            outfile << mets_iter->get_uint32_data() << "\n";
-            break;
-        case Metric::DataType::Uint64:
-            outfile << mets_iter->get_uint64_data() << "\n";
-            break;
-        case Metric::DataType::Bool:
-            outfile << mets_iter->get_bool_data() << "\n";
-            break;
-        case Metric::DataType::String:
-            outfile << mets_iter->get_string_data() << "\n";
-            break;
-        case Metric::DataType::NotSet:
-            outfile << "not set\n";
-            break;
+        mets_iter->visit_data([&outfile](const auto& value) {
+            outfile << value << "\n";
+        });
+    }
+}
+
+/**
+ * Same output as publish_metrics, read straight from the request buffer.
+ */
+void Log::publish_metric_views(const std::vector<MetricView> &metrics,
+                               const Config& config) {
+    std::string path = config.get_string("path");
+    std::ofstream outfile;
+    outfile.open(path, std::ios::app);
+
+    std::vector<MetricView::Tag> tags;
+    for (const MetricView& met : metrics) {
+        write_timestamp(outfile, met.timestamp());
+
+        for (unsigned int i = 0; i < met.ns_size(); i++) {
+            outfile << "/" << met.ns_element(i).value;
+        }
+
+        outfile << " tags: [";
+        tags.clear();
+        for (unsigned int i = 0; i < met.tags_size(); i++) {
+            tags.push_back(met.tag(i));
+        }
+        std::sort(tags.begin(), tags.end());
+        for (size_t idx = 0; idx < tags.size(); idx++) {
+            if (idx != 0) outfile << ", ";
+            outfile << tags[idx].first;
         }
+
+        outfile << "] " << "data: ";
+        met.visit_data([&outfile](const auto& value) {
+            outfile << value << "\n";
+        });
     }
 }
 
 int main(int argc, char **argv) {
 
     Meta meta(Type::Publisher, "log", 1);
+    meta.metric_views = true;
     Log plg = Log();
     start_publisher(argc, argv, &plg, meta);
 }
@@ -24,4 +24,6 @@ public:
     const Plugin::ConfigPolicy get_config_policy();
     void publish_metrics(std::vector<Plugin::Metric> &metrics,
                         const Plugin::Config& config);
+    void publish_metric_views(const std::vector<Plugin::MetricView> &metrics,
+                              const Plugin::Config& config);
 };
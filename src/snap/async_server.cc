@@ -0,0 +1,257 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/async_server.h"
+
+#include <algorithm>
+
+#include "snap/proxy/collector_proxy.h"
+#include "snap/proxy/processor_proxy.h"
+#include "snap/proxy/publisher_proxy.h"
+#include "snap/rpc/plugin.grpc.pb.h"
+
+using grpc::CompletionQueue;
+using grpc::ServerAsyncResponseWriter;
+using grpc::ServerCompletionQueue;
+using grpc::ServerContext;
+using grpc::Status;
+
+using Plugin::AsyncServer;
+using Plugin::PluginException;
+using Plugin::Proxy::CollectorImpl;
+using Plugin::Proxy::ProcessorImpl;
+using Plugin::Proxy::PublisherImpl;
+
+class AsyncServer::Call {
+public:
+    virtual ~Call() {}
+
+    /**
+    * proceed is called with the result of the operation last started on the
+    * call.
+    */
+    virtual void proceed(bool ok) = 0;
+};
+
+class AsyncServer::Method {
+public:
+    virtual ~Method() {}
+
+    /**
+    * request asks for the next call of the method to be delivered to `queue`.
+    */
+    virtual void request(ServerCompletionQueue* queue) = 0;
+};
+
+namespace {
+    /**
+    * UnaryMethod requests the calls of a unary method from the generated
+    * AsyncService, and hands them to the matching method of a proxy.
+    */
+    template <class Service, class Impl, class Req, class Resp>
+    class UnaryMethod final : public AsyncServer::Method {
+    public:
+        typedef void (Service::*Requester)(ServerContext*, Req*,
+                                           ServerAsyncResponseWriter<Resp>*,
+                                           CompletionQueue*, ServerCompletionQueue*,
+                                           void*);
+        typedef Status (Impl::*Handler)(ServerContext*, const Req*, Resp*);
+
+        UnaryMethod(Service* service, Requester requester, Impl* impl, Handler handler) :
+                    service(service), requester(requester), impl(impl), handler(handler) {}
+
+        void request(ServerCompletionQueue* queue) override;
+
+    private:
+        class UnaryCall final : public AsyncServer::Call {
+        public:
+            UnaryCall(UnaryMethod* method, ServerCompletionQueue* queue) :
+                      method(method), queue(queue), writer(&context), finishing(false) {}
+
+            void start() {
+                (method->service->*method->requester)(&context, &req, &writer,
+                                                      queue, queue, this);
+            }
+
+            void proceed(bool ok) override {
+                // ok is false for calls requested while the server shut down.
+                if (finishing || !ok) {
+                    delete this;
+                    return;
+                }
+                // Another call is requested before handling this one, so that
+                // the method keeps being served while the plugin runs.
+                method->request(queue);
+                Status status = (method->impl->*method->handler)(&context, &req, &resp);
+                finishing = true;
+                writer.Finish(resp, status, this);
+            }
+
+        private:
+            UnaryMethod* method;
+            ServerCompletionQueue* queue;
+            ServerContext context;
+            Req req;
+            Resp resp;
+            ServerAsyncResponseWriter<Resp> writer;
+            bool finishing;
+        };
+
+        Service* service;
+        Requester requester;
+        Impl* impl;
+        Handler handler;
+    };
+
+    template <class Service, class Impl, class Req, class Resp>
+    void UnaryMethod<Service, Impl, Req, Resp>::request(ServerCompletionQueue* queue) {
+        (new UnaryCall(this, queue))->start();
+    }
+
+    /**
+    * unary binds `requester`, a Request<Method> member of a generated
+    * AsyncService, to `handler`, the proxy member serving the method.
+    * The handler type is left out of deduction, which picks the right
+    * overload of CollectorImpl::CollectMetrics.
+    */
+    template <class Async, class Service, class Impl, class Req, class Resp>
+    std::unique_ptr<AsyncServer::Method> unary(
+            Async* service,
+            void (Service::*requester)(ServerContext*, Req*,
+                                       ServerAsyncResponseWriter<Resp>*,
+                                       CompletionQueue*, ServerCompletionQueue*,
+                                       void*),
+            Impl* impl,
+            typename UnaryMethod<Service, Impl, Req, Resp>::Handler handler) {
+        return std::unique_ptr<AsyncServer::Method>(
+            new UnaryMethod<Service, Impl, Req, Resp>(service, requester, impl, handler));
+    }
+}  // namespace
+
+AsyncServer::AsyncServer(PluginInterface* plugin, const Meta* meta) :
+                         polling_threads(meta->polling_threads > 0
+                             ? meta->polling_threads
+                             : std::max(1u, std::thread::hardware_concurrency())),
+                         stopped(false) {
+    switch (plugin->GetType()) {
+        case Collector: {
+            CollectorImpl* impl = new CollectorImpl(plugin->IsCollector(), meta);
+            auto async = new rpc::Collector::AsyncService();
+            proxy.reset(impl);
+            service.reset(async);
+            methods.push_back(unary(async, &rpc::Collector::AsyncService::RequestCollectMetrics,
+                                    impl, &CollectorImpl::CollectMetrics));
+            methods.push_back(unary(async, &rpc::Collector::AsyncService::RequestGetMetricTypes,
+                                    impl, &CollectorImpl::GetMetricTypes));
+            methods.push_back(unary(async, &rpc::Collector::AsyncService::RequestPing,
+                                    impl, &CollectorImpl::Ping));
+            methods.push_back(unary(async, &rpc::Collector::AsyncService::RequestKill,
+                                    impl, &CollectorImpl::Kill));
+            methods.push_back(unary(async, &rpc::Collector::AsyncService::RequestGetConfigPolicy,
+                                    impl, &CollectorImpl::GetConfigPolicy));
+            break;
+        }
+        case Processor: {
+            ProcessorImpl* impl = new ProcessorImpl(plugin->IsProcessor(), meta);
+            auto async = new rpc::Processor::AsyncService();
+            proxy.reset(impl);
+            service.reset(async);
+            methods.push_back(unary(async, &rpc::Processor::AsyncService::RequestProcess,
+                                    impl, &ProcessorImpl::Process));
+            methods.push_back(unary(async, &rpc::Processor::AsyncService::RequestPing,
+                                    impl, &ProcessorImpl::Ping));
+            methods.push_back(unary(async, &rpc::Processor::AsyncService::RequestKill,
+                                    impl, &ProcessorImpl::Kill));
+            methods.push_back(unary(async, &rpc::Processor::AsyncService::RequestGetConfigPolicy,
+                                    impl, &ProcessorImpl::GetConfigPolicy));
+            break;
+        }
+        case Publisher: {
+            PublisherImpl* impl = new PublisherImpl(plugin->IsPublisher(), meta);
+            auto async = new rpc::Publisher::AsyncService();
+            proxy.reset(impl);
+            service.reset(async);
+            methods.push_back(unary(async, &rpc::Publisher::AsyncService::RequestPublish,
+                                    impl, &PublisherImpl::Publish));
+            methods.push_back(unary(async, &rpc::Publisher::AsyncService::RequestPing,
+                                    impl, &PublisherImpl::Ping));
+            methods.push_back(unary(async, &rpc::Publisher::AsyncService::RequestKill,
+                                    impl, &PublisherImpl::Kill));
+            methods.push_back(unary(async, &rpc::Publisher::AsyncService::RequestGetConfigPolicy,
+                                    impl, &PublisherImpl::GetConfigPolicy));
+            break;
+        }
+        default:
+            throw PluginException("the asynchronous server does not support this plugin type");
+    }
+}
+
+AsyncServer::~AsyncServer() {
+    stop();
+}
+
+bool AsyncServer::supports(Type type) {
+    return type == Collector || type == Processor || type == Publisher;
+}
+
+void AsyncServer::configure(grpc::ServerBuilder& builder) {
+    builder.RegisterService(service.get());
+    for (size_t i = 0; i < polling_threads; i++) {
+        queues.push_back(builder.AddCompletionQueue());
+    }
+}
+
+void AsyncServer::start() {
+    for (auto& queue : queues) {
+        for (auto& method : methods) {
+            method->request(queue.get());
+        }
+        threads.emplace_back(&AsyncServer::poll, queue.get());
+    }
+}
+
+void AsyncServer::shutdown(grpc::Server& server) {
+    server.Shutdown();
+    stop();
+}
+
+void AsyncServer::stop() {
+    if (stopped) {
+        return;
+    }
+    stopped = true;
+    for (auto& queue : queues) {
+        queue->Shutdown();
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    // Queues never polled must be drained all the same.
+    if (threads.empty()) {
+        for (auto& queue : queues) {
+            poll(queue.get());
+        }
+    }
+}
+
+size_t AsyncServer::thread_count() const {
+    return polling_threads;
+}
+
+void AsyncServer::poll(ServerCompletionQueue* queue) {
+    void* tag;
+    bool ok;
+    while (queue->Next(&tag, &ok)) {
+        static_cast<Call*>(tag)->proceed(ok);
+    }
+}
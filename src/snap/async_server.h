@@ -0,0 +1,101 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include "snap/plugin.h"
+
+namespace Plugin {
+    /**
+    * AsyncServer serves a collector, processor or publisher through the
+    * asynchronous gRPC API instead of the synchronous one. Calls are taken
+    * from a ServerCompletionQueue per polling thread, and each is handled on
+    * the thread which took it, by the same proxy the synchronous server uses.
+    * There are as many polling threads as Meta::polling_threads says, one per
+    * core by default, whatever the number of calls in flight.
+    * The plugin is thus called from several threads at once, as it is with
+    * the synchronous server.
+    *
+    * Stream collectors are not supported, and requests and replies are always
+    * the generated messages: Meta::encoded_replies and Meta::metric_views do
+    * not apply.
+    */
+    class AsyncServer final {
+    public:
+        /**
+        * meta must outlive the server.
+        */
+        AsyncServer(PluginInterface* plugin, const Meta* meta);
+
+        /**
+        * shutdown must have been called if the server was built.
+        */
+        ~AsyncServer();
+
+        AsyncServer(const AsyncServer&) = delete;
+        AsyncServer& operator=(const AsyncServer&) = delete;
+
+        /**
+        * supports returns true for the plugin types AsyncServer can serve.
+        */
+        static bool supports(Type type);
+
+        /**
+        * configure registers the plugin's service on `builder`, and adds a
+        * completion queue per polling thread.
+        */
+        void configure(grpc::ServerBuilder& builder);
+
+        /**
+        * start starts the polling threads. It is called once the server has
+        * been built from the builder passed to configure.
+        */
+        void start();
+
+        /**
+        * shutdown shuts `server` down, then the completion queues, and waits
+        * for the polling threads to drain them. gRPC leaves tags of its own on
+        * the queues, so this must happen before `server` is destroyed.
+        */
+        void shutdown(grpc::Server& server);
+
+        size_t thread_count() const;
+
+        /**
+        * Call is an RPC in progress, used as its completion queue tag. Method
+        * requests the calls of one RPC method.
+        */
+        class Call;
+        class Method;
+
+    private:
+        std::unique_ptr<grpc::Service> proxy;
+        std::unique_ptr<grpc::Service> service;
+        std::vector<std::unique_ptr<Method>> methods;
+        std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues;
+        std::vector<std::thread> threads;
+        size_t polling_threads;
+        bool stopped;
+
+        void stop();
+
+        static void poll(grpc::ServerCompletionQueue* queue);
+    };
+}  // namespace Plugin
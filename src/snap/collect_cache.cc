@@ -0,0 +1,121 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/collect_cache.h"
+
+#include <iterator>
+
+#include "snap/config.h"
+
+using Plugin::CollectCache;
+using Plugin::Metric;
+using Plugin::NamespaceView;
+
+CollectCache::CollectCache(std::chrono::milliseconds ttl, size_t capacity) :
+                           ttl(ttl),
+                           capacity(capacity),
+                           hits(0),
+                           misses(0) {}
+
+void CollectCache::split(std::vector<Metric>& requested, std::vector<Metric>& hit_metrics,
+                         std::vector<Metric>& miss_metrics, std::vector<Miss>& missed) {
+    const auto now = std::chrono::steady_clock::now();
+    for (Metric& met : requested) {
+        std::string key = key_of(met);
+        std::shared_ptr<const std::vector<rpc::Metric>> cached;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.expires > now) {
+                cached = it->second.results;
+            }
+        }
+        if (!cached) {
+            misses++;
+            missed.push_back(Miss{std::move(key), met.get_rpc_metric_ptr()->namespace_()});
+            miss_metrics.push_back(std::move(met));
+            continue;
+        }
+        hits++;
+        for (const rpc::Metric& result : *cached) {
+            // The cached message stays shared; the reply gets a copy.
+            const Metric view(const_cast<rpc::Metric*>(&result));
+            hit_metrics.push_back(view);
+        }
+    }
+}
+
+void CollectCache::store(const std::vector<Miss>& missed,
+                         const std::vector<Metric>& results) {
+    std::vector<std::vector<rpc::Metric>> filed(missed.size());
+    // Results are filed under the first of several metrics requested with
+    // the same namespace, so the others are not cached.
+    std::vector<bool> duplicate(missed.size(), false);
+    std::unordered_map<std::string, size_t> by_ns;
+    for (size_t i = 0; i < missed.size(); i++) {
+        duplicate[i] = !by_ns.emplace(NamespaceView(missed[i].ns).get_string(), i).second;
+    }
+    for (const Metric& result : results) {
+        const NamespaceView ns = result.ns_view();
+        auto it = by_ns.find(ns.get_string());
+        if (it != by_ns.end()) {
+            filed[it->second].push_back(*result.get_rpc_metric_ptr());
+            continue;
+        }
+        for (size_t i = 0; i < missed.size(); i++) {
+            if (NamespaceView(missed[i].ns).matches(ns)) {
+                filed[i].push_back(*result.get_rpc_metric_ptr());
+                break;
+            }
+        }
+    }
+
+    const auto expires = std::chrono::steady_clock::now() + ttl;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < missed.size(); i++) {
+        if (duplicate[i]) {
+            continue;
+        }
+        if (entries.size() >= capacity && entries.count(missed[i].key) == 0) {
+            const auto now = std::chrono::steady_clock::now();
+            for (auto it = entries.begin(); it != entries.end();) {
+                it = it->second.expires <= now ? entries.erase(it) : std::next(it);
+            }
+            if (entries.size() >= capacity) {
+                return;
+            }
+        }
+        Entry& entry = entries[missed[i].key];
+        entry.expires = expires;
+        entry.results = std::make_shared<const std::vector<rpc::Metric>>(std::move(filed[i]));
+    }
+}
+
+CollectCache::Stats CollectCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{hits.load(), misses.load(), entries.size()};
+}
+
+void CollectCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+std::string CollectCache::key_of(const Metric& metric) {
+    const uint64_t fingerprint =
+        Config(const_cast<rpc::ConfigMap&>(metric.get_rpc_metric_ptr()->config())).fingerprint();
+    std::string key = metric.ns_view().get_string();
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+    return key;
+}
@@ -0,0 +1,103 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snap/metric.h"
+
+namespace Plugin {
+    /**
+    * CollectCache keeps the metrics a collector returned for each requested
+    * metric, keyed by the requested namespace and the fingerprint of its
+    * config, for `ttl` after they were collected. CollectorImpl uses it when
+    * Meta::collect_cache is set, so that tasks asking for the same metrics
+    * within the TTL are served without calling collect_metrics.
+    * A CollectCache may be shared between threads.
+    */
+    class CollectCache final {
+    public:
+        struct Stats {
+            uint64_t hits;
+            uint64_t misses;
+            size_t entries;
+        };
+
+        /**
+        * Miss records a requested metric without fresh results as it was
+        * requested, since collect_metrics may modify it.
+        */
+        struct Miss {
+            std::string key;
+            google::protobuf::RepeatedPtrField<rpc::NamespaceElement> ns;
+        };
+
+        /**
+        * capacity bounds the number of requested metrics cached. Once it is
+        * reached, expired entries are dropped, and results are not cached
+        * while none has expired.
+        */
+        explicit CollectCache(std::chrono::milliseconds ttl, size_t capacity = 65536);
+
+        CollectCache(const CollectCache&) = delete;
+        CollectCache& operator=(const CollectCache&) = delete;
+
+        /**
+        * split appends copies of the cached results of `requested` to
+        * `hits`, and moves the requested metrics without fresh results to
+        * `misses`, recording each in `missed`.
+        */
+        void split(std::vector<Metric>& requested, std::vector<Metric>& hits,
+                   std::vector<Metric>& misses, std::vector<Miss>& missed);
+
+        /**
+        * store caches `results`, as collected for `missed`. Each result is
+        * filed under the missed metric of equal namespace, or else the first
+        * whose namespace matches it, dynamic and "*" elements matching any
+        * value. Missed metrics without results are cached as such.
+        */
+        void store(const std::vector<Miss>& missed, const std::vector<Metric>& results);
+
+        Stats stats() const;
+
+        void clear();
+
+        /**
+        * key_of returns the key the results of a requested metric are cached
+        * under: its namespace and the fingerprint of its config.
+        */
+        static std::string key_of(const Metric& metric);
+
+    private:
+        struct Entry {
+            std::chrono::steady_clock::time_point expires;
+            std::shared_ptr<const std::vector<rpc::Metric>> results;
+        };
+
+        const std::chrono::milliseconds ttl;
+        const size_t capacity;
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+    };
+}  // namespace Plugin
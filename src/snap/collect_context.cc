@@ -0,0 +1,40 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/collect_context.h"
+
+using Plugin::CollectContext;
+
+CollectContext::CollectContext() : until(Clock::time_point::max()) {}
+
+CollectContext::CollectContext(Clock::time_point deadline) : until(deadline) {}
+
+bool CollectContext::has_deadline() const {
+    return until != Clock::time_point::max();
+}
+
+CollectContext::Clock::time_point CollectContext::deadline() const {
+    return until;
+}
+
+CollectContext::Clock::duration CollectContext::remaining() const {
+    if (!has_deadline()) {
+        return Clock::duration::max();
+    }
+    const Clock::time_point now = Clock::now();
+    return now < until ? until - now : Clock::duration::zero();
+}
+
+bool CollectContext::expired() const {
+    return has_deadline() && Clock::now() >= until;
+}
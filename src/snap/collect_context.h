@@ -0,0 +1,61 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <chrono>
+
+namespace Plugin {
+    /**
+    * CollectContext is passed to CollectorInterface::collect_metrics_until
+    * with the point in time by which the call should return. A collector
+    * reading several sources can check expired() between them, and return
+    * the metrics collected so far once it is set; the proxy then replies
+    * those and reports the missing namespaces in the reply's error.
+    */
+    class CollectContext final {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+        * A context without a deadline, which never expires.
+        */
+        CollectContext();
+
+        explicit CollectContext(Clock::time_point deadline);
+
+        /**
+        * has_deadline returns false for contexts which never expire.
+        */
+        bool has_deadline() const;
+
+        /**
+        * Returns the deadline, Clock::time_point::max() if there is none.
+        */
+        Clock::time_point deadline() const;
+
+        /**
+        * remaining returns the time left until the deadline, 0 once it
+        * passed, and Clock::duration::max() if there is none.
+        */
+        Clock::duration remaining() const;
+
+        /**
+        * expired returns true once the deadline passed.
+        */
+        bool expired() const;
+
+    private:
+        Clock::time_point until;
+    };
+}  // namespace Plugin
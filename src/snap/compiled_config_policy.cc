@@ -0,0 +1,223 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/compiled_config_policy.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "snap/plugin.h"
+
+using Plugin::CompiledConfigPolicy;
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::NamespaceView;
+using Plugin::PluginException;
+
+namespace {
+    std::vector<std::string> split_key(const std::string& key) {
+        std::vector<std::string> prefix;
+        if (key.empty()) {
+            return prefix;
+        }
+        std::stringstream stream(key);
+        std::string element;
+        while (std::getline(stream, element, '.')) {
+            prefix.push_back(element);
+        }
+        return prefix;
+    }
+}  // namespace
+
+CompiledConfigPolicy::CompiledConfigPolicy(const ConfigPolicy& policy,
+                                           size_t cache_capacity) {
+    // Rules are grouped by namespace first, whatever their type.
+    std::map<std::string, std::vector<Rule>> by_ns;
+    for (const auto& ns_policy : policy.string_policy()) {
+        for (const auto& rule : ns_policy.second.rules()) {
+            Rule r{rule.first, StringKind, rule.second.required(), rule.second.has_default(),
+                   false, false, rule.second.default_(), 0, false, 0, 0};
+            by_ns[ns_policy.first].push_back(r);
+        }
+    }
+    for (const auto& ns_policy : policy.integer_policy()) {
+        for (const auto& rule : ns_policy.second.rules()) {
+            Rule r{rule.first, IntegerKind, rule.second.required(), rule.second.has_default(),
+                   rule.second.has_min(), rule.second.has_max(), "",
+                   rule.second.default_(), false,
+                   rule.second.minimum(), rule.second.maximum()};
+            by_ns[ns_policy.first].push_back(r);
+        }
+    }
+    for (const auto& ns_policy : policy.bool_policy()) {
+        for (const auto& rule : ns_policy.second.rules()) {
+            Rule r{rule.first, BoolKind, rule.second.required(), rule.second.has_default(),
+                   false, false, "", 0, rule.second.default_(), 0, 0};
+            by_ns[ns_policy.first].push_back(r);
+        }
+    }
+
+    for (auto& ns_rules : by_ns) {
+        Section section{split_key(ns_rules.first), rules.size(), 0};
+        for (Rule& rule : ns_rules.second) {
+            rules.push_back(std::move(rule));
+        }
+        section.end = rules.size();
+        sections.push_back(std::move(section));
+    }
+    std::stable_sort(sections.begin(), sections.end(),
+                     [](const Section& a, const Section& b) {
+                         return a.prefix.size() < b.prefix.size();
+                     });
+
+    if (cache_capacity > 0) {
+        outcomes.reset(new ConfigStateCache<Outcome>(cache_capacity));
+    }
+}
+
+void CompiledConfigPolicy::apply(rpc::ConfigMap& config) const {
+    apply(config, nullptr);
+}
+
+void CompiledConfigPolicy::apply(rpc::ConfigMap& config, const NamespaceView& ns) const {
+    apply(config, &ns);
+}
+
+size_t CompiledConfigPolicy::size() const {
+    return rules.size();
+}
+
+void CompiledConfigPolicy::apply(rpc::ConfigMap& config, const NamespaceView* ns) const {
+    if (rules.empty()) {
+        return;
+    }
+
+    Outcome uncached;
+    std::shared_ptr<Outcome> cached;
+    const Outcome* outcome = &uncached;
+    if (outcomes && sections.size() <= 64) {
+        // The outcome depends on the sections matching the namespace as
+        // well as on the config; the salt has a bit per matching section.
+        uint64_t salt = 0;
+        for (size_t i = 0; i < sections.size(); i++) {
+            if (matches(sections[i], ns)) {
+                salt |= uint64_t(1) << i;
+            }
+        }
+        cached = outcomes->get(Config(config), salt,
+                               [this, &config, ns](const Config&) { return check(config, ns); });
+        outcome = cached.get();
+    } else {
+        uncached = check(config, ns);
+    }
+
+    if (!outcome->error.empty()) {
+        throw PluginException(outcome->error);
+    }
+    fill(config, *outcome);
+}
+
+std::string CompiledConfigPolicy::fill_defaults(rpc::ConfigMap& config) const {
+    const Outcome outcome = check(config, nullptr);
+    fill(config, outcome);
+    return outcome.error;
+}
+
+void CompiledConfigPolicy::fill(rpc::ConfigMap& config, const Outcome& outcome) const {
+    for (uint32_t index : outcome.defaults) {
+        const Rule& rule = rules[index];
+        switch (rule.kind) {
+            case StringKind:
+                (*config.mutable_stringmap())[rule.key] = rule.string_default;
+                break;
+            case IntegerKind:
+                (*config.mutable_intmap())[rule.key] = rule.int_default;
+                break;
+            case BoolKind:
+                (*config.mutable_boolmap())[rule.key] = rule.bool_default;
+                break;
+        }
+    }
+}
+
+bool CompiledConfigPolicy::matches(const Section& section, const NamespaceView* ns) const {
+    if (ns == nullptr) {
+        return true;
+    }
+    if (section.prefix.size() > ns->size()) {
+        return false;
+    }
+    for (size_t i = 0; i < section.prefix.size(); i++) {
+        if ((*ns)[i].value() != section.prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CompiledConfigPolicy::Outcome CompiledConfigPolicy::check(const rpc::ConfigMap& config,
+                                                          const NamespaceView* ns) const {
+    Outcome outcome;
+    std::ostringstream errors;
+    auto fail = [&errors](const std::string& message) {
+        if (errors.tellp() > 0) {
+            errors << "; ";
+        }
+        errors << message;
+    };
+
+    for (const Section& section : sections) {
+        if (!matches(section, ns)) {
+            continue;
+        }
+        for (size_t i = section.begin; i < section.end; i++) {
+            const Rule& rule = rules[i];
+            bool present = false;
+            switch (rule.kind) {
+                case StringKind:
+                    present = config.stringmap().count(rule.key) > 0;
+                    break;
+                case BoolKind:
+                    present = config.boolmap().count(rule.key) > 0;
+                    break;
+                case IntegerKind: {
+                    const auto it = config.intmap().find(rule.key);
+                    present = it != config.intmap().end();
+                    if (present && ((rule.has_min && it->second < rule.minimum) ||
+                                    (rule.has_max && it->second > rule.maximum))) {
+                        std::ostringstream message;
+                        message << "config value " << rule.key << " = " << it->second
+                                << " is out of range [";
+                        if (rule.has_min) message << rule.minimum;
+                        message << ", ";
+                        if (rule.has_max) message << rule.maximum;
+                        message << "]";
+                        fail(message.str());
+                    }
+                    break;
+                }
+            }
+            if (present) {
+                continue;
+            }
+            if (rule.has_default) {
+                outcome.defaults.push_back(i);
+            } else if (rule.required) {
+                fail("config value " + rule.key + " is required");
+            }
+        }
+    }
+    outcome.error = errors.str();
+    return outcome;
+}
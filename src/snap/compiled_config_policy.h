@@ -0,0 +1,123 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "snap/config.h"
+#include "snap/config_state_cache.h"
+#include "snap/metric.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    /**
+    * CompiledConfigPolicy is a ConfigPolicy turned, once, into a flat table
+    * of rules holding the key, type, default, requirement and range of each.
+    * apply checks an incoming config against the table and fills in the
+    * defaults of the keys it lacks, in a single pass over the table.
+    * The outcome of the check is cached per config and set of matching
+    * namespaces, so a config seen before only costs hashing and comparing it
+    * and inserting its defaults. Policies of more than 64 namespaces are
+    * checked on every call.
+    * A CompiledConfigPolicy may be shared between threads.
+    */
+    class CompiledConfigPolicy final {
+    public:
+        /**
+        * cache_capacity bounds the number of distinct configs whose outcome is
+        * cached; 0 disables the cache.
+        */
+        explicit CompiledConfigPolicy(const ConfigPolicy& policy,
+                                      size_t cache_capacity = 64);
+
+        /**
+        * apply checks `config` against every rule of the policy, then adds the
+        * default of each key it lacks. It throws a PluginException naming
+        * every missing required key and every integer out of range, in which
+        * case `config` is left untouched.
+        */
+        void apply(rpc::ConfigMap& config) const;
+
+        /**
+        * Same as above, with the rules of the policies whose namespace is a
+        * prefix of `ns` only, as for the config of a metric requested from a
+        * collector. When several of them have a default for the same key, the
+        * one of the longest namespace wins.
+        */
+        void apply(rpc::ConfigMap& config, const NamespaceView& ns) const;
+
+        /**
+        * fill_defaults adds the default of each key `config` lacks, like
+        * apply, but even when the config breaks other rules. It returns the
+        * message apply would throw, or an empty string. Diagnostics use it to
+        * show a complete config while still reporting what is missing.
+        */
+        std::string fill_defaults(rpc::ConfigMap& config) const;
+
+        /**
+        * Returns the number of rules.
+        */
+        size_t size() const;
+
+    private:
+        enum Kind { StringKind, IntegerKind, BoolKind };
+
+        struct Rule {
+            std::string key;
+            Kind kind;
+            bool required;
+            bool has_default;
+            bool has_min;
+            bool has_max;
+            std::string string_default;
+            int64_t int_default;
+            bool bool_default;
+            int64_t minimum;
+            int64_t maximum;
+        };
+
+        /**
+        * Section is the range of `rules` of the policy of one namespace,
+        * split into its elements.
+        */
+        struct Section {
+            std::vector<std::string> prefix;
+            size_t begin;
+            size_t end;
+        };
+
+        /**
+        * Outcome is the result of checking a config: the errors found, or the
+        * indexes of the rules whose default is to be added.
+        */
+        struct Outcome {
+            std::string error;
+            std::vector<uint32_t> defaults;
+        };
+
+        std::vector<Rule> rules;
+        // Shortest prefix first, so that longer ones fill their defaults last.
+        std::vector<Section> sections;
+        std::unique_ptr<ConfigStateCache<Outcome>> outcomes;
+
+        void apply(rpc::ConfigMap& config, const NamespaceView* ns) const;
+        bool matches(const Section& section, const NamespaceView* ns) const;
+        Outcome check(const rpc::ConfigMap& config, const NamespaceView* ns) const;
+        void fill(rpc::ConfigMap& config, const Outcome& outcome) const;
+    };
+}  // namespace Plugin
@@ -13,16 +13,101 @@ limitations under the License.
 */
 #include "snap/config.h"
 
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "snap/plugin.h"
+
 using Plugin::Config;
+using Plugin::ConfigKey;
 using Plugin::ConfigPolicy;
+using Plugin::ConfigTraits;
+using Plugin::PluginException;
 using Plugin::StringRule;
 
 static const std::string build_key(const std::vector<std::string>&);
 
+namespace {
+    const uint64_t hash_seed = 0x243f6a8885a308d3ULL;
+    const uint64_t hash_multiplier = 0x9e3779b97f4a7c15ULL;
+
+    /**
+    * hash_bytes folds `size` bytes into `hash` eight at a time. The size is
+    * folded in as well, which keeps "ab"+"c" apart from "a"+"bc".
+    */
+    uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+        hash = (hash ^ size) * hash_multiplier;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            hash = (hash ^ word) * hash_multiplier;
+            hash ^= hash >> 29;
+        }
+        uint64_t tail = 0;
+        for (size_t i = 0; i < size; i++) {
+            tail |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return (hash ^ tail) * hash_multiplier;
+    }
+
+    uint64_t hash_key(char map, const std::string& key) {
+        return hash_bytes(hash_seed ^ map, key.data(), key.size());
+    }
+
+    uint64_t hash_value(uint64_t hash, const std::string& value) {
+        return hash_bytes(hash, value.data(), value.size());
+    }
+
+    uint64_t hash_value(uint64_t hash, uint64_t value) {
+        return (hash ^ value) * hash_multiplier;
+    }
+
+    /**
+    * mix spreads the bits of an entry hash before it is added to the
+    * fingerprint, so that the sum of entries does not cancel out.
+    */
+    uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    uint64_t bits_of(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    template <class V>
+    bool same_value(const V& a, const V& b) {
+        return a == b;
+    }
+
+    // compared bitwise, as fingerprint hashes them.
+    bool same_value(double a, double b) {
+        return bits_of(a) == bits_of(b);
+    }
+
+    template <class Map>
+    bool same_map(const Map& a, const Map& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (const auto& entry : a) {
+            const auto it = b.find(entry.first);
+            if (it == b.end() || !same_value(entry.second, it->second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}  // namespace
+
 ConfigPolicy::ConfigPolicy() {}
 ConfigPolicy::~ConfigPolicy() {}
 
@@ -40,21 +125,21 @@ void ConfigPolicy::add_rule(const std::vector<std::string>& ns,
                             const StringRule& rule) {
     std::string key = build_key(ns);
     auto policy_ptr = mutable_string_policy();
-    (*policy_ptr)[key] = rule;
+    (*policy_ptr)[key].MergeFrom(rule);
 }
 
 void ConfigPolicy::add_rule(const std::vector<std::string>& ns,
                             const IntRule& rule) {
     std::string key = build_key(ns);
     auto policy_ptr = mutable_integer_policy();
-    (*policy_ptr)[key]= rule;
+    (*policy_ptr)[key].MergeFrom(rule);
 }
 
 void ConfigPolicy::add_rule(const std::vector<std::string>& ns,
                             const BoolRule& rule) {
     std::string key = build_key(ns);
     auto policy_ptr = mutable_bool_policy();
-    (*policy_ptr)[key] = rule;
+    (*policy_ptr)[key].MergeFrom(rule);
 }
 
 Config::Config(rpc::ConfigMap& config) :
@@ -63,18 +148,15 @@ Config::Config(rpc::ConfigMap& config) :
 Config::~Config() {}
 
 bool Config::get_bool(const std::string& key) const {
-    auto bool_map = rpc_map.boolmap();
-    return bool_map.at(key);
+    return rpc_map.boolmap().at(key);
 }
 
 int Config::get_int(const std::string& key) const {
-    auto int_map = rpc_map.intmap();
-    return int_map.at(key);
+    return rpc_map.intmap().at(key);
 }
 
 std::string Config::get_string(const std::string& key) const {
-    auto str_map = rpc_map.stringmap();
-    return str_map.at(key);
+    return rpc_map.stringmap().at(key);
 }
 
 void Config::set_int(const std::string& key, int value) {
@@ -96,9 +178,44 @@ Config& Config::operator=(const Config& that) {
     return *this;
 }
 
+uint64_t Config::fingerprint() const {
+    // Entries are hashed one by one and summed, which does not depend on
+    // the iteration order of the maps. The map an entry comes from is
+    // hashed in as well.
+    uint64_t sum = 0;
+    for (const auto& entry : rpc_map.intmap()) {
+        sum += mix(hash_value(hash_key('i', entry.first), static_cast<uint64_t>(entry.second)));
+    }
+    for (const auto& entry : rpc_map.stringmap()) {
+        sum += mix(hash_value(hash_key('s', entry.first), entry.second));
+    }
+    for (const auto& entry : rpc_map.floatmap()) {
+        sum += mix(hash_value(hash_key('f', entry.first), bits_of(entry.second)));
+    }
+    for (const auto& entry : rpc_map.boolmap()) {
+        sum += mix(hash_value(hash_key('b', entry.first), static_cast<uint64_t>(entry.second)));
+    }
+    return sum;
+}
+
+bool Config::same_entries(const rpc::ConfigMap& that) const {
+    return same_map(rpc_map.intmap(), that.intmap()) &&
+           same_map(rpc_map.stringmap(), that.stringmap()) &&
+           same_map(rpc_map.floatmap(), that.floatmap()) &&
+           same_map(rpc_map.boolmap(), that.boolmap());
+}
+
+const rpc::ConfigMap& Config::get_rpc_config() const {
+    return rpc_map;
+}
+
+void Config::missing_key(const std::string& key) {
+    throw PluginException("config has no value for " + key);
+}
+
 void Config::apply_defaults(const ConfigPolicy& from) {
-    for(const auto string_policy : from.string_policy()) {
-        for (const auto rule : string_policy.second.rules()) {
+    for(const auto& string_policy : from.string_policy()) {
+        for (const auto& rule : string_policy.second.rules()) {
             if (rule.second.has_default()) {
                 if(!rpc_map.stringmap().count(rule.first)) {
                     set_string(rule.first,rule.second.default_());
@@ -106,8 +223,8 @@ void Config::apply_defaults(const ConfigPolicy& from) {
             }
         }
     }
-    for(const auto int_policy : from.integer_policy()) {
-        for (const auto rule : int_policy.second.rules()) {
+    for(const auto& int_policy : from.integer_policy()) {
+        for (const auto& rule : int_policy.second.rules()) {
             if (rule.second.has_default()) {
                 if(! rpc_map.intmap().count(rule.first)) {
                     set_int(rule.first,rule.second.default_());
@@ -115,8 +232,8 @@ void Config::apply_defaults(const ConfigPolicy& from) {
             }
         }
     }
-    for(const auto bool_policy : from.bool_policy()) {
-        for (const auto rule : bool_policy.second.rules()) {
+    for(const auto& bool_policy : from.bool_policy()) {
+        for (const auto& rule : bool_policy.second.rules()) {
             if (rule.second.has_default()) {
                 if(!rpc_map.boolmap().count(rule.first)) {
                     set_bool(rule.first,rule.second.default_());
@@ -126,6 +243,42 @@ void Config::apply_defaults(const ConfigPolicy& from) {
     }
 }
 
+template <class T>
+ConfigKey<T>::ConfigKey(const std::string& key) :
+                        key(key),
+                        defaulted(false),
+                        default_value() {}
+
+template <class T>
+ConfigKey<T>::ConfigKey(const ConfigPolicy& policy, const std::string& key,
+                        const std::vector<std::string>& ns) :
+                        ConfigKey(key) {
+    const auto& policies = ConfigTraits<T>::policies(policy);
+    const auto policy_it = policies.find(build_key(ns));
+    if (policy_it == policies.end() || !policy_it->second.rules().count(key)) {
+        throw PluginException("config policy has no rule for " + key);
+    }
+    const auto& rule = policy_it->second.rules().at(key);
+    if (rule.has_default()) {
+        defaulted = true;
+        default_value = rule.default_();
+    }
+}
+
+template <class T>
+const std::string& ConfigKey<T>::name() const {
+    return key;
+}
+
+template <class T>
+bool ConfigKey<T>::has_default() const {
+    return defaulted;
+}
+
+template class Plugin::ConfigKey<std::string>;
+template class Plugin::ConfigKey<int>;
+template class Plugin::ConfigKey<bool>;
+
 static const std::string build_key(const std::vector<std::string>& ns) {
     std::stringstream ss;
     int i = 1;
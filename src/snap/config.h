@@ -13,6 +13,7 @@ limitations under the License.
 */
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -130,6 +131,74 @@ namespace Plugin {
         void add_rule(const std::vector<std::string>& ns, const BoolRule& rule);
     };
 
+    /**
+    * ConfigTraits maps a config value type to the rpc::ConfigMap map holding
+    * its values and to the ConfigPolicy policies holding its rules. It is
+    * specialized for the types of StringRule, IntRule and BoolRule.
+    * @see ConfigKey
+    */
+    template <class T> struct ConfigTraits;
+
+    template <> struct ConfigTraits<std::string> {
+        typedef const std::string& result_type;
+        typedef rpc::StringPolicy Policy;
+        static const google::protobuf::Map<std::string, std::string>& values(const rpc::ConfigMap& m) { return m.stringmap(); }
+        static const google::protobuf::Map<std::string, Policy>& policies(const ConfigPolicy& p) { return p.string_policy(); }
+    };
+
+    template <> struct ConfigTraits<int> {
+        typedef int result_type;
+        typedef rpc::IntegerPolicy Policy;
+        static const google::protobuf::Map<std::string, int64_t>& values(const rpc::ConfigMap& m) { return m.intmap(); }
+        static const google::protobuf::Map<std::string, Policy>& policies(const ConfigPolicy& p) { return p.integer_policy(); }
+    };
+
+    template <> struct ConfigTraits<bool> {
+        typedef bool result_type;
+        typedef rpc::BoolPolicy Policy;
+        static const google::protobuf::Map<std::string, bool>& values(const rpc::ConfigMap& m) { return m.boolmap(); }
+        static const google::protobuf::Map<std::string, Policy>& policies(const ConfigPolicy& p) { return p.bool_policy(); }
+    };
+
+    /**
+    * ConfigKey is a typed handle on a config key, made once, typically when
+    * the plugin is constructed, and read from the Config of every call with
+    * Config::get. A read is a single lookup in the map of type T, without
+    * building a key string or copying the map, and falls back on the default
+    * of the policy rule the key was resolved from.
+    */
+    template <class T>
+    class ConfigKey final {
+        friend class Config;
+
+    public:
+        /**
+        * A key without a default: reading it from a config lacking it throws.
+        */
+        explicit ConfigKey(const std::string& key);
+
+        /**
+        * Resolves `key` against the rules of type T that `policy` holds for
+        * `ns`, as given to ConfigPolicy::add_rule. The default of the rule, if
+        * any, is taken over. Throws a PluginException when there is no such
+        * rule.
+        */
+        ConfigKey(const ConfigPolicy& policy, const std::string& key,
+                  const std::vector<std::string>& ns = {""});
+
+        const std::string& name() const;
+        bool has_default() const;
+
+    private:
+        std::string key;
+        bool defaulted;
+        T default_value;
+    };
+
+    extern template class ConfigKey<std::string>;
+    extern template class ConfigKey<int>;
+    extern template class ConfigKey<bool>;
+
     /**
     * Config is the incoming configuration data which has been vetted by snapteld
     * according to the plugin's ConfigPolicy or generated for the needs of diagnostics
@@ -161,11 +230,41 @@ namespace Plugin {
         bool get_bool(const std::string& key) const;
         int get_int(const std::string& key) const;
         std::string get_string(const std::string& key) const;
+
+        /**
+        * get returns the value of `key`, or its default when this config
+        * lacks it. A string is returned by reference, into this config or
+        * into `key`. Throws a PluginException when there is neither.
+        */
+        template <class T>
+        typename ConfigTraits<T>::result_type get(const ConfigKey<T>& key) const;
         
         void set_int(const std::string& key, int value) ;
         void set_string(const std::string& key, std::string value);
         void set_bool(const std::string& key, bool value);
 
+        /**
+        * fingerprint returns a 64-bit hash of every key and value of the
+        * config. Equal configs have equal fingerprints whatever the order of
+        * their maps, in any process, so it can key per-config state when the
+        * plugin uses the ConfigBased strategy. It is computed on each call,
+        * without allocating.
+        * @see ConfigStateCache
+        */
+        uint64_t fingerprint() const;
+
+        /**
+        * same_entries returns whether this config and `that` hold the same
+        * keys and values, whatever the order of their maps. Caches keyed by
+        * fingerprint use it to tell a hit from a collision.
+        */
+        bool same_entries(const rpc::ConfigMap& that) const;
+
+        /**
+        * get_rpc_config returns the rpc::ConfigMap this config reads.
+        */
+        const rpc::ConfigMap& get_rpc_config() const;
+
         /**
         * Apply defaults method is used only in diagnostics mode.
         */
@@ -173,5 +272,20 @@ namespace Plugin {
 
         private:
         rpc::ConfigMap& rpc_map;
+
+        [[noreturn]] static void missing_key(const std::string& key);
     };
+
+    template <class T>
+    typename ConfigTraits<T>::result_type Config::get(const ConfigKey<T>& key) const {
+        const auto& values = ConfigTraits<T>::values(rpc_map);
+        const auto it = values.find(key.key);
+        if (it != values.end()) {
+            return it->second;
+        }
+        if (!key.defaulted) {
+            missing_key(key.key);
+        }
+        return key.default_value;
+    }
 };  // namespace Plugin
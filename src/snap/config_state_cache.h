@@ -0,0 +1,211 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "snap/config.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    /**
+    * ConfigStateCache keeps state a plugin builds from its config, such as a
+    * database connection or parsed settings, so that it is built once per
+    * distinct config rather than on every call. States are looked up by
+    * Config::fingerprint, and each entry keeps a copy of its config which is
+    * compared on a hit, so that two configs sharing a fingerprint never share
+    * a state. The least recently used state is dropped once more than
+    * `capacity` configs have been seen.
+    * States are handed out as shared_ptrs, so one evicted while a call still
+    * uses it lives until that call is done. A cache may be shared between
+    * threads; the state itself must be safe to use from the threads calling
+    * the plugin.
+    */
+    template <class T>
+    class ConfigStateCache final {
+    public:
+        explicit ConfigStateCache(size_t capacity);
+
+        ConfigStateCache(const ConfigStateCache&) = delete;
+        ConfigStateCache& operator=(const ConfigStateCache&) = delete;
+
+        /**
+        * get returns the state of `config`. When there is none, it is built
+        * by calling `make(config)`, which returns a T, or a shared_ptr or
+        * unique_ptr to one.
+        * `make` is called without holding the cache lock, so calls for
+        * different configs build their states in parallel; when two calls
+        * build the state of the same config, the first one stored is kept.
+        */
+        template <class F>
+        std::shared_ptr<T> get(const Config& config, F make);
+
+        /**
+        * Same as above, for state which depends on `salt` as well as on the
+        * config. Salts are compared as is, so they must tell states apart
+        * exactly, not just hash what they depend on.
+        * get(config, make) is get(config, 0, make).
+        */
+        template <class F>
+        std::shared_ptr<T> get(const Config& config, uint64_t salt, F make);
+
+        /**
+        * erase drops the state of `config`, e.g. after its connection broke,
+        * so that the next get builds it again.
+        */
+        void erase(const Config& config, uint64_t salt = 0);
+
+        void clear();
+
+        size_t size() const;
+        size_t capacity() const;
+
+    private:
+        struct Key {
+            uint64_t fingerprint;
+            uint64_t salt;
+
+            bool operator==(const Key& that) const {
+                return fingerprint == that.fingerprint && salt == that.salt;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return key.fingerprint + key.salt * 0x9e3779b97f4a7c15ULL;
+            }
+        };
+
+        struct Entry {
+            Key key;
+            rpc::ConfigMap config;
+            std::shared_ptr<T> state;
+        };
+
+        typedef std::list<Entry> Entries;
+
+        const size_t max_size;
+        mutable std::mutex mutex;
+        // Most recently used first.
+        Entries entries;
+        std::unordered_map<Key, typename Entries::iterator, KeyHash> index;
+
+        /**
+        * find returns the state of `config` under `key`, or nullptr. It
+        * drops the entry of another config sharing the key when `drop` is
+        * set.
+        */
+        std::shared_ptr<T> find(const Key& key, const Config& config, bool drop);
+
+        static std::shared_ptr<T> wrap(T&& state) {
+            return std::make_shared<T>(std::move(state));
+        }
+        static std::shared_ptr<T> wrap(std::shared_ptr<T> state) {
+            return state;
+        }
+        static std::shared_ptr<T> wrap(std::unique_ptr<T> state) {
+            return std::shared_ptr<T>(std::move(state));
+        }
+    };
+
+    template <class T>
+    ConfigStateCache<T>::ConfigStateCache(size_t capacity) :
+                                          max_size(capacity > 0 ? capacity : 1) {}
+
+    template <class T>
+    template <class F>
+    std::shared_ptr<T> ConfigStateCache<T>::get(const Config& config, F make) {
+        return get(config, 0, std::move(make));
+    }
+
+    template <class T>
+    template <class F>
+    std::shared_ptr<T> ConfigStateCache<T>::get(const Config& config, uint64_t salt, F make) {
+        const Key key{config.fingerprint(), salt};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::shared_ptr<T> state = find(key, config, false);
+            if (state) {
+                return state;
+            }
+        }
+
+        std::shared_ptr<T> state = wrap(make(config));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<T> raced = find(key, config, true);
+        if (raced) {
+            return raced;
+        }
+        entries.push_front(Entry{key, config.get_rpc_config(), state});
+        index[key] = entries.begin();
+        if (entries.size() > max_size) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+        return state;
+    }
+
+    template <class T>
+    std::shared_ptr<T> ConfigStateCache<T>::find(const Key& key, const Config& config,
+                                                 bool drop) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        if (!config.same_entries(it->second->config)) {
+            if (drop) {
+                entries.erase(it->second);
+                index.erase(it);
+            }
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->state;
+    }
+
+    template <class T>
+    void ConfigStateCache<T>::erase(const Config& config, uint64_t salt) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(Key{config.fingerprint(), salt});
+        if (it != index.end() && config.same_entries(it->second->config)) {
+            entries.erase(it->second);
+            index.erase(it);
+        }
+    }
+
+    template <class T>
+    void ConfigStateCache<T>::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+    }
+
+    template <class T>
+    size_t ConfigStateCache<T>::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    template <class T>
+    size_t ConfigStateCache<T>::capacity() const {
+        return max_size;
+    }
+}  // namespace Plugin
@@ -33,6 +33,7 @@ limitations under the License.
 #define STAND_ALONE_PORT 8182
 #define MAX_COLLECT_DURATION 10
 #define MAX_METRICS_BUFFER 0
+#define POLLING_THREADS 0
 
 // Default hidden flags:
 #define OPTIONS_FILE "options.cfg"
@@ -103,7 +104,10 @@ int Plugin::Flags::addDefaultGlobalFlags() {
             ("max-collect-duration", po::value<int>(&_max_collect_duration)->default_value(MAX_COLLECT_DURATION),
                 "In seconds, sets the maximum duration (always greater than 0s) between collections before metrics are sent")
             ("max-metrics-buffer", po::value<int64_t>(&_max_metrics_buffer)->default_value(MAX_METRICS_BUFFER),
-                "Maximum number of metrics the plugin is buffering before sending metrics");
+                "Maximum number of metrics the plugin is buffering before sending metrics")
+            ("async-server", "Serve calls with the asynchronous gRPC server")
+            ("polling-threads", po::value<int>(&_polling_threads)->default_value(POLLING_THREADS),
+                "Number of threads the asynchronous server polls for calls with, 0 for one per core");
         _config_file.add(_global);
         return 0;
     }
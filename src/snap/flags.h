@@ -54,7 +54,7 @@ namespace Plugin {
         po::options_description _visible, _command_line, _config_file;
 
         // Default variables
-        int _log_level, _stand_alone_port, _max_collect_duration;
+        int _log_level, _stand_alone_port, _max_collect_duration, _polling_threads;
         std::string _options_file, _listen_port, _listen_addr, _cert_path, _key_path, _root_cert_paths;
         int64_t _max_metrics_buffer;
 
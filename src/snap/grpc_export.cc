@@ -51,6 +51,7 @@ using grpc::ServerBuilder;
 
 using json = nlohmann::json;
 
+using Plugin::AsyncServer;
 using Plugin::PluginInterface;
 using Plugin::Meta;
 using Plugin::PluginException;
@@ -218,31 +219,54 @@ void Plugin::GRPCExportImpl::doConfigure() {
     std::stringstream ss;
     ss << this->meta->listen_addr << ":";
     this->meta->listen_port == "" ? ss << "0" : ss << this->meta->listen_port;
+    builder.reset(new grpc::ServerBuilder());
+    builder->AddListeningPort(ss.str(), this->credentials,
+                            &this->port);
 
+    if (this->meta->async_server && AsyncServer::supports(plugin->GetType())) {
+        this->async_server.reset(new AsyncServer(plugin.get(), this->meta));
+        return;
+    }
     switch (plugin->GetType()) {
         case Plugin::Collector:
-            this->service.reset(new Proxy::CollectorImpl(plugin->IsCollector()));
+#ifdef GRPC_CPP_VERSION_MAJOR
+            if (this->meta->encoded_replies) {
+                this->service.reset(new Proxy::EncodedCollectorService(plugin->IsCollector(), this->meta));
+                break;
+            }
+#endif
+            this->service.reset(new Proxy::CollectorImpl(plugin->IsCollector(), this->meta));
             break;
         case Plugin::Processor:
-            this->service.reset(new Proxy::ProcessorImpl(plugin->IsProcessor()));
+            this->service.reset(new Proxy::ProcessorImpl(plugin->IsProcessor(), this->meta));
             break;
         case Plugin::Publisher:
-            this->service.reset(new Proxy::PublisherImpl(plugin->IsPublisher()));
+#ifdef GRPC_CPP_VERSION_MAJOR
+            if (this->meta->metric_views) {
+                this->service.reset(new Proxy::ViewPublisherService(plugin->IsPublisher(), this->meta));
+                break;
+            }
+#endif
+            this->service.reset(new Proxy::PublisherImpl(plugin->IsPublisher(), this->meta));
             break;
         case Plugin::StreamCollector:
-            this->service.reset(new Proxy::StreamCollectorImpl(plugin->IsStreamCollector()));
+            this->service.reset(new Proxy::StreamCollectorImpl(plugin->IsStreamCollector(), this->meta));
             break;
         default:
         std::cout << "Fatal: unknown plugin type" << std::endl;
     }
-    builder.reset(new grpc::ServerBuilder());
-    builder->AddListeningPort(ss.str(), this->credentials,
-                            &this->port);
 }
 
 void Plugin::GRPCExportImpl::doRegister() {
-    builder->RegisterService(service.get());
+    if (async_server) {
+        async_server->configure(*builder);
+    } else {
+        builder->RegisterService(service.get());
+    }
     this->server = std::move(builder->BuildAndStart());
+    if (async_server && server) {
+        async_server->start();
+    }
 }
 
 json Plugin::GRPCExportImpl::printPreamble() {
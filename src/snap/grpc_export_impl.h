@@ -23,6 +23,7 @@ limitations under the License.
 #include <json.hpp>
 #include <spdlog/spdlog.h>
 
+#include "snap/async_server.h"
 #include "snap/config.h"
 #include "snap/metric.h"
 
@@ -45,6 +46,12 @@ namespace Plugin {
           _logger = spdlog::stderr_logger_mt("gprcExportImpl");
         }
 
+        ~GRPCExportImpl() {
+          if (async_server && server) {
+            async_server->shutdown(*server);
+          }
+        }
+
     protected:
         int port;
         std::shared_ptr<PluginInterface> plugin;
@@ -52,6 +59,8 @@ namespace Plugin {
         std::shared_ptr<grpc::ServerCredentials> credentials;
         std::unique_ptr<grpc::Service> service;
         std::unique_ptr<grpc::ServerBuilder> builder;
+        // Set in place of service when Meta::async_server is.
+        std::unique_ptr<AsyncServer> async_server;
         std::unique_ptr<grpc::Server> server;
 
         std::shared_ptr<grpc::ServerCredentials> configureCredentials();
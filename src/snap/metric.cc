@@ -12,10 +12,17 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "snap/metric.h"
+#include "snap/metric_pool.h"
+#include "snap/plugin.h"
 
+#include <algorithm>
 #include <ratio>
 #include <sstream>
+#include <thread>
 
+#include <time.h>
+
+#include <google/protobuf/arena.h>
 #include <google/protobuf/repeated_field.h>
 
 
@@ -24,24 +31,27 @@ using std::chrono::duration_cast;
 using std::chrono::nanoseconds;
 using std::chrono::seconds;
 
+using google::protobuf::Arena;
 using google::protobuf::Map;
 using google::protobuf::RepeatedPtrField;
 
 using Plugin::Metric;
 using Plugin::Namespace;
 using Plugin::NamespaceElement;
+using Plugin::NamespaceElementView;
+using Plugin::NamespaceView;
+using Plugin::StringPool;
+using Plugin::TagView;
 
-Metric::Metric() : delete_metric_ptr(true),
-                rpc_metric_ptr(new rpc::Metric),
-                type(DataType::NotSet),
-                config(Config(const_cast<rpc::ConfigMap&>(rpc_metric_ptr->config()))) {}
+Metric::Metric() : rpc_metric_ptr(new rpc::Metric),
+                arena(nullptr),
+                delete_metric_ptr(true) {}
 
 Metric::Metric(Namespace &ns, std::string unit,
             std::string description) :
-                delete_metric_ptr(true),
-                type(DataType::NotSet),
                 rpc_metric_ptr(new rpc::Metric),
-                config(Config(const_cast<rpc::ConfigMap&>(rpc_metric_ptr->config()))) {
+                arena(nullptr),
+                delete_metric_ptr(true) {
     rpc_metric_ptr->set_unit(unit);
     rpc_metric_ptr->set_description(description);
     set_ns(ns);
@@ -49,10 +59,9 @@ Metric::Metric(Namespace &ns, std::string unit,
 
 Metric::Metric(Namespace &&ns, std::string unit,
             std::string description) :
-                delete_metric_ptr(true),
-                type(DataType::NotSet),
                 rpc_metric_ptr(new rpc::Metric),
-                config(Config(const_cast<rpc::ConfigMap&>(rpc_metric_ptr->config()))) {
+                arena(nullptr),
+                delete_metric_ptr(true) {
     rpc_metric_ptr->set_unit(unit);
     rpc_metric_ptr->set_description(description);
     set_ns(ns);
@@ -60,18 +69,75 @@ Metric::Metric(Namespace &&ns, std::string unit,
 
 Metric::Metric(rpc::Metric* metric) :
                 rpc_metric_ptr(metric),
-                type(DataType::NotSet),
-                delete_metric_ptr(false),
-                config(Config(const_cast<rpc::ConfigMap&>(rpc_metric_ptr->config()))) {}
+                arena(metric->GetArena()),
+                delete_metric_ptr(false) {}
+
+Metric::Metric(const Metric& from) : arena(from.arena),
+                                    delete_metric_ptr(from.arena == nullptr) {
+    rpc_metric_ptr = Arena::CreateMessage<rpc::Metric>(arena);
+    *rpc_metric_ptr = *from.rpc_metric_ptr;
+}
 
-Metric::Metric(const Metric& from) : delete_metric_ptr(true),
-                                    config(from.config) {
-    rpc_metric_ptr = new rpc::Metric;
+Metric::Metric(Metric&& from) noexcept :
+                rpc_metric_ptr(from.rpc_metric_ptr),
+                arena(from.arena),
+                memo_ns(std::move(from.memo_ns)),
+                memo_tags(std::move(from.memo_tags)),
+                memo_tags_valid(from.memo_tags_valid),
+                delete_metric_ptr(from.delete_metric_ptr),
+                pool(from.pool),
+                pool_key(from.pool_key) {
+    from.rpc_metric_ptr = nullptr;
+    from.delete_metric_ptr = false;
+    from.pool = nullptr;
+    from.memo_tags_valid = false;
+}
+
+Metric& Metric::operator=(const Metric& from) {
+    if (this == &from) {
+        return *this;
+    }
+    if (rpc_metric_ptr == nullptr) {
+        // a moved-from metric gets fresh storage, the same way a copy would.
+        arena = from.arena;
+        delete_metric_ptr = (arena == nullptr);
+        rpc_metric_ptr = Arena::CreateMessage<rpc::Metric>(arena);
+    }
     *rpc_metric_ptr = *from.rpc_metric_ptr;
+    memo_ns.clear();
+    invalidate_tags();
+    return *this;
+}
+
+Metric& Metric::operator=(Metric&& from) noexcept {
+    if (this == &from) {
+        return *this;
+    }
+    drop_rpc();
+    rpc_metric_ptr = from.rpc_metric_ptr;
+    arena = from.arena;
+    delete_metric_ptr = from.delete_metric_ptr;
+    memo_ns = std::move(from.memo_ns);
+    memo_tags = std::move(from.memo_tags);
+    memo_tags_valid = from.memo_tags_valid;
+    pool = from.pool;
+    pool_key = from.pool_key;
+
+    from.rpc_metric_ptr = nullptr;
+    from.delete_metric_ptr = false;
+    from.pool = nullptr;
+    from.memo_tags_valid = false;
+    return *this;
 }
 
 Metric::~Metric() {
-    if (delete_metric_ptr) {
+    drop_rpc();
+}
+
+void Metric::drop_rpc() {
+    if (pool != nullptr && rpc_metric_ptr != nullptr) {
+        pool->recycle(pool_key, rpc_metric_ptr);
+    } else if (delete_metric_ptr) {
         delete rpc_metric_ptr;
     }
 }
@@ -94,7 +160,7 @@ void Metric::set_ns(Namespace &ns) {
 }
 
 void Metric::set_diagnostic_config(const Config& cfg) {
-    this->config = cfg;
+    Config(*rpc_metric_ptr->mutable_config()) = cfg;
 }
 
 const Namespace& Metric::ns() const {
@@ -102,10 +168,10 @@ const Namespace& Metric::ns() const {
         return memo_ns;
     }
 
-    RepeatedPtrField<rpc::NamespaceElement> rpc_ns = rpc_metric_ptr->namespace_();
+    const RepeatedPtrField<rpc::NamespaceElement>& rpc_ns = rpc_metric_ptr->namespace_();
     memo_ns.reserve(rpc_ns.size());
 
-    for (rpc::NamespaceElement rpc_elem : rpc_ns) {
+    for (const rpc::NamespaceElement& rpc_elem : rpc_ns) {
         memo_ns.push_back({
             rpc_elem.value(),
             rpc_elem.name(),
@@ -115,23 +181,48 @@ const Namespace& Metric::ns() const {
     return memo_ns;
 }
 
+NamespaceView Metric::ns_view() const {
+    return NamespaceView(rpc_metric_ptr->namespace_());
+}
+
+const std::string& Metric::ns_string() const {
+    return ns().get_string();
+}
+
+uint64_t Metric::ns_hash() const {
+    return ns().hash();
+}
+
 void Metric::add_tag(std::pair<std::string, std::string> pair) {
-    // invalidate memoized tags.
-    std::map<std::string, std::string> memo_tags;
     Map<std::string, std::string>* rpc_tags = rpc_metric_ptr->mutable_tags();
-    (*rpc_tags)[pair.first] = pair.second;
+    (*rpc_tags)[pair.first] = std::move(pair.second);
+    invalidate_tags();
+}
+
+void Metric::add_tags(std::initializer_list<std::pair<std::string, std::string>> tags) {
+    add_tags<std::initializer_list<std::pair<std::string, std::string>>>(tags);
+}
+
+void Metric::invalidate_tags() {
+    memo_tags.clear();
+    memo_tags_valid = false;
 }
 
 const std::map<std::string, std::string>& Metric::tags() const {
-    if (memo_tags.size() != 0) {
+    if (memo_tags_valid) {
         return memo_tags;
     }
     const Map<std::string, std::string>& rpc_tags = rpc_metric_ptr->tags();
     memo_tags = std::map<std::string, std::string>(rpc_tags.begin(),
                                                     rpc_tags.end());
+    memo_tags_valid = true;
     return memo_tags;
 }
 
+Plugin::TagView Metric::tag_view() const {
+    return TagView(rpc_metric_ptr->tags());
+}
+
 /**
 * rpc::Time is a structure containing seconds and nanoseconds. To retrieve an
 * accurate timestamp, these two counters must be summed.
@@ -168,47 +259,60 @@ void Metric::set_last_advertised_time(system_clock::time_point tp) {
     set_last_advert_tm(tp);
 }
 
+void Metric::set_timestamps(std::vector<Metric>& metrics, system_clock::time_point tp) {
+    rpc::Time tm;
+    to_rpc_time(tp, &tm);
+    for (Metric& met : metrics) {
+        *met.rpc_metric_ptr->mutable_timestamp() = tm;
+    }
+}
+
+void Metric::set_timestamps(std::vector<Metric>& metrics, ClockSource source) {
+    set_timestamps(metrics, clock_now(source));
+}
+
+void Metric::set_advertised_times(std::vector<Metric>& metrics, ClockSource source) {
+    rpc::Time tm;
+    to_rpc_time(clock_now(source), &tm);
+    for (Metric& met : metrics) {
+        *met.rpc_metric_ptr->mutable_timestamp() = tm;
+        *met.rpc_metric_ptr->mutable_lastadvertisedtime() = tm;
+    }
+}
+
 Metric::DataType Metric::data_type() const {
     return (Metric::DataType)rpc_metric_ptr->data_case();
 }
 
 void Metric::set_data(float data) {
-    type = DataType::Float32;
     rpc_metric_ptr->set_float32_data(data);
 }
 
 void Metric::set_data(double data) {
-    type = DataType::Float64;
     rpc_metric_ptr->set_float64_data(data);
 }
 
 void Metric::set_data(int32_t data) {
-  type = DataType::Int32;
   rpc_metric_ptr->set_int32_data(data);
 }
 
 void Metric::set_data(int64_t data) {
-  type = DataType::Int64;
   rpc_metric_ptr->set_int64_data(data);
 }
 
 void Metric::set_data(uint32_t data) {
-  type = DataType::Uint32;
   rpc_metric_ptr->set_uint32_data(data);
 }
 
 void Metric::set_data(uint64_t data) {
-  type = DataType::Uint64;
   rpc_metric_ptr->set_uint64_data(data);
 }
 
 void Metric::set_data(bool data) {
-  type = DataType::Bool;
   rpc_metric_ptr->set_bool_data(data);
 }
 
 void Metric::set_data(const std::string& data) {
-    type = DataType::String;
     rpc_metric_ptr->set_string_data(data);
 }
 
@@ -244,30 +348,79 @@ const std::string& Metric::get_string_data() const {
     return rpc_metric_ptr->string_data();
 }
 
+void Metric::data_type_mismatch(DataType requested) const {
+    std::ostringstream msg;
+    msg << "metric " << ns_view().get_string() << " holds " << data_type()
+        << " data, not " << requested;
+    throw PluginException(msg.str());
+}
+
 Plugin::Config Metric::get_config() const {
-    return config;
+    return Config(const_cast<rpc::ConfigMap&>(rpc_metric_ptr->config()));
 }
 
 const rpc::Metric* Metric::get_rpc_metric_ptr() const {
     return rpc_metric_ptr;
 }
 
+rpc::Metric* Metric::release_rpc() {
+    rpc::Metric* released = rpc_metric_ptr;
+    if (!delete_metric_ptr) {
+        released = new rpc::Metric;
+        if (arena == nullptr) {
+            released->Swap(rpc_metric_ptr);
+        } else {
+            *released = *rpc_metric_ptr;
+        }
+    }
+    rpc_metric_ptr = nullptr;
+    delete_metric_ptr = false;
+    pool = nullptr;
+    memo_ns.clear();
+    invalidate_tags();
+    return released;
+}
+
+bool Metric::is_pooled() const {
+    return pool != nullptr;
+}
+
+void Metric::move_into(RepeatedPtrField<rpc::Metric>* field) {
+    if (is_pooled()) {
+        *field->Add() = *rpc_metric_ptr;
+    } else {
+        field->AddAllocated(release_rpc());
+    }
+}
+
 void Metric::set_ts(system_clock::time_point tp) {
-    rpc::Time* tm = rpc_metric_ptr->mutable_timestamp();
-    uint64_t nanos = uint64_t(duration_cast<nanoseconds>(
-                            tp.time_since_epoch()).count());
-    tm->set_sec(nanos / std::nano::den);
-    tm->set_nsec(nanos % std::nano::den);
+    to_rpc_time(tp, rpc_metric_ptr->mutable_timestamp());
 }
 
 void Metric::Metric::set_last_advert_tm(system_clock::time_point tp) {
-    rpc::Time* tm = rpc_metric_ptr->mutable_lastadvertisedtime();
+    to_rpc_time(tp, rpc_metric_ptr->mutable_lastadvertisedtime());
+}
+
+void Metric::to_rpc_time(system_clock::time_point tp, rpc::Time* tm) {
     uint64_t nanos = uint64_t(duration_cast<nanoseconds>(
                             tp.time_since_epoch()).count());
     tm->set_sec(nanos / std::nano::den);
     tm->set_nsec(nanos % std::nano::den);
 }
 
+system_clock::time_point Plugin::clock_now(ClockSource source) {
+#ifdef CLOCK_REALTIME_COARSE
+    if (source == RealtimeCoarseClock) {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+            return system_clock::time_point(duration_cast<system_clock::duration>(
+                seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec)));
+        }
+    }
+#endif
+    return system_clock::now();
+}
+
 Namespace::Namespace(std::vector<std::string> ns) {
     for (auto &string_iterator : ns){
         this->namespace_elements.push_back(NamespaceElement(string_iterator));
@@ -278,31 +431,126 @@ Namespace::Namespace(){}
 
 Namespace::~Namespace(){}
 
+Namespace::Namespace(const Namespace& that) :
+                     namespace_elements(that.namespace_elements) {
+    copy_memo(that);
+}
+
+Namespace::Namespace(Namespace&& that) noexcept :
+                     namespace_elements(std::move(that.namespace_elements)),
+                     memo_string(std::move(that.memo_string)),
+                     memo_hash(that.memo_hash),
+                     memo_state(that.memo_state.load(std::memory_order_relaxed)) {
+    that.invalidate();
+}
+
+Namespace& Namespace::operator=(const Namespace& that) {
+    if (this != &that) {
+        namespace_elements = that.namespace_elements;
+        invalidate();
+        copy_memo(that);
+    }
+    return *this;
+}
+
+Namespace& Namespace::operator=(Namespace&& that) noexcept {
+    if (this != &that) {
+        namespace_elements = std::move(that.namespace_elements);
+        memo_string = std::move(that.memo_string);
+        memo_hash = that.memo_hash;
+        memo_state.store(that.memo_state.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+        that.invalidate();
+    }
+    return *this;
+}
+
+void Namespace::copy_memo(const Namespace& that) {
+    // a memo still being filled by another thread is left behind.
+    if (that.memo_state.load(std::memory_order_acquire) == MemoFilled) {
+        memo_string = that.memo_string;
+        memo_hash = that.memo_hash;
+        memo_state.store(MemoFilled, std::memory_order_relaxed);
+    }
+}
+
 const NamespaceElement Namespace::operator[] (int index) const {
     return namespace_elements[index];
 }
 
 NamespaceElement& Namespace::operator[] (int index) {
+    invalidate();
     return namespace_elements[index];
 }
 
-const std::string Namespace::get_string() const {
-    std::stringstream ss;
-    int i = 1;
-    for (const auto& node : namespace_elements) {
-        if (i < namespace_elements.size()) ss << node.get_value() << "/";
-        if (i == namespace_elements.size()) ss << node.get_value();
-        i++;
+const std::string& Namespace::get_string() const {
+    uint8_t state = memo_state.load(std::memory_order_acquire);
+    while (state != MemoFilled) {
+        if (state == MemoEmpty &&
+            memo_state.compare_exchange_strong(state, MemoFilling,
+                                               std::memory_order_acquire)) {
+            fill_memo();
+            memo_state.store(MemoFilled, std::memory_order_release);
+            break;
+        }
+        // another thread is filling the memo; it only takes a join.
+        std::this_thread::yield();
+        state = memo_state.load(std::memory_order_acquire);
+    }
+    return memo_string;
+}
+
+void Namespace::fill_memo() const {
+    memo_string.clear();
+    for (size_t i = 0; i < namespace_elements.size(); i++) {
+        if (i > 0) memo_string += "/";
+        memo_string += namespace_elements[i].get_value();
     }
-    return ss.str();
+
+    // 64-bit FNV-1a
+    memo_hash = 14695981039346656037ULL;
+    for (unsigned char c : memo_string) {
+        memo_hash ^= c;
+        memo_hash *= 1099511628211ULL;
+    }
+}
+
+uint64_t Namespace::hash() const {
+    get_string();
+    return memo_hash;
+}
+
+bool Namespace::operator==(const Namespace& that) const {
+    if (size() != that.size() || hash() != that.hash()) {
+        return false;
+    }
+    for (size_t i = 0; i < namespace_elements.size(); i++) {
+        const NamespaceElement& elem = namespace_elements[i];
+        const NamespaceElement& other = that.namespace_elements[i];
+        if (elem.is_dynamic() != other.is_dynamic() ||
+            elem.get_value() != other.get_value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Namespace::operator!=(const Namespace& that) const {
+    return !(*this == that);
+}
+
+void Namespace::invalidate() {
+    memo_state.store(MemoEmpty, std::memory_order_relaxed);
 }
 
 Namespace& Namespace::add_static_element(std::string value) {
+    invalidate();
     this->namespace_elements.push_back(NamespaceElement(value));
     return *this;
 }
 
 Namespace& Namespace::add_dynamic_element(std::string name, std::string description) {
+    invalidate();
     this->namespace_elements.push_back(NamespaceElement("*",name,description));
     return *this;
 }
@@ -332,6 +580,7 @@ const std::vector<int> Namespace::get_dynamic_indexes() {
 }
 
 void Namespace::clear() {
+    invalidate();
     this->namespace_elements.clear();
 }
 
@@ -340,11 +589,20 @@ unsigned int Namespace::size() const {
 }
 
 void Namespace::push_back(NamespaceElement& element) {
+    invalidate();
     this->namespace_elements.push_back(element);
 }
 
 void Namespace::push_back(NamespaceElement&& element) {
-    this->namespace_elements.push_back(element);
+    invalidate();
+    this->namespace_elements.push_back(std::move(element));
+}
+
+Namespace& Namespace::intern(StringPool& pool) {
+    for (NamespaceElement& element : namespace_elements) {
+        element.intern(pool);
+    }
+    return *this;
 }
 
 void Namespace::reserve(unsigned int size) {
@@ -352,41 +610,175 @@ void Namespace::reserve(unsigned int size) {
 }
 
 NamespaceElement::NamespaceElement(std::string value, std::string name, std::string description) :
-                                   value(value),
-                                   name(name),
-                                   description(description) {}
+                                   value(std::move(value)),
+                                   name(std::move(name)),
+                                   description(std::move(description)) {}
 
-NamespaceElement::NamespaceElement() :
-                                   value(""),
-                                   name(""),
-                                   description("") {}
+NamespaceElement::NamespaceElement() {}
 
 NamespaceElement::~NamespaceElement() {}
 
 void NamespaceElement::set_value(std::string v) {
-    this->value = v;
+    this->value.set(std::move(v));
 }
 
 void NamespaceElement::set_name(std::string n) {
-    this->name = n;    
+    this->name.set(std::move(n));
 }
 
 void NamespaceElement::set_description(std::string d) {
-    this->description = d;
+    this->description.set(std::move(d));
 }
 
-const std::string NamespaceElement::get_value() const {
-    return this->value;
+const std::string& NamespaceElement::get_value() const {
+    return this->value.get();
 }
 
-const std::string NamespaceElement::get_name() const {
-    return this->name;
+const std::string& NamespaceElement::get_name() const {
+    return this->name.get();
 }
 
-const std::string NamespaceElement::get_description() const {
-    return this->description;
+const std::string& NamespaceElement::get_description() const {
+    return this->description.get();
 }
 
 const bool NamespaceElement::is_dynamic() const {
-    return (this->name != "");
+    return !this->name.get().empty();
+}
+
+void NamespaceElement::intern(StringPool& pool) {
+    value.intern(pool);
+    name.intern(pool);
+    description.intern(pool);
+}
+
+void NamespaceElement::Field::intern(StringPool& pool) {
+    if (shared.id() != nullptr) {
+        return;
+    }
+    shared = pool.intern(plain);
+    // the string now lives in the pool.
+    std::string().swap(plain);
+}
+
+NamespaceElementView::NamespaceElementView(const rpc::NamespaceElement& element) :
+                                           element(&element) {}
+
+boost::string_ref NamespaceElementView::value() const {
+    return element->value();
+}
+
+boost::string_ref NamespaceElementView::name() const {
+    return element->name();
+}
+
+boost::string_ref NamespaceElementView::description() const {
+    return element->description();
+}
+
+bool NamespaceElementView::is_dynamic() const {
+    return !element->name().empty();
+}
+
+NamespaceView::NamespaceView(const RepeatedPtrField<rpc::NamespaceElement>& elements) :
+                             elements(&elements) {}
+
+NamespaceElementView NamespaceView::operator[] (int index) const {
+    return NamespaceElementView(elements->Get(index));
+}
+
+unsigned int NamespaceView::size() const {
+    return elements->size();
+}
+
+NamespaceView::const_iterator NamespaceView::begin() const {
+    return const_iterator(elements->begin());
+}
+
+NamespaceView::const_iterator NamespaceView::end() const {
+    return const_iterator(elements->end());
+}
+
+bool NamespaceView::is_dynamic() const {
+    for (const rpc::NamespaceElement& element : *elements) {
+        if (!element.name().empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string NamespaceView::get_string() const {
+    std::string ns;
+    for (int i = 0; i < elements->size(); i++) {
+        if (i > 0) ns += "/";
+        ns += elements->Get(i).value();
+    }
+    return ns;
+}
+
+bool NamespaceView::matches(const NamespaceView& ns) const {
+    if (size() != ns.size()) {
+        return false;
+    }
+    for (int i = 0; i < elements->size(); i++) {
+        const rpc::NamespaceElement& element = elements->Get(i);
+        if (!element.name().empty() || element.value() == "*") {
+            continue;
+        }
+        if (ns[i].value() != boost::string_ref(element.value())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Namespace NamespaceView::to_namespace() const {
+    Namespace ns;
+    ns.reserve(elements->size());
+    for (const rpc::NamespaceElement& element : *elements) {
+        ns.push_back({element.value(), element.name(), element.description()});
+    }
+    return ns;
+}
+
+TagView::TagView(const Map<std::string, std::string>& tags) : tags(&tags) {}
+
+unsigned int TagView::size() const {
+    return tags->size();
+}
+
+bool TagView::empty() const {
+    return tags->empty();
+}
+
+TagView::const_iterator TagView::begin() const {
+    return tags->begin();
+}
+
+TagView::const_iterator TagView::end() const {
+    return tags->end();
+}
+
+bool TagView::contains(const std::string& key) const {
+    return tags->find(key) != tags->end();
+}
+
+boost::string_ref TagView::get(const std::string& key) const {
+    const_iterator it = tags->find(key);
+    if (it == tags->end()) {
+        return boost::string_ref();
+    }
+    return it->second;
+}
+
+std::vector<TagView::Tag> TagView::sorted() const {
+    std::vector<Tag> flat;
+    flat.reserve(tags->size());
+    for (const auto& tag : *tags) {
+        flat.emplace_back(tag.first, tag.second);
+    }
+    std::sort(flat.begin(), flat.end(),
+              [](const Tag& a, const Tag& b) { return a.first < b.first; });
+    return flat;
 }
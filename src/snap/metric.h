@@ -13,18 +13,133 @@ limitations under the License.
 */
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <initializer_list>
+#include <iterator>
 #include <map>
+#include <ostream>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <boost/utility/string_ref.hpp>
+
 #include "snap/rpc/plugin.pb.h"
 
 #include "snap/config.h"
+#include "snap/string_pool.h"
 
 namespace Plugin {
+    class MetricFrameBase;
+    class MetricPool;
+    class MetricPrototype;
+
+    /**
+    * ClockSource selects the clock the library reads when it timestamps
+    * metrics.
+    */
+    enum ClockSource {
+        /**
+        * std::chrono::system_clock, i.e. CLOCK_REALTIME.
+        * The default.
+        */
+        RealtimeClock,
+
+        /**
+        * CLOCK_REALTIME_COARSE: a few milliseconds of resolution, but much
+        * cheaper to read. Falls back to RealtimeClock where not available.
+        */
+        RealtimeCoarseClock
+    };
+
+    /**
+    * clock_now reads the current time from the given clock source.
+    */
+    std::chrono::system_clock::time_point clock_now(ClockSource source);
+
+    /**
+    * NoData is what Metric::visit_data passes to the visitor when the metric
+    * holds no data.
+    */
+    struct NoData {
+        friend std::ostream& operator<<(std::ostream& lhs, NoData) {
+            return lhs << "not set";
+        }
+    };
+
+    /**
+    * MetricDataTraits maps a datapoint type to the rpc::Metric field holding
+    * it, and gets or sets that field. It is specialized for the eight types taken by Metric::set_data, and
+    * for NoData.
+    * @see Metric::get
+    */
+    template <class T> struct MetricDataTraits;
+
+    template <> struct MetricDataTraits<int32_t> {
+        using result_type = int32_t;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kInt32Data;
+        static result_type get(const rpc::Metric& m) { return m.int32_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_int32_data(v); }
+    };
+
+    template <> struct MetricDataTraits<int64_t> {
+        using result_type = int64_t;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kInt64Data;
+        static result_type get(const rpc::Metric& m) { return m.int64_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_int64_data(v); }
+    };
+
+    template <> struct MetricDataTraits<uint32_t> {
+        using result_type = uint32_t;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kUint32Data;
+        static result_type get(const rpc::Metric& m) { return m.uint32_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_uint32_data(v); }
+    };
+
+    template <> struct MetricDataTraits<uint64_t> {
+        using result_type = uint64_t;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kUint64Data;
+        static result_type get(const rpc::Metric& m) { return m.uint64_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_uint64_data(v); }
+    };
+
+    template <> struct MetricDataTraits<float> {
+        using result_type = float;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kFloat32Data;
+        static result_type get(const rpc::Metric& m) { return m.float32_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_float32_data(v); }
+    };
+
+    template <> struct MetricDataTraits<double> {
+        using result_type = double;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kFloat64Data;
+        static result_type get(const rpc::Metric& m) { return m.float64_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_float64_data(v); }
+    };
+
+    template <> struct MetricDataTraits<bool> {
+        using result_type = bool;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kBoolData;
+        static result_type get(const rpc::Metric& m) { return m.bool_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_bool_data(v); }
+    };
+
+    template <> struct MetricDataTraits<std::string> {
+        using result_type = const std::string&;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kStringData;
+        static result_type get(const rpc::Metric& m) { return m.string_data(); }
+        static void set(rpc::Metric& m, result_type v) { m.set_string_data(v); }
+    };
+
+    template <> struct MetricDataTraits<NoData> {
+        using result_type = NoData;
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::DATA_NOT_SET;
+        static result_type get(const rpc::Metric&) { return NoData(); }
+        static void set(rpc::Metric& m, result_type) { m.clear_data(); }
+    };
 
     class NamespaceElement{
         public:
@@ -47,6 +162,11 @@ namespace Plugin {
         */
         ~NamespaceElement();
 
+        NamespaceElement(const NamespaceElement&) = default;
+        NamespaceElement(NamespaceElement&&) = default;
+        NamespaceElement& operator=(const NamespaceElement&) = default;
+        NamespaceElement& operator=(NamespaceElement&&) = default;
+
         /**
         * Setters for value, name and description
         */
@@ -57,9 +177,9 @@ namespace Plugin {
         /**
         * Getters for value, name and description
         */
-        const std::string get_value() const;
-        const std::string get_name() const;
-        const std::string get_description() const;
+        const std::string& get_value() const;
+        const std::string& get_name() const;
+        const std::string& get_description() const;
 
         /**
         * is_dynamic returns true if the namespace element contains data.  A namespace
@@ -67,24 +187,55 @@ namespace Plugin {
         */
         const bool is_dynamic() const;
 
+        /**
+        * intern makes the value, name and description share the copies kept
+        * in `pool`.
+        */
+        void intern(StringPool& pool);
+
         private:
+        /**
+        * Field holds one of the strings of an element. It is kept in place,
+        * like any std::string, until the element is interned; it is then
+        * shared with the copy kept in the pool.
+        */
+        class Field {
+        public:
+            Field() = default;
+            Field(std::string str) : plain(std::move(str)) {}
+
+            const std::string& get() const {
+                return plain.empty() ? shared.str() : plain;
+            }
+            void set(std::string str) {
+                plain = std::move(str);
+                shared = InternedString();
+            }
+            void intern(StringPool& pool);
+
+        private:
+            std::string plain;
+            InternedString shared;
+        };
+
         /**
         * value is the static value of this node in a namespace.
         * When a namespace element is _not_ dynamic, value is used. During
         * metric collection, value should contain the static name for this metric.
+        * @see intern
         */
-        std::string value;
+        Field value;
         /**
         * name is used to describe what this dynamic element is querying against.
         * E.g. in the namespace `/intel/kvm/[vm_id]/cpu_wait` the element at index
         * 2 has the name "vm_id".
         * @see value
         */
-        std::string name;
+        Field name;
         /**
         * description is the description of this namespace element.
         */
-        std::string description;
+        Field description;
 
     };
 
@@ -106,16 +257,51 @@ namespace Plugin {
         */
         ~Namespace();
 
+        /**
+        * Copies carry the cached string and hash along when they are already
+        * computed.
+        */
+        Namespace(const Namespace& that);
+        Namespace(Namespace&& that) noexcept;
+        Namespace& operator=(const Namespace& that);
+        Namespace& operator=(Namespace&& that) noexcept;
+
         /**
         * Overloaded range operators. They return "NamespaceElement" object
         * from given index.
+        * The non-const one drops the cached string and hash, as the element
+        * may be modified through the returned reference. Modifications made
+        * through a reference kept from before a later get_string() or hash()
+        * call are not seen by them.
         */
         const NamespaceElement operator[] (int index) const;
 
-        const std::string get_string() const;
-
         NamespaceElement& operator[] (int index);
 
+        /**
+        * get_string returns the element values joined with "/". It is computed
+        * on first use and cached until the namespace is modified.
+        * Like the other const members, it may be called from several threads
+        * at once, e.g. on the namespace of a shared MetricPrototype; the
+        * first caller fills the cache while the others wait for it.
+        * Modifying the namespace still requires exclusive access.
+        */
+        const std::string& get_string() const;
+
+        /**
+        * hash returns a 64-bit FNV-1a hash of get_string(). It is stable across
+        * processes and cached together with the string.
+        */
+        uint64_t hash() const;
+
+        /**
+        * Namespaces are equal when their elements have equal values and are
+        * either both dynamic or both static. The cached hash only serves to
+        * tell unequal namespaces apart quickly.
+        */
+        bool operator==(const Namespace& that) const;
+        bool operator!=(const Namespace& that) const;
+
         /**
         *  add_static_element adds a static element to the Namespace.  A static
         *  namespaceElement is defined by having an empty Name field.
@@ -128,6 +314,14 @@ namespace Plugin {
         */
         Namespace& add_dynamic_element(std::string name ,std::string description ="");
 
+        /**
+        * intern makes the elements share the copies of their strings kept in
+        * `pool`. Plugins keeping many namespaces which repeat prefixes, names
+        * and descriptions, e.g. a catalog of metric types, can intern them
+        * into a pool of their own.
+        */
+        Namespace& intern(StringPool& pool);
+
         /**
         * Getter for vector of "NamespaceElements"
         */
@@ -180,13 +374,183 @@ namespace Plugin {
         */
         std::vector<NamespaceElement> namespace_elements;
 
+        /**
+        * Cached joined string and its hash. They are written by the thread
+        * which moves memo_state from MemoEmpty to MemoFilling, and read once
+        * memo_state is MemoFilled.
+        * @see get_string
+        */
+        enum MemoState : uint8_t { MemoEmpty, MemoFilling, MemoFilled };
+        mutable std::string memo_string;
+        mutable uint64_t memo_hash = 0;
+        mutable std::atomic<uint8_t> memo_state{MemoEmpty};
+
+        void fill_memo() const;
+        void copy_memo(const Namespace& that);
+        void invalidate();
     };
 
 
+    /**
+    * NamespaceElementView is a read-only view of a namespace element stored in
+    * an rpc::Metric. Its accessors return string_refs into the protobuf
+    * storage, so nothing is copied. A view is valid as long as the metric it
+    * was taken from is alive and its namespace is not modified.
+    */
+    class NamespaceElementView {
+        public:
+        explicit NamespaceElementView(const rpc::NamespaceElement& element);
+
+        /**
+        * Getters for value, name and description
+        */
+        boost::string_ref value() const;
+        boost::string_ref name() const;
+        boost::string_ref description() const;
+
+        /**
+        * is_dynamic returns true if the element has a nonempty name.
+        * @see NamespaceElement::is_dynamic
+        */
+        bool is_dynamic() const;
+
+        private:
+        const rpc::NamespaceElement* element;
+    };
+
+    /**
+    * NamespaceView is a read-only, allocation-free alternative to Namespace
+    * for reading a metric's namespace. It offers indexed access and iteration
+    * over NamespaceElementViews.
+    * @see Metric::ns_view
+    */
+    class NamespaceView {
+        public:
+        class const_iterator : public std::iterator<std::random_access_iterator_tag,
+                                                    NamespaceElementView,
+                                                    std::ptrdiff_t,
+                                                    void,
+                                                    NamespaceElementView> {
+            public:
+            explicit const_iterator(
+                google::protobuf::RepeatedPtrField<rpc::NamespaceElement>::const_iterator it) :
+                it(it) {}
+
+            NamespaceElementView operator*() const { return NamespaceElementView(*it); }
+            NamespaceElementView operator[](std::ptrdiff_t n) const { return NamespaceElementView(it[n]); }
+            const_iterator& operator++() { ++it; return *this; }
+            const_iterator operator++(int) { return const_iterator(it++); }
+            const_iterator& operator--() { --it; return *this; }
+            const_iterator operator--(int) { return const_iterator(it--); }
+            const_iterator& operator+=(std::ptrdiff_t n) { it += n; return *this; }
+            const_iterator& operator-=(std::ptrdiff_t n) { it -= n; return *this; }
+            const_iterator operator+(std::ptrdiff_t n) const { return const_iterator(it + n); }
+            const_iterator operator-(std::ptrdiff_t n) const { return const_iterator(it - n); }
+            std::ptrdiff_t operator-(const const_iterator& that) const { return it - that.it; }
+            bool operator==(const const_iterator& that) const { return it == that.it; }
+            bool operator!=(const const_iterator& that) const { return it != that.it; }
+            bool operator<(const const_iterator& that) const { return it < that.it; }
+
+            private:
+            google::protobuf::RepeatedPtrField<rpc::NamespaceElement>::const_iterator it;
+        };
+
+        explicit NamespaceView(
+            const google::protobuf::RepeatedPtrField<rpc::NamespaceElement>& elements);
+
+        /**
+        * Returns a view of the element at given index.
+        */
+        NamespaceElementView operator[] (int index) const;
+
+        /**
+        * Returns the number of elements.
+        */
+        unsigned int size() const;
+
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        /**
+        * is_dynamic returns true when any of the elements is dynamic.
+        */
+        bool is_dynamic() const;
+
+        /**
+        * Joins the element values with "/", the same way Namespace::get_string
+        * does.
+        */
+        std::string get_string() const;
+
+        /**
+        * matches returns true when `ns` has as many elements as this
+        * namespace and equal values, taking dynamic and "*" elements of this
+        * namespace for any value.
+        */
+        bool matches(const NamespaceView& ns) const;
+
+        /**
+        * Copies the viewed elements into a Namespace.
+        */
+        Namespace to_namespace() const;
+
+        private:
+        const google::protobuf::RepeatedPtrField<rpc::NamespaceElement>* elements;
+    };
+
+    /**
+    * TagView is a read-only view of the tags stored in an rpc::Metric.
+    * Iterating it walks the protobuf map directly, in unspecified order and
+    * without copying. sorted() gives the same tags ordered by key as a flat
+    * vector of string_refs. A view is valid as long as the metric it was
+    * taken from is alive and its tags are not modified.
+    * @see Metric::tag_view
+    */
+    class TagView {
+        public:
+        typedef std::pair<boost::string_ref, boost::string_ref> Tag;
+        typedef google::protobuf::Map<std::string, std::string>::const_iterator const_iterator;
+
+        explicit TagView(const google::protobuf::Map<std::string, std::string>& tags);
+
+        /**
+        * Returns the number of tags.
+        */
+        unsigned int size() const;
+        bool empty() const;
+
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        /**
+        * contains returns true when there is a tag named `key`.
+        */
+        bool contains(const std::string& key) const;
+
+        /**
+        * get returns the value of the tag named `key`, or an empty string_ref
+        * when there is none.
+        */
+        boost::string_ref get(const std::string& key) const;
+
+        /**
+        * sorted returns the tags ordered by key, the order of Metric::tags().
+        * Only the vector is allocated; the strings stay in the metric.
+        */
+        std::vector<Tag> sorted() const;
+
+        private:
+        const google::protobuf::Map<std::string, std::string>* tags;
+    };
+
     /**
     * Metric is the representation of a Metric inside Snap.
     */
     class Metric final {
+        friend class MetricFrameBase;
+        friend class MetricPool;
+        friend class MetricPrototype;
+
     public:
 
         enum DataType {
@@ -236,11 +600,37 @@ namespace Plugin {
         * This constructor is used in the plugin proxies.
         * It's used to wrap the rpc::Metric and rpc::ConfigMap types with the metric
         * type from this library.
+        * When the wrapped metric lives on a protobuf arena, copies of this metric
+        * are allocated from the same arena.
         */
         explicit Metric(rpc::Metric* metric);
 
+        /**
+        * Copies the underlying rpc::Metric. The copy is allocated from the arena
+        * of `from` when it has one, and is released together with that arena.
+        */
         Metric(const Metric& from);
 
+        /**
+        * Takes over the underlying rpc::Metric of `from` together with its
+        * memoized namespace and tags; nothing is copied. `from` is left empty
+        * and may only be assigned to or destroyed.
+        */
+        Metric(Metric&& from) noexcept;
+
+        /**
+        * Copies the contents of `from` into the rpc::Metric this metric
+        * already points to.
+        */
+        Metric& operator=(const Metric& from);
+
+        /**
+        * Releases the rpc::Metric owned by this metric, then takes over the
+        * one of `from`.
+        * @see Metric(Metric&&)
+        */
+        Metric& operator=(Metric&& from) noexcept;
+
         ~Metric();
 
         /**
@@ -250,6 +640,23 @@ namespace Plugin {
         */
         const Namespace& ns() const;
 
+        /**
+        * ns_view returns a view of the metric's namespace that reads straight
+        * from the underlying rpc::Metric. Unlike ns(), it neither copies nor
+        * allocates, which makes it the better fit for collection loops.
+        * @see NamespaceView
+        */
+        NamespaceView ns_view() const;
+
+        /**
+        * ns_string and ns_hash return the joined namespace string and its hash,
+        * cached in the memoized namespace until set_ns is called.
+        * @see Namespace::get_string
+        * @see Namespace::hash
+        */
+        const std::string& ns_string() const;
+        uint64_t ns_hash() const;
+
         /**
         * set_ns sets the namespace of the metric in its `rpc::Metric` ptr.
         * It also invalidates the memoization cache of the namespace if it is
@@ -266,13 +673,29 @@ namespace Plugin {
         const std::map<std::string, std::string>& tags() const;
 
         /**
-        * set_ns adds tags to the metric in its `rpc::Metric` ptr.
-        * It also invalidates the memoization cache of the tags if it is
-        * present.
-        * @see memo_tags_ptr
+        * tag_view returns a view of the metric's tags that reads straight from
+        * the underlying rpc::Metric, without building the std::map of tags().
+        * @see TagView
+        */
+        TagView tag_view() const;
+
+        /**
+        * add_tag adds a tag to the metric in its `rpc::Metric` ptr.
+        * It also invalidates the memoization cache of the tags.
+        * @see memo_tags
         */
         void add_tag(std::pair<std::string, std::string>);
 
+        /**
+        * add_tags adds every key/value pair of `tags`, which can be any range of
+        * pairs, such as a std::map or a std::vector<std::pair<...>>. The tag map
+        * is looked up and the memoized tags are invalidated once for the whole
+        * range.
+        */
+        template <class Range>
+        void add_tags(const Range& tags);
+        void add_tags(std::initializer_list<std::pair<std::string, std::string>> tags);
+
         /**
         * timestamp returns the metric's collection timestamp.
         */
@@ -299,6 +722,27 @@ namespace Plugin {
         */
         void set_last_advertised_time(std::chrono::system_clock::time_point tp);
 
+        /**
+        * set_timestamps sets the timestamp of all `metrics` as tp. The
+        * conversion of tp is done once for the whole batch.
+        */
+        static void set_timestamps(std::vector<Metric>& metrics,
+                                   std::chrono::system_clock::time_point tp);
+
+        /**
+        * Same as above, but with a single read of `source` for the whole batch.
+        */
+        static void set_timestamps(std::vector<Metric>& metrics,
+                                   ClockSource source = RealtimeClock);
+
+        /**
+        * set_advertised_times sets both the timestamp and the last advertised
+        * time of all `metrics` as a single read of `source`, as done for the
+        * metric catalog.
+        */
+        static void set_advertised_times(std::vector<Metric>& metrics,
+                                         ClockSource source = RealtimeClock);
+
         /**
         * set_diagnostic_config is used to apply generated config to specific metric.
         */
@@ -333,19 +777,213 @@ namespace Plugin {
         Config get_config() const;
         const rpc::Metric* get_rpc_metric_ptr() const;
 
+        /**
+        * get returns the datapoint as T, one of the types taken by set_data.
+        * Strings are returned by reference.
+        * Throws PluginException when the metric holds data of another type
+        * or none at all.
+        * @see MetricDataTraits
+        */
+        template <class T>
+        typename MetricDataTraits<T>::result_type get() const;
+
+        /**
+        * try_get stores the datapoint in `out` and returns true when the metric
+        * holds data of type T. Otherwise `out` is left untouched.
+        */
+        template <class T>
+        bool try_get(T& out) const;
+
+        /**
+        * visit_data calls `f` with the datapoint as its own type, or with
+        * NoData when there is none, and returns what `f` returns. The call is
+        * dispatched through a table indexed by the data case, so `f` is
+        * typically a generic lambda:
+        *
+        *     metric.visit_data([&](const auto& v) { os << v; });
+        */
+        template <class F>
+        auto visit_data(F&& f) const -> decltype(f(NoData()));
+
+        /**
+        * extract_data appends the numeric datapoint of each of `metrics` to
+        * `out`, converted to T, so that a batch can be summarized without a
+        * switch per metric. Metrics holding a string or no data contribute
+        * `missing`, which keeps `out` aligned with `metrics`.
+        */
+        template <class T>
+        static void extract_data(const std::vector<Metric>& metrics,
+                                 std::vector<T>& out, T missing = T());
+
+        /**
+        * release_rpc hands the underlying rpc::Metric over to the caller, who
+        * becomes responsible for deleting it. It is meant for the proxies, which
+        * splice the result into a reply with AddAllocated instead of copying it.
+        * A heap message owned by this metric is returned as is. A wrapped heap
+        * message has its contents swapped into the returned one and is left
+        * empty; an arena message is copied to the heap.
+        * Afterwards this metric is empty, as if it had been moved from.
+        */
+        rpc::Metric* release_rpc();
+
+        /**
+        * is_pooled returns true when the metric was acquired from a MetricPool,
+        * to which its rpc::Metric returns when the metric is destroyed.
+        * The proxies copy pooled metrics into replies instead of releasing
+        * them, so that their storage can be recycled.
+        * @see MetricPool
+        */
+        bool is_pooled() const;
+
+        /**
+        * move_into appends the metric to `field`, which is how the proxies
+        * build their replies. The rpc::Metric is spliced in with release_rpc,
+        * unless the metric is pooled, in which case it is copied and stays
+        * with the metric until it goes back to the pool.
+        */
+        void move_into(google::protobuf::RepeatedPtrField<rpc::Metric>* field);
+
         private:
         rpc::Metric* rpc_metric_ptr;
-        Config config;
+
+        /**
+        * arena is the protobuf arena rpc_metric_ptr was allocated from, or
+        * nullptr when the metric lives on the heap.
+        */
+        google::protobuf::Arena* arena;
 
         void inline set_ts(std::chrono::system_clock::time_point tp);
         void inline set_last_advert_tm(std::chrono::system_clock::time_point tp);
+        static void to_rpc_time(std::chrono::system_clock::time_point tp, rpc::Time* tm);
 
         // memoized members
         mutable Namespace memo_ns;
         mutable std::map<std::string, std::string> memo_tags;
+        mutable bool memo_tags_valid = false;
+
+        void invalidate_tags();
 
         bool delete_metric_ptr;
-        DataType type;
+
+        /**
+        * pool is the MetricPool the rpc::Metric is returned to on destruction,
+        * pool_key identifies its shape there.
+        */
+        MetricPool* pool = nullptr;
+        const void* pool_key = nullptr;
+
+        /**
+        * drop_rpc returns the rpc::Metric to its pool or deletes it, if owned.
+        */
+        void drop_rpc();
+
+        /**
+        * data_type_mismatch throws the PluginException reported by get.
+        */
+        [[noreturn]] void data_type_mismatch(DataType requested) const;
+
+        template <class T, class R, class F>
+        static R visit_as(const rpc::Metric& m, F& f) {
+            return f(MetricDataTraits<T>::get(m));
+        }
+
+        /**
+        * NumericAs is the visitor of extract_data.
+        */
+        template <class T>
+        struct NumericAs {
+            T missing;
+
+            template <class V>
+            T operator()(V v) const { return static_cast<T>(v); }
+            T operator()(const std::string&) const { return missing; }
+            T operator()(NoData) const { return missing; }
+        };
     };
 
+    template <class Range>
+    void Metric::add_tags(const Range& tags) {
+        google::protobuf::Map<std::string, std::string>* rpc_tags =
+            rpc_metric_ptr->mutable_tags();
+        for (const auto& tag : tags) {
+            (*rpc_tags)[tag.first] = tag.second;
+        }
+        invalidate_tags();
+    }
+
+    template <class T>
+    typename MetricDataTraits<T>::result_type Metric::get() const {
+        if (rpc_metric_ptr->data_case() != MetricDataTraits<T>::data_case) {
+            data_type_mismatch(static_cast<DataType>(MetricDataTraits<T>::data_case));
+        }
+        return MetricDataTraits<T>::get(*rpc_metric_ptr);
+    }
+
+    template <class T>
+    bool Metric::try_get(T& out) const {
+        if (rpc_metric_ptr->data_case() != MetricDataTraits<T>::data_case) {
+            return false;
+        }
+        out = MetricDataTraits<T>::get(*rpc_metric_ptr);
+        return true;
+    }
+
+    template <class F>
+    auto Metric::visit_data(F&& f) const -> decltype(f(NoData())) {
+        using R = decltype(f(NoData()));
+        using Visit = R (*)(const rpc::Metric&, F&);
+        // Indexed by rpc::Metric::DataCase, which follows the field numbers
+        // of the data oneof. Bytes data has no setter here and reads as NoData.
+        static_assert(rpc::Metric::kStringData == 9 && rpc::Metric::kUint64Data == 17,
+                      "rpc::Metric data fields were renumbered");
+        static constexpr Visit table[] = {
+            &visit_as<NoData, R, F>,        // DATA_NOT_SET
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<NoData, R, F>,
+            &visit_as<std::string, R, F>,   // kStringData
+            &visit_as<float, R, F>,         // kFloat32Data
+            &visit_as<double, R, F>,        // kFloat64Data
+            &visit_as<int32_t, R, F>,       // kInt32Data
+            &visit_as<int64_t, R, F>,       // kInt64Data
+            &visit_as<NoData, R, F>,        // kBytesData
+            &visit_as<bool, R, F>,          // kBoolData
+            &visit_as<uint32_t, R, F>,      // kUint32Data
+            &visit_as<uint64_t, R, F>,      // kUint64Data
+        };
+        const unsigned int data_case = rpc_metric_ptr->data_case();
+        const Visit visit = data_case < sizeof(table) / sizeof(table[0]) ?
+                            table[data_case] : table[0];
+        return visit(*rpc_metric_ptr, f);
+    }
+
+    template <class T>
+    void Metric::extract_data(const std::vector<Metric>& metrics,
+                              std::vector<T>& out, T missing) {
+        static_assert(std::is_arithmetic<T>::value,
+                      "extract_data converts to arithmetic types only");
+        const NumericAs<T> as{missing};
+        out.reserve(out.size() + metrics.size());
+        for (const Metric& met : metrics) {
+            out.push_back(met.visit_data(as));
+        }
+    }
+
 }   // namespace Plugin
+
+namespace std {
+    /**
+    * Lets Namespace be used as a key of unordered containers.
+    */
+    template <>
+    struct hash<Plugin::Namespace> {
+        size_t operator()(const Plugin::Namespace& ns) const {
+            return static_cast<size_t>(ns.hash());
+        }
+    };
+}   // namespace std
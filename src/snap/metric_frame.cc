@@ -0,0 +1,150 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric_frame.h"
+
+#include <sstream>
+
+#include "snap/plugin.h"
+
+using google::protobuf::RepeatedPtrField;
+
+using Plugin::Metric;
+using Plugin::MetricFrameBase;
+using Plugin::MetricPrototype;
+using Plugin::PluginException;
+
+MetricFrameBase::MetricFrameBase(const MetricPrototype& prototype) :
+                                 proto(prototype),
+                                 dynamic_count(prototype.state->dynamic_indexes.size()),
+                                 dictionaries(dynamic_count) {}
+
+MetricFrameBase::~MetricFrameBase() {}
+
+const MetricPrototype& MetricFrameBase::prototype() const {
+    return proto;
+}
+
+size_t MetricFrameBase::size() const {
+    return stamps.size();
+}
+
+uint32_t MetricFrameBase::encode(size_t position, const std::string& value) {
+    Dictionary& dict = dictionaries.at(position);
+    auto found = dict.codes.find(value);
+    if (found != dict.codes.end()) {
+        return found->second;
+    }
+    uint32_t code = dict.values.size();
+    dict.values.push_back(value);
+    dict.codes.emplace(value, code);
+    return code;
+}
+
+const std::string& MetricFrameBase::decode(size_t position, uint32_t code) const {
+    return dictionaries.at(position).values.at(code);
+}
+
+uint32_t MetricFrameBase::code(size_t row, size_t position) const {
+    return codes[row * dynamic_count + position];
+}
+
+const std::vector<MetricFrameBase::time_point>& MetricFrameBase::timestamps() const {
+    return stamps;
+}
+
+void MetricFrameBase::set_timestamp(size_t row, time_point tp) {
+    stamps.at(row) = tp;
+}
+
+void MetricFrameBase::set_timestamps(time_point tp) {
+    for (time_point& stamp : stamps) {
+        stamp = tp;
+    }
+}
+
+void MetricFrameBase::set_timestamps(ClockSource source) {
+    set_timestamps(clock_now(source));
+}
+
+void MetricFrameBase::add_row(const uint32_t* row_codes, size_t count,
+                              time_point ts) {
+    if (count != dynamic_count) {
+        std::stringstream error;
+        error << "metric " << proto.ns().get_string() << " has "
+              << dynamic_count << " dynamic elements, got "
+              << count << " codes";
+        throw PluginException(error.str());
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (row_codes[i] >= dictionaries[i].values.size()) {
+            std::stringstream error;
+            error << "metric " << proto.ns().get_string()
+                  << ": no value encoded as " << row_codes[i]
+                  << " for dynamic element " << i;
+            throw PluginException(error.str());
+        }
+    }
+    codes.insert(codes.end(), row_codes, row_codes + count);
+    stamps.push_back(ts);
+}
+
+void MetricFrameBase::reserve_rows(size_t rows) {
+    codes.reserve(rows * dynamic_count);
+    stamps.reserve(rows);
+}
+
+void MetricFrameBase::clear_rows() {
+    codes.clear();
+    stamps.clear();
+}
+
+void MetricFrameBase::fill(size_t row, rpc::Metric* metric) const {
+    fill_static(row, metric);
+    fill_dynamic(row, metric);
+}
+
+void MetricFrameBase::fill_static(size_t row, rpc::Metric* metric) const {
+    const MetricPrototype::State& state = *proto.state;
+    *metric = state.encoded;
+    for (size_t i = 0; i < dynamic_count; i++) {
+        metric->mutable_namespace_(state.dynamic_indexes[i])
+              ->set_value(dictionaries[i].values[codes[row * dynamic_count + i]]);
+    }
+}
+
+void MetricFrameBase::fill_dynamic(size_t row, rpc::Metric* metric) const {
+    if (stamps[row] != time_point()) {
+        Metric::to_rpc_time(stamps[row], metric->mutable_timestamp());
+    }
+    fill_value(row, metric);
+}
+
+const void* MetricFrameBase::prototype_key() const {
+    return proto.state.get();
+}
+
+void MetricFrameBase::append_to(RepeatedPtrField<rpc::Metric>* field) const {
+    field->Reserve(field->size() + size());
+    for (size_t row = 0; row < size(); row++) {
+        fill(row, field->Add());
+    }
+}
+
+void MetricFrameBase::expand(std::vector<Metric>& metrics) const {
+    metrics.reserve(metrics.size() + size());
+    for (size_t row = 0; row < size(); row++) {
+        metrics.emplace_back();
+        fill(row, metrics.back().rpc_metric_ptr);
+    }
+}
@@ -0,0 +1,245 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "snap/metric.h"
+#include "snap/metric_prototype.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    class ReplyEncoder;
+
+    /**
+    * MetricFrameBase is the part of a MetricFrame that does not depend on its
+    * value type: the prototype shared by all rows, the dictionary encoded
+    * values of the dynamic namespace elements and the timestamp column.
+    * The proxies expand frames of any value type through it.
+    * @see MetricFrame
+    */
+    class MetricFrameBase {
+        friend class ReplyEncoder;
+
+    public:
+        typedef std::chrono::system_clock::time_point time_point;
+
+        virtual ~MetricFrameBase();
+
+        MetricFrameBase(const MetricFrameBase&) = delete;
+        MetricFrameBase& operator=(const MetricFrameBase&) = delete;
+
+        const MetricPrototype& prototype() const;
+
+        /**
+        * size returns the number of rows.
+        */
+        size_t size() const;
+
+        /**
+        * encode returns the code of `value` in the dictionary of the dynamic
+        * element at `position`, counting dynamic elements only. The value is
+        * added on first use. Codes stay valid for the lifetime of the frame,
+        * including across clear(), so collectors encode their series once.
+        */
+        uint32_t encode(size_t position, const std::string& value);
+
+        /**
+        * decode returns the value of `code` in the dictionary of the dynamic
+        * element at `position`.
+        */
+        const std::string& decode(size_t position, uint32_t code) const;
+
+        /**
+        * code returns the code of the dynamic element at `position` in `row`.
+        */
+        uint32_t code(size_t row, size_t position) const;
+
+        /**
+        * The timestamp column. Rows with a default constructed time_point are
+        * expanded without a timestamp.
+        * It is read-only, so that it always has one timestamp per row; use
+        * set_timestamp or set_timestamps to change it.
+        */
+        const std::vector<time_point>& timestamps() const;
+
+        /**
+        * set_timestamp sets the timestamp of `row` as tp.
+        */
+        void set_timestamp(size_t row, time_point tp);
+
+        /**
+        * set_timestamps sets the timestamp of every row as tp.
+        */
+        void set_timestamps(time_point tp);
+
+        /**
+        * Same as above, with a single read of `source`.
+        */
+        void set_timestamps(ClockSource source = RealtimeClock);
+
+        /**
+        * append_to expands every row into an rpc::Metric appended to `field`.
+        * Elements cleared from `field` earlier are reused.
+        */
+        void append_to(google::protobuf::RepeatedPtrField<rpc::Metric>* field) const;
+
+        /**
+        * expand appends every row to `metrics` as a Metric.
+        */
+        void expand(std::vector<Metric>& metrics) const;
+
+    protected:
+        explicit MetricFrameBase(const MetricPrototype& prototype);
+
+        /**
+        * add_row appends the dynamic element codes and timestamp of a row.
+        * Throws PluginException when the number of codes does not match the
+        * number of dynamic elements, or when a code is not in its dictionary.
+        */
+        void add_row(const uint32_t* row_codes, size_t count, time_point ts);
+        void reserve_rows(size_t rows);
+        void clear_rows();
+
+        /**
+        * fill_value sets the data of `metric` to the value of `row`.
+        */
+        virtual void fill_value(size_t row, rpc::Metric* metric) const = 0;
+
+    private:
+        struct Dictionary {
+            std::vector<std::string> values;
+            std::unordered_map<std::string, uint32_t> codes;
+        };
+
+        /**
+        * fill_static copies the prototype into `metric` and sets the values of
+        * its dynamic elements, fill_dynamic sets its timestamp and value; fill
+        * does both.
+        */
+        void fill(size_t row, rpc::Metric* metric) const;
+        void fill_static(size_t row, rpc::Metric* metric) const;
+        void fill_dynamic(size_t row, rpc::Metric* metric) const;
+
+        /**
+        * prototype_key identifies the prototype's shared state, which is the
+        * same for all copies of the prototype.
+        */
+        const void* prototype_key() const;
+
+        MetricPrototype proto;
+        size_t dynamic_count;
+
+        /**
+        * codes holds dynamic_count codes per row, row after row.
+        */
+        std::vector<uint32_t> codes;
+        std::vector<time_point> stamps;
+        std::vector<Dictionary> dictionaries;
+    };
+
+    /**
+    * MetricFrame holds many metrics of a single metric type column-wise:
+    * one prototype for the namespace, unit and description, a contiguous
+    * column of values of type T, a timestamp column and a dictionary encoded
+    * column per dynamic namespace element.
+    * It suits collectors sampling thousands of similar series, such as
+    * per-cpu or per-disk counters, which fill and transform the columns with
+    * plain loops. Rows become rpc::Metrics only when the proxy writes the
+    * reply.
+    * T is one of the types taken by Metric::set_data. A MetricFrame<bool>
+    * stores its values as uint8_t, since std::vector<bool> is a bitset that
+    * cannot be filled with plain loops over references.
+    *
+    *     MetricFrame<double> frame(prototype);
+    *     uint32_t cpu0 = frame.encode(0, "cpu0");
+    *     frame.add({cpu0}, 0.25);
+    *     double* values = frame.values_data();
+    *     for (size_t i = 0; i < frame.size(); i++) values[i] *= 100;
+    *
+    * @see CollectorInterface::collect_frames
+    */
+    template <class T>
+    class MetricFrame final : public MetricFrameBase {
+    public:
+        typedef typename std::conditional<std::is_same<T, bool>::value,
+                                          uint8_t, T>::type value_type;
+
+        explicit MetricFrame(const MetricPrototype& prototype) :
+            MetricFrameBase(prototype) {}
+
+        /**
+        * reserve reserves room for `rows` rows in every column.
+        */
+        void reserve(size_t rows) {
+            reserve_rows(rows);
+            column.reserve(rows);
+        }
+
+        /**
+        * add appends a row made of the codes of its dynamic elements, in
+        * order, its value and optionally its timestamp.
+        * @see encode
+        */
+        void add(std::initializer_list<uint32_t> row_codes, T value,
+                 time_point ts = time_point()) {
+            add_row(row_codes.begin(), row_codes.size(), ts);
+            column.push_back(value);
+        }
+
+        void add(const std::vector<uint32_t>& row_codes, T value,
+                 time_point ts = time_point()) {
+            add_row(row_codes.data(), row_codes.size(), ts);
+            column.push_back(value);
+        }
+
+        /**
+        * The value column. It holds exactly size() values, one per row, and
+        * is modified in place through values_data or value, which throws
+        * std::out_of_range past the last row. Rows are only added with add
+        * and removed with clear.
+        */
+        const std::vector<value_type>& values() const { return column; }
+        value_type* values_data() { return column.data(); }
+        const value_type* values_data() const { return column.data(); }
+        value_type& value(size_t row) { return column.at(row); }
+        const value_type& value(size_t row) const { return column.at(row); }
+
+        /**
+        * clear removes all rows, keeping the dictionaries and the capacity of
+        * the columns for the next cycle.
+        */
+        void clear() {
+            clear_rows();
+            column.clear();
+        }
+
+    protected:
+        void fill_value(size_t row, rpc::Metric* metric) const override {
+            MetricDataTraits<T>::set(*metric, column[row]);
+        }
+
+    private:
+        std::vector<value_type> column;
+    };
+
+    typedef std::vector<std::unique_ptr<MetricFrameBase>> MetricFrames;
+}  // namespace Plugin
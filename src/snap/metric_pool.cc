@@ -0,0 +1,99 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric_pool.h"
+
+using Plugin::Metric;
+using Plugin::MetricPool;
+using Plugin::MetricPrototype;
+
+MetricPool::~MetricPool() {
+    for (auto& shape : shapes) {
+        for (rpc::Metric* rpc_metric : shape.second.idle) {
+            delete rpc_metric;
+        }
+    }
+}
+
+Metric MetricPool::acquire(const MetricPrototype& prototype) {
+    rpc::Metric* recycled = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = shapes.find(prototype.state.get());
+        if (it != shapes.end() && !it->second.idle.empty()) {
+            recycled = it->second.idle.back();
+            it->second.idle.pop_back();
+        }
+    }
+    return adopt(prototype, recycled);
+}
+
+Metric MetricPool::acquire(const MetricPrototype& prototype,
+                           const std::vector<std::string>& dynamic_values) {
+    const std::vector<int>& indexes = prototype.state->dynamic_indexes;
+    if (dynamic_values.size() != indexes.size()) {
+        // let the prototype report the mismatch.
+        return prototype.make(dynamic_values);
+    }
+    Metric met = acquire(prototype);
+    for (size_t i = 0; i < dynamic_values.size(); i++) {
+        met.rpc_metric_ptr->mutable_namespace_(indexes[i])->set_value(dynamic_values[i]);
+    }
+    return met;
+}
+
+size_t MetricPool::idle() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t count = 0;
+    for (auto& shape : shapes) {
+        count += shape.second.idle.size();
+    }
+    return count;
+}
+
+Metric MetricPool::adopt(const MetricPrototype& prototype, rpc::Metric* recycled) {
+    if (recycled != nullptr) {
+        // the namespace, unit and description may have been changed by the
+        // previous owner; copying over them reuses their storage.
+        const rpc::Metric& encoded = prototype.state->encoded;
+        *recycled->mutable_namespace_() = encoded.namespace_();
+        recycled->set_unit(encoded.unit());
+        recycled->set_description(encoded.description());
+    }
+    Metric met = recycled != nullptr ? Metric(recycled) : prototype.make();
+    met.delete_metric_ptr = true;
+    met.pool = this;
+    met.pool_key = prototype.state.get();
+    if (recycled == nullptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        Shape& shape = shapes[met.pool_key];
+        if (!shape.prototype) {
+            shape.prototype = prototype.state;
+        }
+    }
+    return met;
+}
+
+void MetricPool::recycle(const void* key, rpc::Metric* rpc_metric) {
+    rpc_metric->clear_data();
+    rpc_metric->clear_timestamp();
+    rpc_metric->clear_lastadvertisedtime();
+    // Map::clear and Message::Clear keep the storage of tags and config.
+    rpc_metric->mutable_tags()->clear();
+    if (rpc_metric->has_config()) {
+        rpc_metric->mutable_config()->Clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    shapes[key].idle.push_back(rpc_metric);
+}
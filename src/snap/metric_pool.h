@@ -0,0 +1,83 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snap/metric.h"
+#include "snap/metric_prototype.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    /**
+    * MetricPool recycles the rpc::Metric storage of metrics across collection
+    * cycles.
+    * Metrics are acquired for a MetricPrototype. When such a metric is
+    * destroyed, e.g. after the proxy has copied it into the reply, its
+    * rpc::Metric goes back to the pool with its data, timestamps, tags and
+    * config cleared. The next metric acquired for the same prototype reuses
+    * it: its namespace, unit and description are reset to the prototype's,
+    * and all of its fields keep the capacity of their storage.
+    * The pool is safe to use from multiple threads, and must outlive the
+    * metrics acquired from it.
+    */
+    class MetricPool {
+    public:
+        MetricPool() = default;
+        MetricPool(const MetricPool&) = delete;
+        MetricPool& operator=(const MetricPool&) = delete;
+        ~MetricPool();
+
+        /**
+        * acquire returns a metric shaped by `prototype`, recycled when
+        * possible. Its data, timestamps, tags and config are not set, just
+        * like those of a metric made by the prototype. A recycled metric may
+        * carry an empty config rather than none.
+        */
+        Metric acquire(const MetricPrototype& prototype);
+
+        /**
+        * Same as above, but the values of the dynamic namespace elements are
+        * set to `dynamic_values`, in order.
+        * @see MetricPrototype::make
+        */
+        Metric acquire(const MetricPrototype& prototype,
+                       const std::vector<std::string>& dynamic_values);
+
+        /**
+        * idle returns the number of rpc::Metrics waiting to be reused.
+        */
+        size_t idle() const;
+
+    private:
+        friend class Metric;
+
+        struct Shape {
+            // keeps the prototype state alive, so that its address, which
+            // is the key of the shape, cannot be reused by another one.
+            std::shared_ptr<const MetricPrototype::State> prototype;
+            std::vector<rpc::Metric*> idle;
+        };
+
+        Metric adopt(const MetricPrototype& prototype, rpc::Metric* recycled);
+        void recycle(const void* key, rpc::Metric* rpc_metric);
+
+        mutable std::mutex mtx;
+        std::unordered_map<const void*, Shape> shapes;
+    };
+}  // namespace Plugin
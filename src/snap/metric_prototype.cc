@@ -0,0 +1,77 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric_prototype.h"
+
+#include <sstream>
+
+#include "snap/plugin.h"
+
+using Plugin::Metric;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::NamespaceElement;
+using Plugin::PluginException;
+
+MetricPrototype::MetricPrototype(const Namespace& ns, const std::string& unit,
+                                 const std::string& description) {
+    std::shared_ptr<State> built = std::make_shared<State>();
+    built->ns = ns;
+    for (unsigned int i = 0; i < ns.size(); i++) {
+        const NamespaceElement elem = ns[i];
+        rpc::NamespaceElement* rpc_elem = built->encoded.add_namespace_();
+        rpc_elem->set_value(elem.get_value());
+        rpc_elem->set_name(elem.get_name());
+        rpc_elem->set_description(elem.get_description());
+        if (elem.is_dynamic()) {
+            built->dynamic_indexes.push_back(i);
+        }
+    }
+    built->encoded.set_unit(unit);
+    built->encoded.set_description(description);
+    state = std::move(built);
+}
+
+const Namespace& MetricPrototype::ns() const {
+    return state->ns;
+}
+
+const std::string& MetricPrototype::unit() const {
+    return state->encoded.unit();
+}
+
+const std::string& MetricPrototype::description() const {
+    return state->encoded.description();
+}
+
+Metric MetricPrototype::make() const {
+    Metric met;
+    *met.rpc_metric_ptr = state->encoded;
+    return met;
+}
+
+Metric MetricPrototype::make(const std::vector<std::string>& dynamic_values) const {
+    if (dynamic_values.size() != state->dynamic_indexes.size()) {
+        std::stringstream error;
+        error << "metric " << state->ns.get_string() << " has "
+              << state->dynamic_indexes.size() << " dynamic elements, got "
+              << dynamic_values.size() << " values";
+        throw PluginException(error.str());
+    }
+    Metric met = make();
+    for (size_t i = 0; i < dynamic_values.size(); i++) {
+        met.rpc_metric_ptr->mutable_namespace_(state->dynamic_indexes[i])
+                          ->set_value(dynamic_values[i]);
+    }
+    return met;
+}
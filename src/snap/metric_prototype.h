@@ -0,0 +1,70 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "snap/metric.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    /**
+    * MetricPrototype holds the parts shared by all instances of a metric type:
+    * its namespace, unit and description. They are encoded into an
+    * rpc::Metric once, when the prototype is created, and metrics are stamped
+    * out of it with a single protobuf copy instead of rebuilding the
+    * namespace for every instance.
+    * A prototype is immutable; copies share the encoded metric.
+    * Plugins typically keep their prototypes for their whole lifetime and use
+    * them both for the catalog returned from get_metric_types and for the
+    * metrics returned from collect_metrics.
+    */
+    class MetricPrototype {
+    public:
+        MetricPrototype(const Namespace& ns, const std::string& unit = "",
+                        const std::string& description = "");
+
+        const Namespace& ns() const;
+        const std::string& unit() const;
+        const std::string& description() const;
+
+        /**
+        * make returns a new metric carrying the prototype's namespace, unit
+        * and description, ready to have its data set.
+        */
+        Metric make() const;
+
+        /**
+        * Same as above, but the values of the dynamic namespace elements are
+        * set to `dynamic_values`, in order.
+        * Throws PluginException when the number of values does not match the
+        * number of dynamic elements.
+        */
+        Metric make(const std::vector<std::string>& dynamic_values) const;
+
+    private:
+        friend class MetricFrameBase;
+        friend class MetricPool;
+
+        struct State {
+            Namespace ns;
+            std::vector<int> dynamic_indexes;
+            rpc::Metric encoded;
+        };
+
+        std::shared_ptr<const State> state;
+    };
+}  // namespace Plugin
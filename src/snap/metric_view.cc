@@ -0,0 +1,350 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric_view.h"
+
+#include <sstream>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "snap/plugin.h"
+
+using std::chrono::system_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+using Plugin::Metric;
+using Plugin::MetricBatchView;
+using Plugin::MetricView;
+using Plugin::PluginException;
+
+namespace {
+    constexpr uint32_t tag_of(int field, WireFormatLite::WireType type) {
+        return (static_cast<uint32_t>(field) << 3) | type;
+    }
+
+    constexpr uint32_t bytes_tag(int field) {
+        return tag_of(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    }
+
+    constexpr uint32_t varint_tag(int field) {
+        return tag_of(field, WireFormatLite::WIRETYPE_VARINT);
+    }
+
+    const uint8_t* begin_of(boost::string_ref wire) {
+        return reinterpret_cast<const uint8_t*>(wire.data());
+    }
+
+    /**
+    * read_bytes reads a length delimited field, leaving `out` pointing into
+    * the buffer `in` reads from, which starts at `base`.
+    */
+    bool read_bytes(CodedInputStream& in, const char* base, boost::string_ref& out) {
+        uint32_t size;
+        if (!in.ReadVarint32(&size)) {
+            return false;
+        }
+        const int pos = in.CurrentPosition();
+        if (!in.Skip(size)) {
+            return false;
+        }
+        out = boost::string_ref(base + pos, size);
+        return true;
+    }
+
+    bool skip_field(CodedInputStream& in, uint32_t tag) {
+        return WireFormatLite::SkipField(&in, tag);
+    }
+
+    /**
+    * parse_time reads an rpc::Time. Fields missing from `wire` leave `sec`
+    * and `nsec` as they are, so repeated occurrences merge like protobuf's.
+    */
+    bool parse_time(boost::string_ref wire, int64_t& sec, int64_t& nsec) {
+        CodedInputStream in(begin_of(wire), wire.size());
+        while (uint32_t tag = in.ReadTag()) {
+            uint64_t v;
+            switch (tag) {
+                case varint_tag(rpc::Time::kSecFieldNumber):
+                    if (!in.ReadVarint64(&v)) return false;
+                    sec = static_cast<int64_t>(v);
+                    break;
+                case varint_tag(rpc::Time::kNsecFieldNumber):
+                    if (!in.ReadVarint64(&v)) return false;
+                    nsec = static_cast<int64_t>(v);
+                    break;
+                default:
+                    if (!skip_field(in, tag)) return false;
+            }
+        }
+        return in.ConsumedEntireMessage();
+    }
+
+    system_clock::time_point to_time_point(int64_t sec, int64_t nsec) {
+        return system_clock::time_point(
+            duration_cast<system_clock::duration>(seconds(sec) + nanoseconds(nsec)));
+    }
+}  // namespace
+
+unsigned int MetricView::ns_size() const {
+    return ns_end - ns_begin;
+}
+
+const MetricView::Element& MetricView::ns_element(unsigned int index) const {
+    return batch->elements[ns_begin + index];
+}
+
+std::string MetricView::ns_string() const {
+    std::string result;
+    for (uint32_t i = ns_begin; i < ns_end; i++) {
+        if (i != ns_begin) {
+            result += '/';
+        }
+        const boost::string_ref value = batch->elements[i].value;
+        result.append(value.data(), value.size());
+    }
+    return result;
+}
+
+unsigned int MetricView::tags_size() const {
+    return tags_end - tags_begin;
+}
+
+const MetricView::Tag& MetricView::tag(unsigned int index) const {
+    return batch->tags[tags_begin + index];
+}
+
+boost::string_ref MetricView::tag_value(boost::string_ref key) const {
+    for (uint32_t i = tags_end; i > tags_begin; i--) {
+        const Tag& tag = batch->tags[i - 1];
+        if (tag.first == key) {
+            return tag.second;
+        }
+    }
+    return boost::string_ref();
+}
+
+boost::string_ref MetricView::unit() const {
+    return unit_str;
+}
+
+boost::string_ref MetricView::description() const {
+    return description_str;
+}
+
+int64_t MetricView::version() const {
+    return version_num;
+}
+
+system_clock::time_point MetricView::timestamp() const {
+    return to_time_point(ts_sec, ts_nsec);
+}
+
+system_clock::time_point MetricView::last_advertised_time() const {
+    return to_time_point(adv_sec, adv_nsec);
+}
+
+Metric::DataType MetricView::data_type() const {
+    return static_cast<Metric::DataType>(data_case);
+}
+
+boost::string_ref MetricView::wire() const {
+    return wire_bytes;
+}
+
+void MetricView::data_type_mismatch(Metric::DataType requested) const {
+    std::ostringstream msg;
+    msg << "metric " << ns_string() << " holds " << data_type()
+        << " data, not " << requested;
+    throw PluginException(msg.str());
+}
+
+const std::vector<MetricView>& MetricBatchView::metrics() const {
+    return views;
+}
+
+rpc::ConfigMap& MetricBatchView::config() {
+    return config_map;
+}
+
+void MetricBatchView::clear() {
+    views.clear();
+    elements.clear();
+    tags.clear();
+    config_map.Clear();
+}
+
+bool MetricBatchView::parse(boost::string_ref wire) {
+    clear();
+    CodedInputStream in(begin_of(wire), wire.size());
+    bool ok = true;
+    while (uint32_t tag = in.ReadTag()) {
+        boost::string_ref field;
+        switch (tag) {
+            case bytes_tag(rpc::PubProcArg::kMetricsFieldNumber):
+                views.emplace_back();
+                ok = read_bytes(in, wire.data(), field) && parse_metric(field, views.back());
+                break;
+            case bytes_tag(rpc::PubProcArg::kConfigFieldNumber):
+                ok = read_bytes(in, wire.data(), field) && parse_config(field);
+                break;
+            default:
+                ok = skip_field(in, tag);
+        }
+        if (!ok) {
+            break;
+        }
+    }
+    if (!ok || !in.ConsumedEntireMessage()) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool MetricBatchView::parse_config(boost::string_ref wire) {
+    CodedInputStream in(begin_of(wire), wire.size());
+    return config_map.MergeFromCodedStream(&in);
+}
+
+bool MetricBatchView::parse_metric(boost::string_ref wire, MetricView& view) {
+    view.batch = this;
+    view.wire_bytes = wire;
+    view.ns_begin = view.ns_end = elements.size();
+    view.tags_begin = view.tags_end = tags.size();
+
+    CodedInputStream in(begin_of(wire), wire.size());
+    while (uint32_t tag = in.ReadTag()) {
+        boost::string_ref field;
+        uint64_t v;
+        uint32_t v32;
+        bool ok = true;
+        switch (tag) {
+            case bytes_tag(rpc::Metric::kNamespaceFieldNumber):
+                ok = read_bytes(in, wire.data(), field) && parse_element(field);
+                view.ns_end = elements.size();
+                break;
+            case varint_tag(rpc::Metric::kVersionFieldNumber):
+                ok = in.ReadVarint64(&v);
+                view.version_num = static_cast<int64_t>(v);
+                break;
+            case bytes_tag(rpc::Metric::kLastAdvertisedTimeFieldNumber):
+                ok = read_bytes(in, wire.data(), field) &&
+                     parse_time(field, view.adv_sec, view.adv_nsec);
+                break;
+            case bytes_tag(rpc::Metric::kTagsFieldNumber):
+                ok = read_bytes(in, wire.data(), field) && parse_tag(field);
+                view.tags_end = tags.size();
+                break;
+            case bytes_tag(rpc::Metric::kTimestampFieldNumber):
+                ok = read_bytes(in, wire.data(), field) &&
+                     parse_time(field, view.ts_sec, view.ts_nsec);
+                break;
+            case bytes_tag(rpc::Metric::kUnitFieldNumber):
+                ok = read_bytes(in, wire.data(), view.unit_str);
+                break;
+            case bytes_tag(rpc::Metric::kDescriptionFieldNumber):
+                ok = read_bytes(in, wire.data(), view.description_str);
+                break;
+            case bytes_tag(rpc::Metric::kStringDataFieldNumber):
+            case bytes_tag(rpc::Metric::kBytesDataFieldNumber):
+                ok = read_bytes(in, wire.data(), view.data_str);
+                view.data_case = tag >> 3;
+                break;
+            case tag_of(rpc::Metric::kFloat32DataFieldNumber, WireFormatLite::WIRETYPE_FIXED32):
+                ok = in.ReadLittleEndian32(&v32);
+                view.data_bits = v32;
+                view.data_case = rpc::Metric::kFloat32Data;
+                break;
+            case tag_of(rpc::Metric::kFloat64DataFieldNumber, WireFormatLite::WIRETYPE_FIXED64):
+                ok = in.ReadLittleEndian64(&view.data_bits);
+                view.data_case = rpc::Metric::kFloat64Data;
+                break;
+            case varint_tag(rpc::Metric::kInt32DataFieldNumber):
+            case varint_tag(rpc::Metric::kInt64DataFieldNumber):
+            case varint_tag(rpc::Metric::kBoolDataFieldNumber):
+            case varint_tag(rpc::Metric::kUint32DataFieldNumber):
+            case varint_tag(rpc::Metric::kUint64DataFieldNumber):
+                ok = in.ReadVarint64(&view.data_bits);
+                view.data_case = tag >> 3;
+                break;
+            default:
+                // The config of the metric is skipped here as well.
+                ok = skip_field(in, tag);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return in.ConsumedEntireMessage();
+}
+
+bool MetricBatchView::parse_element(boost::string_ref wire) {
+    MetricView::Element element;
+    CodedInputStream in(begin_of(wire), wire.size());
+    while (uint32_t tag = in.ReadTag()) {
+        bool ok;
+        switch (tag) {
+            case bytes_tag(rpc::NamespaceElement::kValueFieldNumber):
+                ok = read_bytes(in, wire.data(), element.value);
+                break;
+            case bytes_tag(rpc::NamespaceElement::kDescriptionFieldNumber):
+                ok = read_bytes(in, wire.data(), element.description);
+                break;
+            case bytes_tag(rpc::NamespaceElement::kNameFieldNumber):
+                ok = read_bytes(in, wire.data(), element.name);
+                break;
+            default:
+                ok = skip_field(in, tag);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (!in.ConsumedEntireMessage()) {
+        return false;
+    }
+    elements.push_back(element);
+    return true;
+}
+
+bool MetricBatchView::parse_tag(boost::string_ref wire) {
+    MetricView::Tag tag_entry;
+    CodedInputStream in(begin_of(wire), wire.size());
+    while (uint32_t tag = in.ReadTag()) {
+        bool ok;
+        switch (tag) {
+            case bytes_tag(1):
+                ok = read_bytes(in, wire.data(), tag_entry.first);
+                break;
+            case bytes_tag(2):
+                ok = read_bytes(in, wire.data(), tag_entry.second);
+                break;
+            default:
+                ok = skip_field(in, tag);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (!in.ConsumedEntireMessage()) {
+        return false;
+    }
+    tags.push_back(tag_entry);
+    return true;
+}
@@ -0,0 +1,289 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+#include "snap/metric.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    class MetricBatchView;
+
+    /**
+    * MetricViewDataTraits maps a datapoint type to the rpc::Metric field
+    * holding it, and decodes that field from its wire value. It is
+    * specialized for the arithmetic types of MetricDataTraits, for
+    * boost::string_ref standing in for std::string, and for NoData.
+    * @see MetricView::get
+    */
+    template <class T> struct MetricViewDataTraits;
+
+    template <> struct MetricViewDataTraits<int32_t> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kInt32Data;
+        static int32_t decode(uint64_t bits, boost::string_ref) { return static_cast<int32_t>(bits); }
+    };
+
+    template <> struct MetricViewDataTraits<int64_t> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kInt64Data;
+        static int64_t decode(uint64_t bits, boost::string_ref) { return static_cast<int64_t>(bits); }
+    };
+
+    template <> struct MetricViewDataTraits<uint32_t> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kUint32Data;
+        static uint32_t decode(uint64_t bits, boost::string_ref) { return static_cast<uint32_t>(bits); }
+    };
+
+    template <> struct MetricViewDataTraits<uint64_t> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kUint64Data;
+        static uint64_t decode(uint64_t bits, boost::string_ref) { return bits; }
+    };
+
+    template <> struct MetricViewDataTraits<float> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kFloat32Data;
+        static float decode(uint64_t bits, boost::string_ref) {
+            uint32_t low = static_cast<uint32_t>(bits);
+            float v;
+            std::memcpy(&v, &low, sizeof(v));
+            return v;
+        }
+    };
+
+    template <> struct MetricViewDataTraits<double> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kFloat64Data;
+        static double decode(uint64_t bits, boost::string_ref) {
+            double v;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+    };
+
+    template <> struct MetricViewDataTraits<bool> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kBoolData;
+        static bool decode(uint64_t bits, boost::string_ref) { return bits != 0; }
+    };
+
+    template <> struct MetricViewDataTraits<boost::string_ref> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::kStringData;
+        static boost::string_ref decode(uint64_t, boost::string_ref str) { return str; }
+    };
+
+    template <> struct MetricViewDataTraits<NoData> {
+        static constexpr rpc::Metric::DataCase data_case = rpc::Metric::DATA_NOT_SET;
+        static NoData decode(uint64_t, boost::string_ref) { return NoData(); }
+    };
+
+    /**
+    * MetricView is a read-only view of a metric in its serialized form, as
+    * received in a request. Strings are returned as string_refs into the
+    * request buffer and values are decoded on access, so reading a metric
+    * through a view allocates nothing.
+    * Views are created by MetricBatchView::parse and are valid as long as
+    * the batch and the buffer it parsed are.
+    * The metric's own config is not parsed; wire() gives the serialized
+    * rpc::Metric for the rare publisher needing the full message.
+    */
+    class MetricView final {
+        friend class MetricBatchView;
+
+    public:
+        typedef std::pair<boost::string_ref, boost::string_ref> Tag;
+
+        /**
+        * Element is a namespace element as found in the request.
+        */
+        struct Element {
+            boost::string_ref value;
+            boost::string_ref name;
+            boost::string_ref description;
+
+            /**
+            * @see NamespaceElement::is_dynamic
+            */
+            bool is_dynamic() const { return !name.empty(); }
+        };
+
+        /**
+        * Returns the number of namespace elements.
+        */
+        unsigned int ns_size() const;
+
+        /**
+        * Returns the namespace element at given index.
+        */
+        const Element& ns_element(unsigned int index) const;
+
+        /**
+        * Joins the element values with "/", the same way Namespace::get_string
+        * does. This is the one accessor allocating a string.
+        */
+        std::string ns_string() const;
+
+        /**
+        * Returns the number of tags, in the order they were received.
+        */
+        unsigned int tags_size() const;
+        const Tag& tag(unsigned int index) const;
+
+        /**
+        * tag_value returns the value of the tag named `key`, or an empty
+        * string_ref when there is none. When a key was sent more than once the
+        * last value wins, as it does when the request is parsed by protobuf.
+        */
+        boost::string_ref tag_value(boost::string_ref key) const;
+
+        /**
+        * Getters for the remaining scalar fields.
+        */
+        boost::string_ref unit() const;
+        boost::string_ref description() const;
+        int64_t version() const;
+        std::chrono::system_clock::time_point timestamp() const;
+        std::chrono::system_clock::time_point last_advertised_time() const;
+
+        /**
+        * data_type returns the type of the datapoint.
+        * @see Metric::data_type
+        */
+        Metric::DataType data_type() const;
+
+        /**
+        * get returns the datapoint as T, one of the types of
+        * MetricViewDataTraits. It throws a PluginException when the metric
+        * holds data of another type.
+        * @see Metric::get
+        */
+        template <class T>
+        T get() const;
+
+        /**
+        * try_get stores the datapoint in `out` and returns true when the metric
+        * holds data of type T. Otherwise `out` is left untouched.
+        */
+        template <class T>
+        bool try_get(T& out) const;
+
+        /**
+        * visit_data calls `f` with the datapoint as its own type, string data
+        * as a boost::string_ref, or with NoData when there is none, and
+        * returns what `f` returns.
+        * @see Metric::visit_data
+        */
+        template <class F>
+        auto visit_data(F&& f) const -> decltype(f(NoData()));
+
+        /**
+        * wire returns the serialized rpc::Metric the view was parsed from.
+        */
+        boost::string_ref wire() const;
+
+    private:
+        const MetricBatchView* batch = nullptr;
+        boost::string_ref wire_bytes;
+        uint32_t ns_begin = 0, ns_end = 0;
+        uint32_t tags_begin = 0, tags_end = 0;
+        boost::string_ref unit_str;
+        boost::string_ref description_str;
+        int64_t version_num = 0;
+        int64_t ts_sec = 0, ts_nsec = 0;
+        int64_t adv_sec = 0, adv_nsec = 0;
+        int data_case = rpc::Metric::DATA_NOT_SET;
+        uint64_t data_bits = 0;
+        boost::string_ref data_str;
+
+        /**
+        * data_type_mismatch throws the PluginException reported by get.
+        */
+        [[noreturn]] void data_type_mismatch(Metric::DataType requested) const;
+    };
+
+    /**
+    * MetricBatchView parses the metrics of a serialized rpc::PubProcArg into
+    * MetricViews, without copying any string out of the buffer. Only the
+    * request config, which is small and needed as an rpc::ConfigMap by
+    * Config, is parsed into an owned message.
+    * A batch can be reused for the next request; its vectors keep their
+    * capacity.
+    * @see PublisherInterface::publish_metric_views
+    */
+    class MetricBatchView final {
+        friend class MetricView;
+
+    public:
+        MetricBatchView() = default;
+        MetricBatchView(const MetricBatchView&) = delete;
+        MetricBatchView& operator=(const MetricBatchView&) = delete;
+
+        /**
+        * parse reads `wire`, a serialized rpc::PubProcArg, which must outlive
+        * the views. It returns false when `wire` is malformed, in which case
+        * the batch holds no metrics.
+        */
+        bool parse(boost::string_ref wire);
+
+        const std::vector<MetricView>& metrics() const;
+        rpc::ConfigMap& config();
+
+    private:
+        std::vector<MetricView> views;
+        std::vector<MetricView::Element> elements;
+        std::vector<MetricView::Tag> tags;
+        rpc::ConfigMap config_map;
+
+        bool parse_config(boost::string_ref wire);
+        bool parse_metric(boost::string_ref wire, MetricView& view);
+        bool parse_element(boost::string_ref wire);
+        bool parse_tag(boost::string_ref wire);
+        void clear();
+    };
+
+    template <class T>
+    T MetricView::get() const {
+        if (data_case != MetricViewDataTraits<T>::data_case) {
+            data_type_mismatch(static_cast<Metric::DataType>(MetricViewDataTraits<T>::data_case));
+        }
+        return MetricViewDataTraits<T>::decode(data_bits, data_str);
+    }
+
+    template <class T>
+    bool MetricView::try_get(T& out) const {
+        if (data_case != MetricViewDataTraits<T>::data_case) {
+            return false;
+        }
+        out = MetricViewDataTraits<T>::decode(data_bits, data_str);
+        return true;
+    }
+
+    template <class F>
+    auto MetricView::visit_data(F&& f) const -> decltype(f(NoData())) {
+        switch (data_case) {
+            case rpc::Metric::kStringData: return f(get<boost::string_ref>());
+            case rpc::Metric::kFloat32Data: return f(get<float>());
+            case rpc::Metric::kFloat64Data: return f(get<double>());
+            case rpc::Metric::kInt32Data: return f(get<int32_t>());
+            case rpc::Metric::kInt64Data: return f(get<int64_t>());
+            case rpc::Metric::kBoolData: return f(get<bool>());
+            case rpc::Metric::kUint32Data: return f(get<uint32_t>());
+            case rpc::Metric::kUint64Data: return f(get<uint64_t>());
+            default: return f(NoData());
+        }
+    }
+}  // namespace Plugin
@@ -0,0 +1,100 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/namespace_router.h"
+
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::NamespaceElement;
+using Plugin::NamespaceRouter;
+using Plugin::NamespaceView;
+
+NamespaceRouter::NamespaceRouter() : nodes(1) {}
+
+void NamespaceRouter::add_route(const Namespace& pattern, Handler handler) {
+    int node = 0;
+    for (unsigned int i = 0; i < pattern.size(); i++) {
+        const NamespaceElement elem = pattern[i];
+        int next;
+        if (elem.is_dynamic()) {
+            next = nodes[node].wildcard;
+        } else {
+            auto it = nodes[node].children.find(elem.get_value());
+            next = it == nodes[node].children.end() ? -1 : it->second;
+        }
+        if (next == -1) {
+            next = nodes.size();
+            nodes.emplace_back();
+            if (elem.is_dynamic()) {
+                nodes[node].wildcard = next;
+            } else {
+                nodes[node].children.emplace(elem.get_value(), next);
+            }
+        }
+        node = next;
+    }
+
+    if (nodes[node].route == -1) {
+        nodes[node].route = handlers.size();
+        handlers.push_back(std::move(handler));
+    } else {
+        handlers[nodes[node].route] = std::move(handler);
+    }
+}
+
+int NamespaceRouter::route(const NamespaceView& ns) const {
+    return match(ns, 0, 0);
+}
+
+// Every node has a single parent, so a route visits each node at most once.
+int NamespaceRouter::match(const NamespaceView& ns, unsigned int depth, int node) const {
+    if (depth == ns.size()) {
+        return nodes[node].route;
+    }
+    const Node& current = nodes[node];
+    auto it = current.children.find(ns[depth].value());
+    if (it != current.children.end()) {
+        int found = match(ns, depth + 1, it->second);
+        if (found != -1) {
+            return found;
+        }
+    }
+    if (current.wildcard != -1) {
+        return match(ns, depth + 1, current.wildcard);
+    }
+    return -1;
+}
+
+std::vector<Metric*> NamespaceRouter::dispatch(std::vector<Metric>& metrics) const {
+    std::vector<std::vector<Metric*>> routed(handlers.size());
+    std::vector<Metric*> unmatched;
+
+    for (Metric& met : metrics) {
+        int found = route(met.ns_view());
+        if (found == -1) {
+            unmatched.push_back(&met);
+        } else {
+            routed[found].push_back(&met);
+        }
+    }
+    for (size_t i = 0; i < handlers.size(); i++) {
+        if (!routed[i].empty()) {
+            handlers[i](routed[i]);
+        }
+    }
+    return unmatched;
+}
+
+unsigned int NamespaceRouter::size() const {
+    return handlers.size();
+}
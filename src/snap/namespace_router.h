@@ -0,0 +1,84 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "snap/metric.h"
+
+namespace Plugin {
+    /**
+    * NamespaceRouter dispatches the metrics requested from a collector to the
+    * code producing them.
+    * Handlers are registered once per namespace pattern, e.g. the ones
+    * returned from get_metric_types. The patterns are compiled into a trie,
+    * which routing walks along the namespace of a metric.
+    * Static elements of a pattern match equal values; dynamic elements
+    * (@see Namespace::add_dynamic_element) match any value. Where both a static
+    * and a dynamic element fit, the static one is preferred, and the dynamic
+    * one is tried when no pattern matches further down the static one.
+    * Routing therefore takes as many steps as the namespace has elements
+    * when patterns do not overlap. With overlapping patterns it may
+    * backtrack, but it visits each trie node at most once, so it never
+    * takes more steps than the trie has nodes.
+    */
+    class NamespaceRouter {
+    public:
+        /**
+        * Handler receives all metrics of a batch routed to it, in request order.
+        */
+        typedef std::function<void(std::vector<Metric*>& metrics)> Handler;
+
+        NamespaceRouter();
+
+        /**
+        * add_route registers `handler` for namespaces matching `pattern`.
+        * Registering the same pattern again replaces its handler.
+        */
+        void add_route(const Namespace& pattern, Handler handler);
+
+        /**
+        * route returns the index of the route matching `ns`, in the order
+        * routes were added, or -1 if none matches.
+        */
+        int route(const NamespaceView& ns) const;
+
+        /**
+        * dispatch routes all `metrics` in a single pass, then calls each handler
+        * once with the metrics routed to it, in the order routes were added.
+        * Metrics matching no route are returned.
+        */
+        std::vector<Metric*> dispatch(std::vector<Metric>& metrics) const;
+
+        /**
+        * Returns the number of routes.
+        */
+        unsigned int size() const;
+
+    private:
+        struct Node {
+            std::map<std::string, int, std::less<>> children;
+            int wildcard = -1;
+            int route = -1;
+        };
+
+        int match(const NamespaceView& ns, unsigned int depth, int node) const;
+
+        std::vector<Node> nodes;
+        std::vector<Handler> handlers;
+    };
+}  // namespace Plugin
@@ -20,6 +20,7 @@ limitations under the License.
 #include <grpc++/grpc++.h>
 
 #include "snap/plugin.h"
+#include "snap/compiled_config_policy.h"
 #include "snap/grpc_export.h"
 #include "snap/lib_setup_impl.h"
 #include "snap/rpc/plugin.pb.h"
@@ -67,7 +68,18 @@ Plugin::Meta::Meta(Type type, std::string name, int version, RpcType rpc_type) :
                     tls_certificate_authority_paths(""),
                     stand_alone(false),
                     diagnostic_enabled(false),
-                    stand_alone_port(stand_alone_port) {}
+                    stand_alone_port(stand_alone_port),
+                    arena_allocation(false),
+                    clock_source(RealtimeClock),
+                    encoded_replies(false),
+                    metric_views(false),
+                    validate_config(false),
+                    async_server(false),
+                    polling_threads(0),
+                    collect_threads(0),
+                    collect_cache(false),
+                    coalesce_collects(false),
+                    deadline_margin(std::chrono::milliseconds(50)) {}
 
 void Plugin::Meta::use_cli_args(Flags *flags) {
     listen_port = flags->GetFlagStrValue("port");
@@ -80,6 +92,10 @@ void Plugin::Meta::use_cli_args(Flags *flags) {
     stand_alone = flags->IsParsedFlag("stand-alone");
     stand_alone_port = flags->GetFlagIntValue("stand-alone-port");
     diagnostic_enabled = !stand_alone && !flags->IsConfigFromFramework();
+    async_server = async_server || flags->IsParsedFlag("async-server");
+    if (flags->GetFlagIntValue("polling-threads") > 0) {
+        polling_threads = flags->GetFlagIntValue("polling-threads");
+    }
 }
 
 Plugin::CollectorInterface* Plugin::PluginInterface::IsCollector() {
@@ -106,6 +122,28 @@ Plugin::CollectorInterface* Plugin::CollectorInterface::IsCollector() {
     return this;
 }
 
+std::vector<Plugin::Metric> Plugin::CollectorInterface::collect_metrics_until(
+    std::vector<Metric>& metrics, const CollectContext& context) {
+    return collect_metrics(metrics);
+}
+
+Plugin::MetricFrames Plugin::CollectorInterface::collect_frames(
+    const std::vector<Metric>& metrics) {
+    return MetricFrames();
+}
+
+std::string Plugin::CollectorInterface::shard_key(const Metric& metric) {
+    const NamespaceView ns = metric.ns_view();
+    std::string key;
+    for (unsigned int i = 0; i + 1 < ns.size(); i++) {
+        if (i > 0) {
+            key += "/";
+        }
+        key.append(ns[i].value().data(), ns[i].value().size());
+    }
+    return key;
+}
+
 Plugin::Type Plugin::ProcessorInterface::GetType() const {
     return Processor;
 }
@@ -122,6 +160,20 @@ Plugin::PublisherInterface* Plugin::PublisherInterface::IsPublisher() {
     return this;
 }
 
+void Plugin::PublisherInterface::publish_metric_views(const std::vector<MetricView> &views,
+                                                      const Config& config) {
+    google::protobuf::RepeatedPtrField<rpc::Metric> rpc_mets;
+    std::vector<Metric> metrics;
+    metrics.reserve(views.size());
+    for (const MetricView& view : views) {
+        rpc::Metric* rpc_met = rpc_mets.Add();
+        const boost::string_ref wire = view.wire();
+        rpc_met->ParseFromArray(wire.data(), wire.size());
+        metrics.emplace_back(rpc_met);
+    }
+    publish_metrics(metrics, config);
+}
+
 Plugin::Type Plugin::StreamCollectorInterface::GetType() const {
     return StreamCollector;
 }
@@ -248,7 +300,10 @@ void Plugin::DiagnosticPrinter::print_config_policy() {
     timer.start();
 
     ConfigPolicy cpolicy = collector->get_config_policy();
-    config.apply_defaults(cpolicy);
+    const std::string violations = CompiledConfigPolicy(cpolicy, 0).fill_defaults(cfgmap);
+    if (!violations.empty()) {
+        missing_config_requirements = "! Warning: " + violations + "\n";
+    }
 
     os << "\nConfig Policy:\n";
     os << std::resetiosflags(std::ios::adjustfield);
@@ -279,7 +334,7 @@ std::vector<Plugin::Metric> Plugin::DiagnosticPrinter::print_metric_types() {
     return metrics;
 }
 
-void Plugin::DiagnosticPrinter::print_collect_metrics(std::vector<Metric> metric_types) {
+void Plugin::DiagnosticPrinter::print_collect_metrics(std::vector<Metric>& metric_types) {
     Stopwatch timer(os);
     timer.start();
 
@@ -287,27 +342,14 @@ void Plugin::DiagnosticPrinter::print_collect_metrics(std::vector<Metric> metric
         metric.set_diagnostic_config(config);
     }
     os << "\nMetrics that can be collected right now are:\n";
+    MetricFrames frames = collector->collect_frames(metric_types);
     std::vector<Metric> mts = collector->collect_metrics(metric_types);
+    for (const auto& frame : frames) {
+        frame->expand(mts);
+    }
     for (auto& metric : mts) {
         os  << "    Namespace: " << setw(40) << metric.ns().get_string() << setw(6) << "Type: " << setw(20) << metric.data_type() << setw(8) << " Value: ";
-        switch (metric.data_type()){
-            case Metric::Int32 : os << metric.get_int_data() << "\n";
-                break;
-            case Metric::Uint32 : os << metric.get_uint32_data() << "\n";
-                break;
-            case Metric::String : os << metric.get_string_data() << "\n";
-                break;
-            case Metric::Bool : os << metric.get_bool_data() << "\n";
-                break;
-            case Metric::Float32 : os << metric.get_float32_data() << "\n";
-                break;
-            case Metric::Float64 : os << metric.get_float64_data() << "\n";
-                break;
-            case Metric::Int64 : os << metric.get_int64_data() << "\n";
-                break;
-            case Metric::Uint64 : os << metric.get_uint64_data() << "\n";
-                break;
-        }
+        metric.visit_data([this](const auto& value) { os << value << "\n"; });
     }
     timer.print_elapsed("printCollectMetrics took ","\n");
 }
@@ -377,15 +419,6 @@ std::string Plugin::DiagnosticPrinter::get_architecture_name() {
     #endif
 }
 
-void Plugin::DiagnosticPrinter::check_for_missing_requirements(const std::string& key,
-                                                               bool hasdefault) {
-    if (hasdefault) {
-        if (! (cfgmap.stringmap().count(key) && cfgmap.stringmap().count(key) && cfgmap.stringmap().count(key))) {
-            missing_config_requirements += "! Warning: \"" + key + "\" required by plugin and not provided in config \n";
-        }
-    }
-}
-
 void Plugin::DiagnosticPrinter::print_string_policy(ConfigPolicy& cpolicy) {
     std::string required_configs;
     for(auto& str_policy : cpolicy.string_policy()) {
@@ -398,7 +431,6 @@ void Plugin::DiagnosticPrinter::print_string_policy(ConfigPolicy& cpolicy) {
                << setw(20) << default_
                << setw(20) << ""
                << setw(20) << "" <<"\n";
-            check_for_missing_requirements(rule.first, rule.second.required());
         }
     }
 }
@@ -416,7 +448,6 @@ void Plugin::DiagnosticPrinter::print_integer_policy(ConfigPolicy& cpolicy) {
                << setw(20) << default_
                << setw(20) << minimum_
                << setw(20) << maximum_ <<"\n";
-            check_for_missing_requirements(rule.first, rule.second.required());
         }
     }
 }
@@ -433,7 +464,6 @@ void Plugin::DiagnosticPrinter::print_bool_policy(ConfigPolicy& cpolicy) {
                << setw(20) << std::boolalpha << default_
                << setw(20) << ""
                << setw(20) << "" <<"\n";
-            check_for_missing_requirements(rule.first, rule.second.required());
         }
     }
 }
@@ -21,8 +21,11 @@ limitations under the License.
 
 #include <grpc++/grpc++.h>
 
+#include "snap/collect_context.h"
 #include "snap/config.h"
 #include "snap/metric.h"
+#include "snap/metric_frame.h"
+#include "snap/metric_view.h"
 #include "snap/flags.h"
 
 #define RPC_VERSION 1
@@ -178,6 +181,116 @@ namespace Plugin {
         */
         int stand_alone_port;
 
+        /**
+        * arena_allocation == true makes every CollectMetrics, Process and Publish
+        * call own a protobuf arena. The copy of the request and every metric
+        * copied from the wrapped request metrics are allocated from it and
+        * released in one shot when the call returns, so such copies must not be
+        * kept beyond the call.
+        * Using arena_allocation overwrites the default value of (false).
+        */
+        bool arena_allocation;
+
+        /**
+        * clock_source is the clock read when the library timestamps metrics,
+        * e.g. the catalog returned from GetMetricTypes. Each batch of metrics
+        * is stamped with a single read.
+        * Using clock_source overwrites the default value of (RealtimeClock).
+        */
+        ClockSource clock_source;
+
+        /**
+        * encoded_replies == true makes a collector answer CollectMetrics with a
+        * reply written by a ReplyEncoder, which caches the serialized static
+        * fields of the rows of MetricFrames between calls, instead of one
+        * built from rpc::Metric messages. It needs a gRPC release with
+        * ByteBuffer based serialization traits, and is ignored otherwise.
+        * Using encoded_replies overwrites the default value of (false).
+        */
+        bool encoded_replies;
+
+        /**
+        * metric_views == true makes a publisher receive Publish requests as
+        * raw buffers, handed to PublisherInterface::publish_metric_views as
+        * MetricViews over the buffer instead of parsed rpc::Metric messages.
+        * It needs a gRPC release with ByteBuffer based serialization traits,
+        * and is ignored otherwise.
+        * Only set it for publishers overriding publish_metric_views: the
+        * default implementation parses every view back into a metric, which
+        * is slower than leaving it unset.
+        * Using metric_views overwrites the default value of (false).
+        */
+        bool metric_views;
+
+        /**
+        * validate_config == true makes the proxies check the config of each
+        * request against the plugin's config policy, compiled once into a
+        * CompiledConfigPolicy, and fill in its defaults before calling the
+        * plugin. Requests lacking a required value, or holding an integer out
+        * of range, fail without reaching the plugin.
+        * Using validate_config overwrites the default value of (false).
+        */
+        bool validate_config;
+
+        /**
+        * async_server == true makes the plugin served by an AsyncServer,
+        * polling completion queues from a fixed number of threads, instead of
+        * the synchronous gRPC server and its thread per call in flight. Calls
+        * are handled on the polling threads, so it suits plugins answering
+        * quickly; one blocking on I/O serves at most polling_threads calls at
+        * a time. Stream collectors are always served synchronously.
+        * It is also set by the --async-server flag.
+        * Using async_server overwrites the default value of (false).
+        */
+        bool async_server;
+
+        /**
+        * polling_threads is the number of threads the AsyncServer polls for
+        * calls with; 0 stands for one per core.
+        * It is also set by the --polling-threads flag.
+        * Using polling_threads overwrites the default value of (0).
+        */
+        int polling_threads;
+
+        /**
+        * collect_threads > 0 makes a collector collect in parallel. The
+        * requested metrics are split into shards by
+        * CollectorInterface::shard_key, and each shard is passed to its own
+        * collect_metrics call, run on a WorkStealingPool of collect_threads
+        * threads shared by all calls. The reply holds the metrics of each
+        * shard in turn, the shards in the order of their first metric.
+        * collect_metrics must then be safe to call from several threads.
+        * Using collect_threads overwrites the default value of (0).
+        */
+        int collect_threads;
+
+        /**
+        * collect_cache makes a collector keep the metrics it returned for
+        * each requested metric for cache_ttl, keyed by the requested
+        * namespace and config. Requests for cached metrics within that time
+        * are replied from the cache, and only the other metrics are passed
+        * to collect_metrics. collect_frames is still passed every metric.
+        * Using collect_cache overwrites the default value of (false).
+        */
+        bool collect_cache;
+
+        /**
+        * coalesce_collects makes a collector collect identical requests
+        * arriving together once. A request whose metrics and configs equal
+        * those of a collection in flight waits for it and is replied copies
+        * of its metrics.
+        * Using coalesce_collects overwrites the default value of (false).
+        */
+        bool coalesce_collects;
+
+        /**
+        * deadline_margin is the time a collector leaves itself to reply
+        * before the deadline of a CollectMetrics call: the CollectContext
+        * passed to collect_metrics_until expires this much earlier than the call.
+        * Using deadline_margin overwrites the default value of (50ms).
+        */
+        std::chrono::milliseconds deadline_margin;
+
         /**
         * use_cli_args updates plugin meta using arguments from cli
         */
@@ -263,6 +376,36 @@ namespace Plugin {
         * It should collect and annotate each metric with the apropos context.
         */
         virtual std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) = 0;
+
+        /*
+        * collect_metrics_until is called by the proxy in place of
+        * collect_metrics with the deadline of the request. Collectors able to
+        * stop early can override it, and return the metrics collected so far
+        * once the context expired. The default implementation ignores the
+        * context and calls collect_metrics.
+        */
+        virtual std::vector<Metric> collect_metrics_until(std::vector<Metric> &metrics,
+                                                          const CollectContext &context);
+
+        /*
+        * collect_frames is given the same list of metrics, right before
+        * collect_metrics. Collectors sampling many series of a metric type can
+        * return them here as MetricFrames instead of as individual metrics;
+        * the proxy expands the frames into the reply after the metrics.
+        * The default implementation returns no frames.
+        */
+        virtual MetricFrames collect_frames(const std::vector<Metric> &metrics);
+
+        /*
+        * shard_key is used when the plugin is started with
+        * Meta::collect_threads > 0. Metrics with equal keys are collected by
+        * the same collect_metrics call, and calls for different keys run in
+        * parallel, so a key typically names the source a metric is read from.
+        * The default implementation returns the namespace of the metric
+        * without its last element, e.g. "intel/disk/sda" for
+        * "intel/disk/sda/reads".
+        */
+        virtual std::string shard_key(const Metric &metric);
     };
 
     /**
@@ -291,6 +434,19 @@ namespace Plugin {
 
         virtual void publish_metrics(std::vector<Metric> &metrics,
                                     const Config& config) = 0;
+
+        /*
+        * publish_metric_views is called in place of publish_metrics when the
+        * plugin is started with Meta::metric_views set. The views read the
+        * request buffer and are valid only during the call.
+        * The default implementation parses the views into metrics and calls
+        * publish_metrics. It is a fallback only: on top of the parse the
+        * regular path does, it flattens the request buffer and walks it to
+        * find the views, so publishers not overriding this method should not
+        * set Meta::metric_views.
+        */
+        virtual void publish_metric_views(const std::vector<MetricView> &metrics,
+                                          const Config& config);
     };
 
 
@@ -333,11 +489,10 @@ namespace Plugin {
         void print_runtime_details();
         void print_config_policy();
         std::vector<Metric> print_metric_types();
-        void print_collect_metrics(std::vector<Metric> mts);
+        void print_collect_metrics(std::vector<Metric>& mts);
         void print_string_policy(ConfigPolicy& cpolicy);
         void print_integer_policy(ConfigPolicy& cpolicy);
         void print_bool_policy(ConfigPolicy& cpolicy);
-        void check_for_missing_requirements(const std::string& key, bool hasdefault);
 
         std::string get_os_name();
         std::string get_architecture_name();
@@ -12,12 +12,19 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <grpc++/grpc++.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
 #include "snap/rpc/plugin.pb.h"
 #include "snap/proxy/collector_proxy.h"
 #include "snap/metric.h"
 
+using google::protobuf::Arena;
 using google::protobuf::RepeatedPtrField;
 
 using grpc::Server;
@@ -33,41 +40,260 @@ using rpc::KillArg;
 using rpc::MetricsArg;
 using rpc::MetricsReply;
 
+using Plugin::CollectContext;
+using Plugin::EncodedReply;
 using Plugin::Metric;
+using Plugin::NamespaceView;
 using Plugin::Proxy::CollectorImpl;
 
-CollectorImpl::CollectorImpl(Plugin::CollectorInterface* plugin) :
-                                collector(plugin) {
-    plugin_impl_ptr = new PluginImpl(plugin);
+namespace {
+    /**
+    * missing_namespaces joins the namespaces of the `requested` metrics
+    * which none of `results`, nor any row of `frames`, matches.
+    */
+    std::string missing_namespaces(const RepeatedPtrField<rpc::Metric>& requested,
+                                   const std::vector<Metric>& results,
+                                   const Plugin::MetricFrames& frames) {
+        // Only called for partial replies, so rows are simply expanded.
+        std::vector<Metric> rows;
+        for (const auto& frame : frames) {
+            frame->expand(rows);
+        }
+        const std::vector<Metric>* const collected_sets[] = {&results, &rows};
+        std::unordered_set<std::string> names;
+        for (const std::vector<Metric>* collected : collected_sets) {
+            for (const Metric& met : *collected) {
+                names.insert(met.ns_view().get_string());
+            }
+        }
+        std::string missing;
+        for (const rpc::Metric& rpc_met : requested) {
+            const NamespaceView ns(rpc_met.namespace_());
+            const std::string name = ns.get_string();
+            bool found = names.count(name) > 0;
+            if (!found && (ns.is_dynamic() || name.find('*') != std::string::npos)) {
+                for (const std::vector<Metric>* collected : collected_sets) {
+                    for (const Metric& met : *collected) {
+                        if (!found && ns.matches(met.ns_view())) {
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (!found) {
+                missing += missing.empty() ? "" : ", ";
+                missing += name;
+            }
+        }
+        return missing;
+    }
+}  // namespace
+
+CollectorImpl::CollectorImpl(Plugin::CollectorInterface* plugin,
+                             const Plugin::Meta* meta) :
+                                collector(plugin),
+                                use_arena(meta != nullptr && meta->arena_allocation),
+                                clock_source(meta != nullptr ? meta->clock_source
+                                                             : Plugin::RealtimeClock),
+                                deadline_margin(meta != nullptr ? meta->deadline_margin
+                                                                : std::chrono::milliseconds(0)) {
+    plugin_impl_ptr = new PluginImpl(plugin, meta);
+    if (meta != nullptr && meta->collect_threads > 0) {
+        pool.reset(new Plugin::WorkStealingPool(meta->collect_threads));
+    }
+    if (meta != nullptr && meta->collect_cache) {
+        cache.reset(new Plugin::CollectCache(meta->cache_ttl));
+    }
+    if (meta != nullptr && meta->coalesce_collects) {
+        flights.reset(new Plugin::SingleFlight());
+    }
 }
 
 CollectorImpl::~CollectorImpl() {
     delete plugin_impl_ptr;
 }
 
-Status CollectorImpl::CollectMetrics(ServerContext* context,
-                                    const MetricsArg* req,
-                                    MetricsReply* resp) {
+template <class Reply, class Fail>
+Status CollectorImpl::collect(const ServerContext* context, const MetricsArg* req,
+                              Reply reply, Fail fail) {
+    // The request is not read again after this call, so its metrics are
+    // wrapped in place. With arena allocation they are cloned onto the call
+    // arena once, so that copies made by the plugin land there as well.
+    RepeatedPtrField<rpc::Metric>* rpc_mets =
+        const_cast<MetricsArg*>(req)->mutable_metrics();
+    Arena call_arena;
+    RepeatedPtrField<rpc::Metric> arena_mets(&call_arena);
+    if (use_arena) {
+        arena_mets.CopyFrom(*rpc_mets);
+        rpc_mets = &arena_mets;
+    }
+
     std::vector<Metric> metrics;
-    RepeatedPtrField<rpc::Metric> rpc_mets = req->metrics();
+    metrics.reserve(rpc_mets->size());
 
-    for (int i = 0; i < rpc_mets.size(); i++) {
-        metrics.emplace_back(rpc_mets.Mutable(i));
+    for (int i = 0; i < rpc_mets->size(); i++) {
+        metrics.emplace_back(rpc_mets->Mutable(i));
     }
+    const CollectContext collect_context = context_of(context);
 
     try {
-        std::vector<Metric> result_metrics = collector->collect_metrics(metrics);
+        if (plugin_impl_ptr->validates_config()) {
+            for (rpc::Metric& rpc_met : *rpc_mets) {
+                plugin_impl_ptr->apply_config_policy(rpc_met);
+            }
+        }
+        Plugin::MetricFrames frames = collector->collect_frames(metrics);
+        std::vector<Metric> result_metrics;
+        bool cut_short = false;
+        if (!cache) {
+            result_metrics = run_plugin(metrics, collect_context, cut_short);
+        } else {
+            std::vector<Metric> hits, misses;
+            std::vector<Plugin::CollectCache::Miss> missed;
+            cache->split(metrics, hits, misses, missed);
+            if (!misses.empty()) {
+                result_metrics = run_plugin(misses, collect_context, cut_short);
+                // Metrics cut short by a deadline, this call's or that of
+                // the call it joined, would be cached as missing.
+                if (!cut_short) {
+                    cache->store(missed, result_metrics);
+                }
+            }
+            result_metrics.reserve(result_metrics.size() + hits.size());
+            for (Metric& met : hits) {
+                result_metrics.push_back(std::move(met));
+            }
+        }
 
-        for (Metric met : result_metrics) {
-            *resp->add_metrics() = *met.get_rpc_metric_ptr();
+        // The reply moves the results, so what is missing is found first.
+        std::string missing;
+        if (cut_short) {
+            missing = missing_namespaces(*rpc_mets, result_metrics, frames);
+        }
+        reply(result_metrics, frames);
+        if (!missing.empty()) {
+            PluginException partial("deadline exceeded, missing " + missing);
+            fail(partial);
         }
         return Status::OK;
     } catch (PluginException &e) {
-        resp->set_error(e.what());
+        fail(e);
         return Status(StatusCode::UNKNOWN, e.what());
     }
 }
 
+CollectContext CollectorImpl::context_of(const ServerContext* context) const {
+    if (context == nullptr) {
+        return CollectContext();
+    }
+    const auto deadline = context->deadline();
+    if (deadline == std::chrono::system_clock::time_point::max()) {
+        return CollectContext();
+    }
+    // The deadline is given on the system clock; the context counts on the
+    // steady one.
+    const auto left = deadline - std::chrono::system_clock::now();
+    return CollectContext(CollectContext::Clock::now() +
+        std::chrono::duration_cast<CollectContext::Clock::duration>(left) - deadline_margin);
+}
+
+std::vector<Metric> CollectorImpl::run_plugin(std::vector<Metric>& metrics,
+                                              const CollectContext& context,
+                                              bool& cut_short) {
+    if (!flights) {
+        std::vector<Metric> results = pool ? collect_sharded(metrics, context)
+                                           : collector->collect_metrics_until(metrics, context);
+        cut_short = context.expired();
+        return results;
+    }
+    Plugin::SingleFlight::Result landed = flights->run(
+        Plugin::SingleFlight::key_of(metrics), [this, &metrics, &context] {
+            Plugin::SingleFlight::Result result;
+            result.metrics = pool ? collect_sharded(metrics, context)
+                                  : collector->collect_metrics_until(metrics, context);
+            result.cut_short = context.expired();
+            return result;
+        }, context);
+    cut_short = landed.cut_short || context.expired();
+    return std::move(landed.metrics);
+}
+
+std::vector<Metric> CollectorImpl::collect_sharded(std::vector<Metric>& metrics,
+                                                   const CollectContext& context) {
+    std::vector<std::vector<Metric>> shards;
+    std::unordered_map<std::string, size_t> shard_index;
+    for (Metric& met : metrics) {
+        auto inserted = shard_index.emplace(collector->shard_key(met), shards.size());
+        if (inserted.second) {
+            shards.emplace_back();
+        }
+        shards[inserted.first->second].push_back(std::move(met));
+    }
+    if (shards.size() <= 1) {
+        return shards.empty() ? std::vector<Metric>()
+                              : collector->collect_metrics_until(shards[0], context);
+    }
+
+    std::vector<std::vector<Metric>> results(shards.size());
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(shards.size());
+    for (size_t i = 0; i < shards.size(); i++) {
+        tasks.emplace_back([this, &shards, &results, &context, i] {
+            // Shards not started by the deadline are left out of the reply.
+            if (!context.expired()) {
+                results[i] = collector->collect_metrics_until(shards[i], context);
+            }
+        });
+    }
+    pool->run(tasks);
+
+    size_t total = 0;
+    for (const auto& result : results) {
+        total += result.size();
+    }
+    std::vector<Metric> merged;
+    merged.reserve(total);
+    for (auto& result : results) {
+        for (Metric& met : result) {
+            merged.push_back(std::move(met));
+        }
+    }
+    return merged;
+}
+
+Status CollectorImpl::CollectMetrics(ServerContext* context,
+                                    const MetricsArg* req,
+                                    MetricsReply* resp) {
+    return collect(context, req,
+        [resp](std::vector<Metric>& metrics, const Plugin::MetricFrames& frames) {
+            for (Metric& met : metrics) {
+                met.move_into(resp->mutable_metrics());
+            }
+            for (const auto& frame : frames) {
+                frame->append_to(resp->mutable_metrics());
+            }
+        },
+        [resp](PluginException& e) { resp->set_error(e.what()); });
+}
+
+Status CollectorImpl::CollectMetrics(ServerContext* context,
+                                    const MetricsArg* req,
+                                    EncodedReply* resp) {
+    return collect(context, req,
+        [this, resp](std::vector<Metric>& metrics, const Plugin::MetricFrames& frames) {
+            for (const Metric& met : metrics) {
+                encoder.add(met, &resp->payload);
+            }
+            for (const auto& frame : frames) {
+                encoder.add(*frame, &resp->payload);
+            }
+        },
+        [resp](PluginException& e) {
+            Plugin::ReplyEncoder::add_error(e.what(), &resp->payload);
+        });
+}
+
 Status CollectorImpl::GetMetricTypes(ServerContext* context,
                                     const GetMetricTypesArg* req,
                                     MetricsReply* resp) {
@@ -75,11 +301,10 @@ Status CollectorImpl::GetMetricTypes(ServerContext* context,
 
     try {
         std::vector<Metric> metrics = collector->get_metric_types(cfg);
+        Metric::set_advertised_times(metrics, clock_source);
 
-        for (Metric met : metrics) {
-            met.set_timestamp();
-            met.set_last_advertised_time();
-            *resp->add_metrics() = *met.get_rpc_metric_ptr();
+        for (Metric& met : metrics) {
+            met.move_into(resp->mutable_metrics());
         }
         return Status::OK;
     } catch (PluginException &e) {
@@ -107,3 +332,38 @@ Status CollectorImpl::Ping(ServerContext* context, const Empty* req,
                         ErrReply* resp) {
     return plugin_impl_ptr->Ping(context, req, resp);
 }
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+using grpc::internal::RpcMethod;
+using grpc::internal::RpcMethodHandler;
+using grpc::internal::RpcServiceMethod;
+using Plugin::Proxy::EncodedCollectorService;
+
+EncodedCollectorService::EncodedCollectorService(Plugin::CollectorInterface* plugin,
+                                                 const Plugin::Meta* meta) :
+                                                 impl(plugin, meta) {
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Collector/CollectMetrics", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<CollectorImpl, MetricsArg, EncodedReply>(
+            [](CollectorImpl* impl, ServerContext* context,
+               const MetricsArg* req, EncodedReply* resp) {
+                return impl->CollectMetrics(context, req, resp);
+            }, &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Collector/GetMetricTypes", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<CollectorImpl, GetMetricTypesArg, MetricsReply>(
+            std::mem_fn(&CollectorImpl::GetMetricTypes), &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Collector/Ping", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<CollectorImpl, Empty, ErrReply>(
+            std::mem_fn(&CollectorImpl::Ping), &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Collector/Kill", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<CollectorImpl, KillArg, ErrReply>(
+            std::mem_fn(&CollectorImpl::Kill), &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Collector/GetConfigPolicy", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<CollectorImpl, Empty, GetConfigPolicyReply>(
+            std::mem_fn(&CollectorImpl::GetConfigPolicy), &impl)));
+}
+#endif
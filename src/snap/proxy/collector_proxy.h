@@ -13,18 +13,36 @@ limitations under the License.
 */
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <grpc++/grpc++.h>
 
 #include "snap/rpc/plugin.grpc.pb.h"
 #include "snap/rpc/plugin.pb.h"
 
+#include "snap/collect_cache.h"
+#include "snap/reply_encoder.h"
+#include "snap/single_flight.h"
+#include "snap/work_stealing_pool.h"
 #include "snap/proxy/plugin_proxy.h"
 
 namespace Plugin {
     namespace Proxy {
         class CollectorImpl final : public rpc::Collector::Service {
         public:
-            explicit CollectorImpl(Plugin::CollectorInterface* plugin);
+            /**
+            * meta is optional; when given, its arena_allocation setting decides
+            * whether each call allocates its metrics from a protobuf arena, and
+            * its collect_threads setting whether metrics are collected in
+            * parallel, its collect_cache setting whether they are cached, its
+            * coalesce_collects setting whether identical concurrent requests
+            * are collected once, and its deadline_margin how long before the
+            * deadline of a call collect_metrics_until is asked to return.
+            */
+            explicit CollectorImpl(Plugin::CollectorInterface* plugin,
+                                   const Plugin::Meta* meta = nullptr);
 
             ~CollectorImpl();
 
@@ -32,6 +50,14 @@ namespace Plugin {
                                         const rpc::MetricsArg* req,
                                         rpc::MetricsReply* resp);
 
+            /**
+            * Same as above, but the reply is written by a ReplyEncoder shared
+            * by all calls.
+            */
+            grpc::Status CollectMetrics(grpc::ServerContext* context,
+                                        const rpc::MetricsArg* req,
+                                        Plugin::EncodedReply* resp);
+
             grpc::Status GetMetricTypes(grpc::ServerContext* context,
                                         const rpc::GetMetricTypesArg* request,
                                         rpc::MetricsReply* resp);
@@ -46,9 +72,114 @@ namespace Plugin {
             grpc::Status Ping(grpc::ServerContext* context, const rpc::Empty* request,
                                 rpc::ErrReply* resp);
 
+            /**
+            * collect_cache returns the cache of collected metrics, or nullptr
+            * when Meta::collect_cache is not set.
+            */
+            const Plugin::CollectCache* collect_cache() const { return cache.get(); }
+
+            /**
+            * single_flight returns the coalescer of concurrent requests, or
+            * nullptr when Meta::coalesce_collects is not set.
+            */
+            const Plugin::SingleFlight* single_flight() const { return flights.get(); }
+
         private:
             Plugin::CollectorInterface* collector;
             PluginImpl* plugin_impl_ptr;
+            bool use_arena;
+            Plugin::ClockSource clock_source;
+            std::chrono::milliseconds deadline_margin;
+            Plugin::ReplyEncoder encoder;
+            std::unique_ptr<Plugin::WorkStealingPool> pool;
+            std::unique_ptr<Plugin::CollectCache> cache;
+            std::unique_ptr<Plugin::SingleFlight> flights;
+
+            /**
+            * collect runs the plugin on the requested metrics and passes the
+            * results to `reply`. Errors reported by the plugin are passed to
+            * `fail`, as are, after `reply`, the namespaces left out of a reply
+            * cut short by the deadline of `context`.
+            */
+            template <class Reply, class Fail>
+            grpc::Status collect(const grpc::ServerContext* context,
+                                 const rpc::MetricsArg* req, Reply reply, Fail fail);
+
+            /**
+            * context_of returns the CollectContext of a call, expiring
+            * deadline_margin before its deadline.
+            */
+            Plugin::CollectContext context_of(const grpc::ServerContext* context) const;
+
+            /**
+            * run_plugin collects `metrics`, sharded or not, joining a
+            * collection of the same metrics in flight if coalescing.
+            * `cut_short` is set when a deadline, of this call or of the one
+            * joined, may have left metrics out.
+            */
+            std::vector<Metric> run_plugin(std::vector<Metric>& metrics,
+                                           const Plugin::CollectContext& context,
+                                           bool& cut_short);
+
+            /**
+            * collect_sharded splits `metrics` by shard key and collects the
+            * shards on the pool. Shards not started by the time `context`
+            * expires are not collected.
+            */
+            std::vector<Metric> collect_sharded(std::vector<Metric>& metrics,
+                                                const Plugin::CollectContext& context);
+        };
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+        /**
+        * EncodedCollectorService serves the rpc.Collector methods of a
+        * CollectorImpl, except that CollectMetrics replies with the
+        * EncodedReply overload. It is exported in place of CollectorImpl when
+        * Meta::encoded_replies is set.
+        */
+        class EncodedCollectorService final : public grpc::Service {
+        public:
+            explicit EncodedCollectorService(Plugin::CollectorInterface* plugin,
+                                             const Plugin::Meta* meta = nullptr);
+
+        private:
+            CollectorImpl impl;
         };
+#endif
     }  // namespace Proxy
 }  // namespace Plugin
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+namespace grpc {
+    /**
+    * Lets gRPC send an EncodedReply as it is, in a single slice.
+    */
+    template <>
+    class SerializationTraits<Plugin::EncodedReply, void> {
+    public:
+        static Status Serialize(const Plugin::EncodedReply& msg,
+                                ByteBuffer* buffer, bool* own_buffer) {
+            Slice slice(msg.payload);
+            ByteBuffer tmp(&slice, 1);
+            buffer->Swap(&tmp);
+            *own_buffer = true;
+            return Status::OK;
+        }
+
+        static Status Deserialize(ByteBuffer* buffer, Plugin::EncodedReply* msg) {
+            std::vector<Slice> slices;
+            Status status = buffer->Dump(&slices);
+            buffer->Clear();
+            if (!status.ok()) {
+                return status;
+            }
+            msg->payload.clear();
+            for (const Slice& slice : slices) {
+                msg->payload.append(reinterpret_cast<const char*>(slice.begin()),
+                                    slice.size());
+            }
+            return Status::OK;
+        }
+    };
+}  // namespace grpc
+#endif
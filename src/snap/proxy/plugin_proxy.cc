@@ -29,7 +29,10 @@ using rpc::GetConfigPolicyReply;
 
 using Plugin::Proxy::PluginImpl;
 
-PluginImpl::PluginImpl(Plugin::PluginInterface* plugin) : plugin(plugin) {}
+PluginImpl::PluginImpl(Plugin::PluginInterface* plugin,
+                       const Plugin::Meta* meta) :
+                       plugin(plugin),
+                       validate_config(meta != nullptr && meta->validate_config) {}
 
 Status PluginImpl::Ping(ServerContext* context, const Empty* req,
                         ErrReply* resp) {
@@ -50,6 +53,36 @@ Status PluginImpl::GetConfigPolicy(ServerContext* context, const Empty* req,
     return Status::OK;
 }
 
+void PluginImpl::apply_config_policy(rpc::ConfigMap& config) {
+    if (validate_config) {
+        compiled_policy().apply(config);
+    }
+}
+
+void PluginImpl::apply_config_policy(rpc::Metric& metric) {
+    if (!validate_config) {
+        return;
+    }
+    const Plugin::NamespaceView ns(metric.namespace_());
+    if (metric.has_config()) {
+        compiled_policy().apply(*metric.mutable_config(), ns);
+        return;
+    }
+    // An empty map does not allocate until something is inserted.
+    rpc::ConfigMap config;
+    compiled_policy().apply(config, ns);
+    if (config.ByteSizeLong() > 0) {
+        metric.mutable_config()->Swap(&config);
+    }
+}
+
+const Plugin::CompiledConfigPolicy& PluginImpl::compiled_policy() {
+    std::call_once(policy_compiled, [this] {
+        policy.reset(new CompiledConfigPolicy(plugin->get_config_policy()));
+    });
+    return *policy;
+}
+
 void PluginImpl::HeartbeatWatch() {
     _lastPing = std::chrono::system_clock::now();
     std::cout << "Heartbeat started" << std::endl;
@@ -16,9 +16,12 @@ limitations under the License.
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <grpc++/grpc++.h>
 
 #include "snap/rpc/plugin.pb.h"
+#include "snap/compiled_config_policy.h"
 #include "snap/plugin.h"
 
 namespace Plugin {
@@ -43,7 +46,13 @@ namespace Plugin {
 
         class PluginImpl final {
         public:
-            explicit PluginImpl(Plugin::PluginInterface* plugin);
+            /**
+            * meta is optional; when given, its validate_config setting decides
+            * whether apply_config_policy checks configs against the plugin's
+            * config policy.
+            */
+            explicit PluginImpl(Plugin::PluginInterface* plugin,
+                                const Plugin::Meta* meta = nullptr);
 
             grpc::Status Ping(grpc::ServerContext* context, const rpc::Empty* req,
                                 rpc::ErrReply* resp);
@@ -58,8 +67,34 @@ namespace Plugin {
 
             void HeartbeatWatch();
 
+            /**
+            * apply_config_policy validates `config` and fills in its defaults
+            * with the plugin's config policy, compiled on first use. It throws
+            * a PluginException when the config breaks the policy, and does
+            * nothing unless Meta::validate_config is set.
+            */
+            void apply_config_policy(rpc::ConfigMap& config);
+
+            /**
+            * Same as above, for the config of `metric`, with the rules of its
+            * namespace. A metric without config is only given one when the
+            * policy has defaults to fill in.
+            */
+            void apply_config_policy(rpc::Metric& metric);
+
+            /**
+            * validates_config returns whether apply_config_policy does
+            * anything, so that callers can skip walking the metrics.
+            */
+            bool validates_config() const { return validate_config; }
+
         private:
             Plugin::PluginInterface* plugin;
+            bool validate_config;
+            std::once_flag policy_compiled;
+            std::unique_ptr<CompiledConfigPolicy> policy;
+
+            const CompiledConfigPolicy& compiled_policy();
             std::chrono::system_clock::time_point _lastPing;
             // PingTimeoutLimit is the number of successively missed pin health checks
             // which must occur before the plugin is stopped
@@ -16,9 +16,11 @@ limitations under the License.
 #include<vector>
 
 #include <grpc++/grpc++.h>
+#include <google/protobuf/arena.h>
 
 #include "snap/rpc/plugin.pb.h"
 
+using google::protobuf::Arena;
 using google::protobuf::RepeatedPtrField;
 
 using grpc::Server;
@@ -36,9 +38,11 @@ using rpc::PubProcArg;
 
 using Plugin::Proxy::ProcessorImpl;
 
-ProcessorImpl::ProcessorImpl(Plugin::ProcessorInterface* plugin) :
-                             processor(plugin) {
-    plugin_impl_ptr = new PluginImpl(plugin);
+ProcessorImpl::ProcessorImpl(Plugin::ProcessorInterface* plugin,
+                             const Plugin::Meta* meta) :
+                             processor(plugin),
+                             use_arena(meta != nullptr && meta->arena_allocation) {
+    plugin_impl_ptr = new PluginImpl(plugin, meta);
 }
 
 ProcessorImpl::~ProcessorImpl() {
@@ -47,19 +51,32 @@ ProcessorImpl::~ProcessorImpl() {
 
 Status ProcessorImpl::Process(ServerContext* context, const PubProcArg* req,
                               MetricsReply* resp) {
+    // The request is not read again after this call, so its metrics are
+    // wrapped in place. With arena allocation they are cloned onto the call
+    // arena once, so that copies made by the plugin land there as well.
+    RepeatedPtrField<rpc::Metric>* rpc_mets =
+        const_cast<PubProcArg*>(req)->mutable_metrics();
+    Arena call_arena;
+    RepeatedPtrField<rpc::Metric> arena_mets(&call_arena);
+    if (use_arena) {
+        arena_mets.CopyFrom(*rpc_mets);
+        rpc_mets = &arena_mets;
+    }
+
     std::vector<Metric> metrics;
-    RepeatedPtrField<rpc::Metric> rpc_mets = req->metrics();
+    metrics.reserve(rpc_mets->size());
 
-    for (int i = 0; i < rpc_mets.size(); i++) {
-        metrics.emplace_back(rpc_mets.Mutable(i));
+    for (int i = 0; i < rpc_mets->size(); i++) {
+        metrics.emplace_back(rpc_mets->Mutable(i));
     }
 
     Plugin::Config config(const_cast<rpc::ConfigMap&>(req->config()));
     try {
+        plugin_impl_ptr->apply_config_policy(*const_cast<PubProcArg*>(req)->mutable_config());
         processor->process_metrics(metrics, config);
 
-        for (Metric met : metrics) {
-            *resp->add_metrics() = *met.get_rpc_metric_ptr();
+        for (Metric& met : metrics) {
+            met.move_into(resp->mutable_metrics());
         }
         return Status::OK;
     } catch (PluginException &e) {
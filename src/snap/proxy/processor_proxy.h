@@ -24,7 +24,12 @@ namespace Plugin {
     namespace Proxy {
         class ProcessorImpl final : public rpc::Processor::Service {
         public:
-            explicit ProcessorImpl(Plugin::ProcessorInterface* plugin);
+            /**
+            * When meta->arena_allocation is set, Process copies the incoming
+            * metrics onto an arena owned by the call.
+            */
+            explicit ProcessorImpl(Plugin::ProcessorInterface* plugin,
+                                   const Plugin::Meta* meta = nullptr);
 
             ~ProcessorImpl();
 
@@ -45,6 +50,7 @@ namespace Plugin {
         private:
             Plugin::ProcessorInterface* processor;
             PluginImpl* plugin_impl_ptr;
+            bool use_arena;
         };
     }   // namespace Proxy
 }   // namespace Plugin
@@ -13,12 +13,15 @@ limitations under the License.
 */
 #include "snap/proxy/publisher_proxy.h"
 
-#include<vector>
+#include <functional>
+#include <vector>
 
 #include <grpc++/grpc++.h>
+#include <google/protobuf/arena.h>
 
 #include "snap/rpc/plugin.pb.h"
 
+using google::protobuf::Arena;
 using google::protobuf::RepeatedPtrField;
 
 using grpc::Server;
@@ -35,9 +38,11 @@ using rpc::PubProcArg;
 
 using Plugin::Proxy::PublisherImpl;
 
-PublisherImpl::PublisherImpl(Plugin::PublisherInterface* plugin) :
-                             publisher(plugin) {
-    plugin_impl_ptr = new PluginImpl(plugin);
+PublisherImpl::PublisherImpl(Plugin::PublisherInterface* plugin,
+                             const Plugin::Meta* meta) :
+                             publisher(plugin),
+                             use_arena(meta != nullptr && meta->arena_allocation) {
+    plugin_impl_ptr = new PluginImpl(plugin, meta);
 }
 
 PublisherImpl::~PublisherImpl() {
@@ -46,15 +51,28 @@ PublisherImpl::~PublisherImpl() {
 
 Status PublisherImpl::Publish(ServerContext* context, const PubProcArg* req,
                               ErrReply* resp) {
+    // The request is not read again after this call, so its metrics are
+    // wrapped in place. With arena allocation they are cloned onto the call
+    // arena once, so that copies made by the plugin land there as well.
+    RepeatedPtrField<rpc::Metric>* rpc_mets =
+        const_cast<PubProcArg*>(req)->mutable_metrics();
+    Arena call_arena;
+    RepeatedPtrField<rpc::Metric> arena_mets(&call_arena);
+    if (use_arena) {
+        arena_mets.CopyFrom(*rpc_mets);
+        rpc_mets = &arena_mets;
+    }
+
     std::vector<Metric> metrics;
-    RepeatedPtrField<rpc::Metric> rpc_mets = req->metrics();
+    metrics.reserve(rpc_mets->size());
 
-    for (int i = 0; i < rpc_mets.size(); i++) {
-        metrics.emplace_back(rpc_mets.Mutable(i));
+    for (int i = 0; i < rpc_mets->size(); i++) {
+        metrics.emplace_back(rpc_mets->Mutable(i));
     }
 
     Plugin::Config config(const_cast<rpc::ConfigMap&>(req->config()));
     try {
+        plugin_impl_ptr->apply_config_policy(*const_cast<PubProcArg*>(req)->mutable_config());
         publisher->publish_metrics(metrics, config);
         return Status::OK;
     } catch (PluginException &e) {
@@ -63,6 +81,29 @@ Status PublisherImpl::Publish(ServerContext* context, const PubProcArg* req,
     }
 }
 
+#ifdef GRPC_CPP_VERSION_MAJOR
+Status PublisherImpl::Publish(ServerContext* context, const RawPubProcArg* req,
+                              ErrReply* resp) {
+    Plugin::MetricBatchView batch;
+    const boost::string_ref wire(reinterpret_cast<const char*>(req->slice.begin()),
+                                 req->slice.size());
+    if (!batch.parse(wire)) {
+        resp->set_error("malformed Publish request");
+        return Status(StatusCode::INVALID_ARGUMENT, resp->error());
+    }
+
+    Plugin::Config config(batch.config());
+    try {
+        plugin_impl_ptr->apply_config_policy(batch.config());
+        publisher->publish_metric_views(batch.metrics(), config);
+        return Status::OK;
+    } catch (PluginException &e) {
+        resp->set_error(e.what());
+        return Status(StatusCode::UNKNOWN, e.what());
+    }
+}
+#endif
+
 Status PublisherImpl::Kill(ServerContext* context, const KillArg* req,
                            ErrReply* resp) {
     return plugin_impl_ptr->Kill(context, req, resp);
@@ -82,3 +123,35 @@ Status PublisherImpl::Ping(ServerContext* context, const Empty* req,
                            ErrReply* resp) {
     return plugin_impl_ptr->Ping(context, req, resp);
 }
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+using grpc::internal::RpcMethod;
+using grpc::internal::RpcMethodHandler;
+using grpc::internal::RpcServiceMethod;
+using Plugin::Proxy::RawPubProcArg;
+using Plugin::Proxy::ViewPublisherService;
+
+ViewPublisherService::ViewPublisherService(Plugin::PublisherInterface* plugin,
+                                           const Plugin::Meta* meta) :
+                                           impl(plugin, meta) {
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Publisher/Publish", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<PublisherImpl, RawPubProcArg, ErrReply>(
+            [](PublisherImpl* impl, ServerContext* context,
+               const RawPubProcArg* req, ErrReply* resp) {
+                return impl->Publish(context, req, resp);
+            }, &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Publisher/Ping", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<PublisherImpl, Empty, ErrReply>(
+            std::mem_fn(&PublisherImpl::Ping), &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Publisher/Kill", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<PublisherImpl, KillArg, ErrReply>(
+            std::mem_fn(&PublisherImpl::Kill), &impl)));
+    AddMethod(new RpcServiceMethod(
+        "/rpc.Publisher/GetConfigPolicy", RpcMethod::NORMAL_RPC,
+        new RpcMethodHandler<PublisherImpl, Empty, GetConfigPolicyReply>(
+            std::mem_fn(&PublisherImpl::GetConfigPolicy), &impl)));
+}
+#endif
@@ -18,19 +18,44 @@ limitations under the License.
 #include "snap/rpc/plugin.pb.h"
 #include "snap/rpc/plugin.grpc.pb.h"
 
+#include "snap/metric_view.h"
 #include "snap/proxy/plugin_proxy.h"
 
 namespace Plugin {
     namespace Proxy {
+#ifdef GRPC_CPP_VERSION_MAJOR
+        /**
+        * RawPubProcArg is a Publish request left serialized. The slice keeps
+        * the buffer received by gRPC alive while MetricViews read it.
+        */
+        struct RawPubProcArg {
+            grpc::Slice slice;
+        };
+#endif
+
         class PublisherImpl final : public rpc::Publisher::Service {
         public:
-            explicit PublisherImpl(Plugin::PublisherInterface* plugin);
+            /**
+            * @see Meta::arena_allocation
+            */
+            explicit PublisherImpl(Plugin::PublisherInterface* plugin,
+                                   const Plugin::Meta* meta = nullptr);
 
             ~PublisherImpl();
 
             grpc::Status Publish(grpc::ServerContext* context, const rpc::PubProcArg* req,
                                 rpc::ErrReply* resp);
 
+#ifdef GRPC_CPP_VERSION_MAJOR
+            /**
+            * Same as above, but the metrics are handed to the plugin as
+            * MetricViews over the request buffer.
+            * @see PublisherInterface::publish_metric_views
+            */
+            grpc::Status Publish(grpc::ServerContext* context, const RawPubProcArg* req,
+                                rpc::ErrReply* resp);
+#endif
+
             grpc::Status Kill(grpc::ServerContext* context, const rpc::KillArg* request,
                                 rpc::ErrReply* response);
 
@@ -44,6 +69,51 @@ namespace Plugin {
         private:
             Plugin::PublisherInterface* publisher;
             PluginImpl* plugin_impl_ptr;
+            bool use_arena;
         };
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+        /**
+        * ViewPublisherService serves the rpc.Publisher methods of a
+        * PublisherImpl, except that Publish takes the RawPubProcArg overload.
+        * It is exported in place of PublisherImpl when Meta::metric_views is
+        * set.
+        */
+        class ViewPublisherService final : public grpc::Service {
+        public:
+            explicit ViewPublisherService(Plugin::PublisherInterface* plugin,
+                                          const Plugin::Meta* meta = nullptr);
+
+        private:
+            PublisherImpl impl;
+        };
+#endif
     }  // namespace Proxy
 }  // namespace Plugin
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+namespace grpc {
+    /**
+    * Lets gRPC hand a Publish request over without parsing it. A request
+    * received in a single slice is referenced, not copied.
+    */
+    template <>
+    class SerializationTraits<Plugin::Proxy::RawPubProcArg, void> {
+    public:
+        static Status Serialize(const Plugin::Proxy::RawPubProcArg& msg,
+                                ByteBuffer* buffer, bool* own_buffer) {
+            ByteBuffer tmp(&msg.slice, 1);
+            buffer->Swap(&tmp);
+            *own_buffer = true;
+            return Status::OK;
+        }
+
+        static Status Deserialize(ByteBuffer* buffer,
+                                  Plugin::Proxy::RawPubProcArg* msg) {
+            Status status = buffer->DumpToSingleSlice(&msg->slice);
+            buffer->Clear();
+            return status;
+        }
+    };
+}  // namespace grpc
+#endif
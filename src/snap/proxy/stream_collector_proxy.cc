@@ -47,8 +47,11 @@ using Plugin::Metric;
 using Plugin::PluginException;
 using Plugin::Proxy::StreamCollectorImpl;
 
-StreamCollectorImpl::StreamCollectorImpl(Plugin::StreamCollectorInterface* plugin) :
-                                        _stream_collector(plugin) {
+StreamCollectorImpl::StreamCollectorImpl(Plugin::StreamCollectorInterface* plugin,
+                                         const Plugin::Meta* meta) :
+                                        _stream_collector(plugin),
+                                        _clock_source(meta != nullptr ? meta->clock_source
+                                                                      : Plugin::RealtimeClock) {
     _plugin_impl_ptr = new PluginImpl(plugin);
     _metrics_reply = new rpc::MetricsReply();
     _err_reply = new rpc::ErrReply();
@@ -68,11 +71,10 @@ Status StreamCollectorImpl::GetMetricTypes(ServerContext* context,
     Plugin::Config cfg(const_cast<rpc::ConfigMap&>(req->config()));
     try {
         std::vector<Metric> metrics = _stream_collector->get_metric_types(cfg);
+        Metric::set_advertised_times(metrics, _clock_source);
 
-        for (Metric met : metrics) {
-            met.set_timestamp();
-            met.set_last_advertised_time();
-            *resp->add_metrics() = *met.get_rpc_metric_ptr();
+        for (Metric& met : metrics) {
+            met.move_into(resp->mutable_metrics());
         }
         return Status::OK;
     } catch (PluginException &e) {
@@ -177,8 +179,8 @@ bool StreamCollectorImpl::metricSend(const std::string &taskID,
             std::vector<Metric> send_mets;
             if (_sendChan.get(send_mets)) {
                 if (!send_mets.empty()) {
-                    for (Metric met : send_mets) {
-                        *_metrics_reply->add_metrics() = *met.get_rpc_metric_ptr();
+                    for (Metric& met : send_mets) {
+                        met.move_into(_metrics_reply->mutable_metrics());
                         if (_metrics_reply->metrics_size() == _max_metrics_buffer) {
                             sendReply(taskID, stream);
                             _metrics_reply->clear_metrics();
@@ -231,12 +233,17 @@ bool StreamCollectorImpl::streamRecv(const std::string &taskID,
             }            
 
             if (collectMets.has_metrics_arg()) {
-                RepeatedPtrField<rpc::Metric> rpc_mets = collectMets.metrics_arg().metrics();
-
-                for (int i = 0; i < rpc_mets.size(); i++) {
-                    recv_mets.emplace_back(rpc_mets.Mutable(i));
+                // collectMets is gone before the metrics are consumed, so each
+                // metric is copied once, straight out of it, into one it owns.
+                RepeatedPtrField<rpc::Metric>* rpc_mets =
+                    collectMets.mutable_metrics_arg()->mutable_metrics();
+                recv_mets.reserve(rpc_mets->size());
+
+                for (int i = 0; i < rpc_mets->size(); i++) {
+                    const Metric wrapped(rpc_mets->Mutable(i));
+                    recv_mets.push_back(wrapped);
                 }
-                _recvChan.put(recv_mets);
+                _recvChan.put(std::move(recv_mets));
             }
         }
         _recvChan.close();
@@ -286,6 +293,16 @@ void StreamCollectorImpl::StreamChannel<T>::put(const T &in) {
     _cv.notify_one();
 }
 
+template <class T>
+void StreamCollectorImpl::StreamChannel<T>::put(T &&in) {
+    std::unique_lock<std::mutex> lock(_m);
+
+    if (_closed) throw std::logic_error("put to closed channel");
+
+    _queue.push_back(std::move(in));
+    _cv.notify_one();
+}
+
 template <class T>
 bool StreamCollectorImpl::StreamChannel<T>::get(T &out, bool wait) {
     std::unique_lock<std::mutex> lock(_m);
@@ -30,7 +30,12 @@ namespace Plugin {
     namespace Proxy {
         class StreamCollectorImpl final : public rpc::StreamCollector::Service {
         public:
-            explicit StreamCollectorImpl(Plugin::StreamCollectorInterface* plugin);
+            /**
+            * meta is optional; when given, its clock_source is used to
+            * timestamp the metric catalog.
+            */
+            explicit StreamCollectorImpl(Plugin::StreamCollectorInterface* plugin,
+                                         const Plugin::Meta* meta = nullptr);
 
             ~StreamCollectorImpl();
 
@@ -131,6 +136,7 @@ namespace Plugin {
                 void close();
                 bool is_closed();
                 void put(const T &in);
+                void put(T &&in);
                 bool get(T &out, bool wait = true);
             };
 
@@ -140,6 +146,7 @@ namespace Plugin {
             grpc::ServerContext* _ctx;
             int64_t _max_metrics_buffer;
             std::chrono::seconds _max_collect_duration;
+            Plugin::ClockSource _clock_source;
             rpc::CollectReply _collect_reply;
             rpc::MetricsReply *_metrics_reply;
             rpc::ErrReply *_err_reply;
@@ -0,0 +1,151 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/reply_encoder.h"
+
+#include <algorithm>
+
+using Plugin::Metric;
+using Plugin::MetricFrameBase;
+using Plugin::ReplyEncoder;
+
+namespace {
+    /**
+    * Tags of the length-delimited fields of rpc::MetricsReply: the field
+    * number followed by wire type 2.
+    */
+    const char metrics_tag = (rpc::MetricsReply::kMetricsFieldNumber << 3) | 2;
+    const char error_tag = (rpc::MetricsReply::kErrorFieldNumber << 3) | 2;
+
+    /**
+    * The rows of a frame are looked up in the cache, then encoded, this many
+    * at a time: the lock is released regularly, and the cached fields are
+    * still in the CPU cache when they are copied into the payload.
+    */
+    const size_t lookup_rows = 256;
+
+    void append_varint(uint64_t value, std::string* out) {
+        while (value >= 0x80) {
+            out->push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out->push_back(static_cast<char>(value));
+    }
+
+    /**
+    * append_message appends the serialized form of `message`, whose
+    * ByteSizeLong() returned `size`.
+    */
+    void append_message(const google::protobuf::Message& message, size_t size,
+                        std::string* out) {
+        const size_t offset = out->size();
+        out->resize(offset + size);
+        message.SerializeWithCachedSizesToArray(
+            reinterpret_cast<uint8_t*>(&(*out)[offset]));
+    }
+}  // namespace
+
+ReplyEncoder::ReplyEncoder(size_t max_segments) :
+    max_segments(max_segments), segment_count(0) {}
+
+void ReplyEncoder::add(const Metric& metric, std::string* payload) {
+    const rpc::Metric& rpc_metric = *metric.get_rpc_metric_ptr();
+    const size_t size = rpc_metric.ByteSizeLong();
+    payload->push_back(metrics_tag);
+    append_varint(size, payload);
+    append_message(rpc_metric, size, payload);
+}
+
+void ReplyEncoder::add(const MetricFrameBase& frame, std::string* payload) {
+    Lookup lookup;
+    rpc::Metric dynamic_fields;
+    for (size_t begin = 0; begin < frame.size(); begin += lookup_rows) {
+        const size_t end = std::min(frame.size(), begin + lookup_rows);
+        look_up(frame, begin, end, lookup);
+        for (size_t row = begin; row < end; row++) {
+            // Clear() would free the timestamp message, so the fields are
+            // overwritten instead.
+            if (frame.stamps[row] == MetricFrameBase::time_point()) {
+                dynamic_fields.clear_timestamp();
+            }
+            frame.fill_dynamic(row, &dynamic_fields);
+            const std::string& fixed = *lookup.fixed[row - begin];
+            dynamic_fields.SerializeToString(&lookup.fresh);
+            payload->push_back(metrics_tag);
+            append_varint(fixed.size() + lookup.fresh.size(), payload);
+            payload->append(fixed);
+            payload->append(lookup.fresh);
+        }
+    }
+}
+
+void ReplyEncoder::look_up(const MetricFrameBase& frame, size_t begin, size_t end,
+                           Lookup& lookup) {
+    lookup.fixed.clear();
+    lookup.pinned.clear();
+    std::string& key = lookup.key;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Series> current;
+    auto found = series.find(frame.prototype_key());
+    if (found != series.end()) {
+        current = found->second;
+        lookup.pinned.push_back(current);
+    }
+    for (size_t row = begin; row < end; row++) {
+        key.clear();
+        for (size_t i = 0; i < frame.dynamic_count; i++) {
+            key += frame.decode(i, frame.code(row, i));
+            key += '\0';
+        }
+        if (current) {
+            Segments::const_iterator segment = current->segments.find(key);
+            if (segment != current->segments.end()) {
+                lookup.fixed.push_back(&segment->second);
+                continue;
+            }
+        }
+        if (segment_count >= max_segments) {
+            // the segments already looked up stay pinned by `lookup`.
+            series.clear();
+            segment_count = 0;
+            current.reset();
+        }
+        if (!current) {
+            current = std::make_shared<Series>(Series{frame.prototype(), Segments()});
+            series.emplace(frame.prototype_key(), current);
+            lookup.pinned.push_back(current);
+        }
+        rpc::Metric static_fields;
+        frame.fill_static(row, &static_fields);
+        auto added = current->segments.emplace(key, static_fields.SerializeAsString());
+        segment_count++;
+        lookup.fixed.push_back(&added.first->second);
+    }
+}
+
+void ReplyEncoder::add_error(const std::string& error, std::string* payload) {
+    payload->push_back(error_tag);
+    append_varint(error.size(), payload);
+    payload->append(error);
+}
+
+size_t ReplyEncoder::cached_segments() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return segment_count;
+}
+
+void ReplyEncoder::clear_cache() {
+    std::lock_guard<std::mutex> lock(mutex);
+    series.clear();
+    segment_count = 0;
+}
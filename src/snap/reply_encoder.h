@@ -0,0 +1,125 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snap/metric.h"
+#include "snap/metric_frame.h"
+#include "snap/metric_prototype.h"
+#include "snap/rpc/plugin.pb.h"
+
+namespace Plugin {
+    /**
+    * EncodedReply is an rpc::MetricsReply in its serialized form, as written
+    * by a ReplyEncoder. The collector proxy hands it to gRPC as is.
+    */
+    struct EncodedReply {
+        std::string payload;
+    };
+
+    /**
+    * ReplyEncoder writes the wire format of an rpc::MetricsReply straight into
+    * a string, without building rpc::Metric messages for the reply.
+    * The rows of a MetricFrame differ from one cycle to the next only in
+    * their value and timestamp. The other fields - namespace, unit and
+    * description - are serialized once per prototype and dynamic element
+    * values, cached, and copied into the payload; only the value and the
+    * timestamp are encoded for every row. Metrics added one by one are
+    * serialized as a whole.
+    * The cache holds at most `max_segments` series; when a new series would
+    * exceed it, the whole cache is dropped and refilled from the rows being
+    * encoded. Collectors whose series keep changing thus pay for serializing
+    * the static fields again, instead of growing the cache without bound.
+    * A ReplyEncoder may be shared between threads. They only contend while
+    * looking up the cached fields of a frame; the rows are encoded with
+    * per-call scratch space, outside of the lock.
+    */
+    class ReplyEncoder {
+    public:
+        explicit ReplyEncoder(size_t max_segments = 1 << 16);
+
+        /**
+        * add appends `metric` to the metrics of the reply in `payload`.
+        */
+        void add(const Metric& metric, std::string* payload);
+
+        /**
+        * add appends every row of `frame` to the metrics of the reply in
+        * `payload`.
+        */
+        void add(const MetricFrameBase& frame, std::string* payload);
+
+        /**
+        * add_error sets the error of the reply in `payload`.
+        */
+        static void add_error(const std::string& error, std::string* payload);
+
+        /**
+        * cached_segments returns the number of series whose static fields are
+        * cached.
+        */
+        size_t cached_segments() const;
+
+        void clear_cache();
+
+    private:
+        typedef std::unordered_map<std::string, std::string> Segments;
+
+        /**
+        * Series holds the serialized static fields of each series of a
+        * prototype, by the dynamic element values joined with '\0'. The
+        * prototype is kept so that its key is not reused while cached.
+        * Segments are only ever added to a Series, and unordered_map never
+        * moves its elements, so a segment can be read without the lock for
+        * as long as its Series is alive.
+        */
+        struct Series {
+            MetricPrototype prototype;
+            Segments segments;
+        };
+
+        /**
+        * Lookup holds the static fields of a range of rows of a frame, in
+        * order, and keeps the series they belong to alive while they are
+        * encoded. It is the scratch space of a single call to add.
+        */
+        struct Lookup {
+            std::vector<const std::string*> fixed;
+            std::vector<std::shared_ptr<Series>> pinned;
+            std::string key;
+            std::string fresh;
+        };
+
+        /**
+        * look_up fills `lookup` with the cached static fields of the rows of
+        * `frame` from `begin` to `end`, serializing and caching the missing
+        * ones.
+        */
+        void look_up(const MetricFrameBase& frame, size_t begin, size_t end,
+                     Lookup& lookup);
+
+        const size_t max_segments;
+
+        mutable std::mutex mutex;
+
+        std::unordered_map<const void*, std::shared_ptr<Series>> series;
+        size_t segment_count;
+    };
+}  // namespace Plugin
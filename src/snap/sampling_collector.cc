@@ -0,0 +1,182 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/sampling_collector.h"
+
+#include <unordered_set>
+
+using Plugin::Metric;
+using Plugin::NamespaceView;
+using Plugin::SamplingCollector;
+
+const char* const SamplingCollector::age_tag = "snapshot_age_ms";
+
+namespace {
+    /**
+    * Pin counts a reader in a snapshot buffer for as long as it lives.
+    */
+    class Pin {
+    public:
+        explicit Pin(std::atomic<int>& readers) : readers(readers) {}
+        ~Pin() { readers--; }
+
+    private:
+        std::atomic<int>& readers;
+    };
+}  // namespace
+
+SamplingCollector::SamplingCollector() :
+                                     current(-1),
+                                     sample_count(0),
+                                     taken(0),
+                                     stopping(false) {
+    readers[0] = 0;
+    readers[1] = 0;
+}
+
+SamplingCollector::~SamplingCollector() {
+    stop_sampling();
+}
+
+void SamplingCollector::register_sampler(Sampler sampler, std::chrono::milliseconds interval) {
+    if (this->sampler) {
+        throw PluginException("a sampler is already registered");
+    }
+    publish(sampler());
+    this->sampler = std::move(sampler);
+    this->interval = interval;
+    scheduler = std::thread(&SamplingCollector::schedule, this);
+}
+
+void SamplingCollector::stop_sampling() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_requested.notify_all();
+    if (scheduler.joinable()) {
+        scheduler.join();
+    }
+}
+
+std::vector<Metric> SamplingCollector::collect_metrics(std::vector<Metric> &metrics) {
+    std::unordered_set<std::string> names;
+    std::vector<NamespaceView> patterns;
+    for (const Metric& met : metrics) {
+        const NamespaceView ns = met.ns_view();
+        std::string name = ns.get_string();
+        if (ns.is_dynamic() || name.find('*') != std::string::npos) {
+            patterns.push_back(ns);
+        } else {
+            names.insert(std::move(name));
+        }
+    }
+
+    // Pin the current snapshot; should the scheduler make the other buffer
+    // current meanwhile, let go and pin that one instead.
+    int i = current.load();
+    if (i < 0) {
+        throw PluginException("no sampler is registered");
+    }
+    for (;;) {
+        readers[i]++;
+        const int now = current.load();
+        if (now == i) {
+            break;
+        }
+        readers[i]--;
+        i = now;
+    }
+    Pin pin(readers[i]);
+    const Snapshot& snapshot = snapshots[i];
+    const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - snapshot.taken);
+    const std::string age_ms = std::to_string(age.count());
+
+    std::vector<Metric> result;
+    for (size_t m = 0; m < snapshot.metrics.size(); m++) {
+        bool wanted = names.count(snapshot.names[m]) > 0;
+        if (!wanted) {
+            const NamespaceView ns(snapshot.metrics[m].namespace_());
+            for (const NamespaceView& pattern : patterns) {
+                if (pattern.matches(ns)) {
+                    wanted = true;
+                    break;
+                }
+            }
+        }
+        if (!wanted) {
+            continue;
+        }
+        const Metric view(const_cast<rpc::Metric*>(&snapshot.metrics[m]));
+        result.push_back(view);
+        result.back().add_tag({age_tag, age_ms});
+    }
+    return result;
+}
+
+std::chrono::nanoseconds SamplingCollector::snapshot_age() const {
+    if (sample_count.load() == 0) {
+        return std::chrono::nanoseconds(-1);
+    }
+    const std::chrono::steady_clock::time_point at{
+        std::chrono::steady_clock::duration(taken.load())};
+    return std::chrono::steady_clock::now() - at;
+}
+
+uint64_t SamplingCollector::samples() const {
+    return sample_count.load();
+}
+
+void SamplingCollector::schedule() {
+    auto next = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_requested.wait_until(lock, next, [this] { return stopping; })) {
+        lock.unlock();
+        try {
+            publish(sampler());
+        } catch (...) {
+            // Keep serving the previous snapshot; its age tells it is stale.
+        }
+        next += interval;
+        const auto now = std::chrono::steady_clock::now();
+        if (next < now) {
+            next = now;
+        }
+        lock.lock();
+    }
+}
+
+void SamplingCollector::publish(std::vector<Metric> sample) {
+    // Only the scheduler publishes, but for the first snapshot, so the buffer
+    // which is not current is written by this thread alone once unpinned.
+    const int i = current.load() == 0 ? 1 : 0;
+    while (readers[i].load() > 0) {
+        std::this_thread::yield();
+    }
+
+    Snapshot& snapshot = snapshots[i];
+    snapshot.metrics.clear();
+    snapshot.names.clear();
+    snapshot.metrics.reserve(sample.size());
+    snapshot.names.reserve(sample.size());
+    for (const Metric& met : sample) {
+        snapshot.metrics.push_back(*met.get_rpc_metric_ptr());
+        snapshot.names.push_back(met.ns_view().get_string());
+    }
+    snapshot.taken = std::chrono::steady_clock::now();
+
+    current.store(i);
+    taken.store(snapshot.taken.time_since_epoch().count());
+    sample_count++;
+}
@@ -0,0 +1,118 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snap/metric.h"
+#include "snap/plugin.h"
+
+namespace Plugin {
+    /**
+    * SamplingCollector is a base for collectors which sample their sources
+    * in the background rather than when metrics are requested.
+    * The plugin registers a sampler and an interval; a scheduler thread then
+    * calls the sampler every interval and publishes its metrics as the
+    * latest snapshot. collect_metrics answers from the latest snapshot
+    * without calling the sampler or taking locks, so the latency of
+    * CollectMetrics does not include the cost of sampling.
+    * The sampler is called without a config, and from the scheduler thread
+    * only.
+    */
+    class SamplingCollector : public CollectorInterface {
+    public:
+        typedef std::function<std::vector<Metric>()> Sampler;
+
+        /**
+        * age_tag is the tag every served metric carries, holding the age of
+        * its snapshot in milliseconds.
+        */
+        static const char* const age_tag;
+
+        SamplingCollector();
+        ~SamplingCollector();
+
+        /**
+        * collect_metrics returns copies of the metrics of the latest snapshot
+        * whose namespaces match any of the requested ones, in snapshot order.
+        * A requested namespace matches equal namespaces, its dynamic and "*"
+        * elements matching any value. Each copy is tagged with age_tag.
+        * Throws PluginException if no sampler was registered.
+        */
+        std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) override;
+
+        /**
+        * snapshot_age returns the time since the latest snapshot was taken,
+        * or a negative duration if none was.
+        */
+        std::chrono::nanoseconds snapshot_age() const;
+
+        /**
+        * Returns the number of snapshots taken.
+        */
+        uint64_t samples() const;
+
+    protected:
+        /**
+        * register_sampler takes a first snapshot with `sampler`, then starts
+        * the scheduler thread taking one every `interval`. Exceptions thrown
+        * by the first call are passed on; later ones are dropped, and the
+        * previous snapshot is kept. A sampler may be registered once.
+        */
+        void register_sampler(Sampler sampler, std::chrono::milliseconds interval);
+
+        /**
+        * stop_sampling stops the scheduler thread. Plugins whose sampler uses
+        * their own members must call it from their destructor; it is called
+        * again by ~SamplingCollector.
+        */
+        void stop_sampling();
+
+    private:
+        struct Snapshot {
+            std::vector<rpc::Metric> metrics;
+            std::vector<std::string> names;
+            std::chrono::steady_clock::time_point taken;
+        };
+
+        /**
+        * Snapshots are double-buffered: readers pin the current buffer by
+        * counting themselves in `readers`, and the scheduler fills the other
+        * buffer once no reader pins it, then makes it current.
+        */
+        Snapshot snapshots[2];
+        std::atomic<int> current;
+        std::atomic<int> readers[2];
+        std::atomic<uint64_t> sample_count;
+        std::atomic<std::chrono::steady_clock::rep> taken;
+
+        Sampler sampler;
+        std::chrono::milliseconds interval;
+        std::thread scheduler;
+        std::mutex stop_mutex;
+        std::condition_variable stop_requested;
+        bool stopping;
+
+        void schedule();
+        void publish(std::vector<Metric> sample);
+    };
+}  // namespace Plugin
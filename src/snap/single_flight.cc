@@ -0,0 +1,122 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/single_flight.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "snap/collect_cache.h"
+
+using Plugin::CollectCache;
+using Plugin::CollectContext;
+using Plugin::Metric;
+using Plugin::SingleFlight;
+
+SingleFlight::SingleFlight() : coalesced_calls(0) {}
+
+std::string SingleFlight::key_of(const std::vector<Metric>& metrics) {
+    std::vector<std::string> keys;
+    keys.reserve(metrics.size());
+    for (const Metric& met : metrics) {
+        keys.push_back(CollectCache::key_of(met));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::string key;
+    for (const std::string& met_key : keys) {
+        key += met_key;
+        key.push_back('\0');
+    }
+    return key;
+}
+
+SingleFlight::Result SingleFlight::run(const std::string& key,
+                                      const std::function<Result()>& collect,
+                                      const CollectContext& context) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = flights.find(key);
+    if (it != flights.end()) {
+        std::shared_ptr<Flight> flight = it->second;
+        flight->waiters++;
+        coalesced_calls++;
+        auto is_done = [&flight] { return flight->done; };
+        if (!context.has_deadline()) {
+            landed.wait(lock, is_done);
+        } else if (!landed.wait_until(lock, context.deadline(), is_done)) {
+            flight->waiters--;
+            Result late;
+            late.cut_short = true;
+            return late;
+        }
+        lock.unlock();
+        if (flight->error) {
+            std::rethrow_exception(flight->error);
+        }
+        Result copies;
+        copies.cut_short = flight->cut_short;
+        copies.metrics.reserve(flight->results->size());
+        for (const rpc::Metric& result : *flight->results) {
+            const Metric view(const_cast<rpc::Metric*>(&result));
+            copies.metrics.push_back(view);
+        }
+        return copies;
+    }
+
+    std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+    flights.emplace(key, flight);
+    lock.unlock();
+
+    Result result;
+    try {
+        result = collect();
+    } catch (...) {
+        land(key, flight, nullptr, std::current_exception());
+        throw;
+    }
+    land(key, flight, &result, nullptr);
+    return result;
+}
+
+uint64_t SingleFlight::coalesced() const {
+    return coalesced_calls.load();
+}
+
+void SingleFlight::land(const std::string& key, const std::shared_ptr<Flight>& flight,
+                        const Result* result, std::exception_ptr error) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // No call joins the flight once it is erased, so the results are only
+    // copied when some call already waits for them.
+    flights.erase(key);
+    const bool awaited = flight->waiters > 0;
+    lock.unlock();
+    if (!awaited) {
+        return;
+    }
+
+    std::shared_ptr<std::vector<rpc::Metric>> copies;
+    if (result != nullptr) {
+        copies = std::make_shared<std::vector<rpc::Metric>>();
+        copies->reserve(result->metrics.size());
+        for (const Metric& met : result->metrics) {
+            copies->push_back(*met.get_rpc_metric_ptr());
+        }
+    }
+    lock.lock();
+    flight->results = copies;
+    flight->cut_short = result != nullptr && result->cut_short;
+    flight->error = error;
+    flight->done = true;
+    lock.unlock();
+    landed.notify_all();
+}
@@ -0,0 +1,96 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snap/collect_context.h"
+#include "snap/metric.h"
+
+namespace Plugin {
+    /**
+    * SingleFlight coalesces identical collections running at the same time.
+    * A call made while another call of the same key is in flight does not
+    * collect; it waits for the call in flight and returns copies of its
+    * metrics, or rethrows its exception. A collection cut short by its
+    * deadline is passed on as such, and a waiting call gives up once its own
+    * deadline passes. CollectorImpl uses it when Meta::coalesce_collects is
+    * set.
+    * A SingleFlight may be shared between threads.
+    */
+    class SingleFlight final {
+    public:
+        SingleFlight();
+
+        SingleFlight(const SingleFlight&) = delete;
+        SingleFlight& operator=(const SingleFlight&) = delete;
+
+        /**
+        * key_of returns the identity of a collection of `metrics`: their
+        * namespaces and config fingerprints, sorted, so that the order the
+        * metrics were requested in does not matter.
+        */
+        static std::string key_of(const std::vector<Metric>& metrics);
+
+        /**
+        * Result is the outcome of a collection: its metrics, and whether it
+        * was cut short by a deadline, in which case some of the requested
+        * metrics may be missing.
+        */
+        struct Result {
+            std::vector<Metric> metrics;
+            bool cut_short = false;
+        };
+
+        /**
+        * run returns the result of `collect`, unless a call of the same key
+        * is in flight, in which case it returns copies of that call's
+        * result once it is collected. If `context` expires first, it returns
+        * no metrics, cut short.
+        */
+        Result run(const std::string& key, const std::function<Result()>& collect,
+                   const CollectContext& context = CollectContext());
+
+        /**
+        * Returns the number of calls which were served by another call's
+        * collection.
+        */
+        uint64_t coalesced() const;
+
+    private:
+        struct Flight {
+            bool done = false;
+            int waiters = 0;
+            std::shared_ptr<const std::vector<rpc::Metric>> results;
+            bool cut_short = false;
+            std::exception_ptr error;
+        };
+
+        std::mutex mutex;
+        std::condition_variable landed;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+        std::atomic<uint64_t> coalesced_calls;
+
+        void land(const std::string& key, const std::shared_ptr<Flight>& flight,
+                  const Result* result, std::exception_ptr error);
+    };
+}  // namespace Plugin
@@ -0,0 +1,93 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/string_pool.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_ref.hpp>
+
+using Plugin::InternedString;
+using Plugin::StringPool;
+
+namespace {
+    struct RefHash {
+        size_t operator()(const boost::string_ref& ref) const {
+            return boost::hash_range(ref.begin(), ref.end());
+        }
+    };
+}  // namespace
+
+/**
+* Strings maps each stored string, by a reference to its own characters, to
+* the handles sharing it. Their deleter erases it again.
+*/
+struct StringPool::Strings {
+    std::mutex mtx;
+    std::unordered_map<boost::string_ref, std::weak_ptr<const std::string>, RefHash> map;
+};
+
+InternedString::InternedString(const std::string& str) :
+                    ptr(str.empty() ? nullptr : std::make_shared<const std::string>(str)) {}
+
+InternedString::InternedString(const char* str) :
+                    InternedString(std::string(str)) {}
+
+const std::string& InternedString::str() const {
+    static const std::string empty;
+    return ptr ? *ptr : empty;
+}
+
+bool InternedString::operator==(const InternedString& that) const {
+    return ptr == that.ptr || str() == that.str();
+}
+
+StringPool::StringPool() : strings(std::make_shared<Strings>()) {}
+
+InternedString StringPool::intern(const std::string& str) {
+    if (str.empty()) {
+        return InternedString();
+    }
+    std::lock_guard<std::mutex> lock(strings->mtx);
+    auto it = strings->map.find(boost::string_ref(str));
+    if (it != strings->map.end()) {
+        if (std::shared_ptr<const std::string> stored = it->second.lock()) {
+            return InternedString(std::move(stored));
+        }
+        // The last handle is being dropped; its deleter leaves the new copy
+        // alone.
+        strings->map.erase(it);
+    }
+
+    std::weak_ptr<Strings> pool = strings;
+    std::shared_ptr<const std::string> stored(new std::string(str),
+        [pool](const std::string* dropped) {
+            if (std::shared_ptr<Strings> strings = pool.lock()) {
+                std::lock_guard<std::mutex> lock(strings->mtx);
+                auto it = strings->map.find(boost::string_ref(*dropped));
+                if (it != strings->map.end() && it->first.data() == dropped->data()) {
+                    strings->map.erase(it);
+                }
+            }
+            delete dropped;
+        });
+    strings->map.emplace(boost::string_ref(*stored), stored);
+    return InternedString(std::move(stored));
+}
+
+size_t StringPool::size() const {
+    std::lock_guard<std::mutex> lock(strings->mtx);
+    return strings->map.size();
+}
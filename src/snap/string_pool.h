@@ -0,0 +1,95 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace Plugin {
+    /**
+    * InternedString is a handle to an immutable string. Copies of a handle
+    * share the string. Handles obtained from the same StringPool for equal
+    * strings share a single copy, so that repeated strings are kept in memory
+    * once; other handles own their string.
+    */
+    class InternedString {
+    public:
+        /**
+        * Default constructor; the handle refers to the empty string.
+        */
+        InternedString() = default;
+
+        /**
+        * Makes a handle owning a copy of `str`, which is not interned.
+        */
+        InternedString(const std::string& str);
+        InternedString(const char* str);
+
+        const std::string& str() const;
+        operator const std::string&() const { return str(); }
+
+        /**
+        * id identifies the stored string; it is the same for all handles
+        * sharing it.
+        */
+        const void* id() const { return ptr.get(); }
+
+        /**
+        * Handles are equal when their strings are. Handles sharing a string
+        * are compared without reading it.
+        */
+        bool operator==(const InternedString& that) const;
+        bool operator!=(const InternedString& that) const { return !(*this == that); }
+
+    private:
+        friend class StringPool;
+        explicit InternedString(std::shared_ptr<const std::string> ptr) : ptr(std::move(ptr)) {}
+
+        std::shared_ptr<const std::string> ptr;
+    };
+
+    /**
+    * StringPool hands out InternedStrings sharing a single copy of each
+    * distinct string. It is safe to use from multiple threads.
+    * Nothing is interned implicitly: a plugin keeping a large catalog of
+    * namespaces owns a pool and interns them into it.
+    * @see Namespace::intern
+    * A string is kept as long as some handle refers to it, and dropped from
+    * the pool with its last handle, so that a pool does not grow with
+    * values that come and go, like process ids. Handles may outlive their
+    * pool.
+    */
+    class StringPool {
+    public:
+        StringPool();
+        StringPool(const StringPool&) = delete;
+        StringPool& operator=(const StringPool&) = delete;
+
+        /**
+        * intern returns a handle to the stored copy of `str`, storing it first
+        * if it is not in the pool yet. The empty string is never stored.
+        */
+        InternedString intern(const std::string& str);
+
+        /**
+        * size returns the number of distinct strings stored.
+        */
+        size_t size() const;
+
+    private:
+        struct Strings;
+
+        std::shared_ptr<Strings> strings;
+    };
+}  // namespace Plugin
@@ -0,0 +1,154 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/work_stealing_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+using Plugin::WorkStealingPool;
+
+struct WorkStealingPool::Batch {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+    std::exception_ptr error;
+};
+
+WorkStealingPool::WorkStealingPool(size_t threads) :
+                                   next_queue(0),
+                                   queued(0),
+                                   stopping(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        this->threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+size_t WorkStealingPool::size() const {
+    return threads.size();
+}
+
+void WorkStealingPool::run(const std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    Batch batch;
+    batch.remaining = tasks.size();
+
+    // The first task is kept for the calling thread. The others are counted
+    // before they are queued, so that the count never drops below zero.
+    if (tasks.size() > 1) {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            queued += tasks.size() - 1;
+        }
+        for (size_t i = 1; i < tasks.size(); i++) {
+            Queue& queue = *queues[next_queue++ % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(Task{&tasks[i], &batch});
+        }
+        idle.notify_all();
+    }
+
+    execute(Task{&tasks[0], &batch});
+    // Help with the tasks of the batch no pool thread has taken yet, then
+    // wait for the ones in progress.
+    Task task;
+    while (take(0, &batch, &task)) {
+        execute(task);
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void WorkStealingPool::work(size_t index) {
+    Task task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle.wait(lock, [this] { return queued > 0 || stopping; });
+            if (stopping) {
+                return;
+            }
+        }
+        while (take(index, nullptr, &task)) {
+            execute(task);
+        }
+    }
+}
+
+bool WorkStealingPool::take(size_t index, const Batch* only, Task* task) {
+    // Own queue from the back, the others from the front.
+    for (size_t i = 0; i < queues.size(); i++) {
+        Queue& queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (only != nullptr) {
+            auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(),
+                                   [only](const Task& t) { return t.batch == only; });
+            if (it == queue.tasks.end()) {
+                continue;
+            }
+            *task = *it;
+            queue.tasks.erase(it);
+        } else if (queue.tasks.empty()) {
+            continue;
+        } else if (i == 0) {
+            *task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            *task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        std::lock_guard<std::mutex> idle_lock(idle_mutex);
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(const Task& task) {
+    std::exception_ptr error;
+    try {
+        (*task.function)();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    Batch& batch = *task.batch;
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if (error && !batch.error) {
+        batch.error = error;
+    }
+    if (--batch.remaining == 0) {
+        batch.done.notify_all();
+    }
+}
@@ -0,0 +1,86 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Plugin {
+    /**
+    * WorkStealingPool runs batches of independent tasks on a fixed set of
+    * threads. Each thread owns a queue; a batch is dealt round-robin across
+    * the queues, and a thread whose queue runs dry steals from the others, so
+    * that slow tasks do not hold back the ones queued behind them.
+    * The thread submitting a batch runs its tasks too, and run returns once
+    * every task of the batch has returned. Batches may be submitted from
+    * several threads at once.
+    */
+    class WorkStealingPool final {
+    public:
+        /**
+        * threads is the number of threads owned by the pool; 0 stands for one
+        * per core.
+        */
+        explicit WorkStealingPool(size_t threads);
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        /**
+        * run calls every task of `tasks` and waits for them to return. When
+        * tasks throw, the first exception caught is rethrown, once all tasks
+        * are done.
+        */
+        void run(const std::vector<std::function<void()>>& tasks);
+
+        /**
+        * Returns the number of threads owned by the pool.
+        */
+        size_t size() const;
+
+    private:
+        struct Batch;
+
+        struct Task {
+            const std::function<void()>* function;
+            Batch* batch;
+        };
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> next_queue;
+
+        std::mutex idle_mutex;
+        std::condition_variable idle;
+        size_t queued;
+        bool stopping;
+
+        void work(size_t index);
+        bool take(size_t index, const Batch* only, Task* task);
+        void execute(const Task& task);
+    };
+}  // namespace Plugin
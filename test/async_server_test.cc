@@ -0,0 +1,165 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/async_server.h"
+#include "gmock/gmock.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include "snap/rpc/plugin.grpc.pb.h"
+
+#include "mocks.h"
+
+using Plugin::AsyncServer;
+using Plugin::Meta;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using std::vector;
+
+namespace {
+    /**
+    * Serves `plugin` with an AsyncServer on a local port for the lifetime of
+    * the fixture.
+    */
+    class LocalAsyncServer {
+    public:
+        LocalAsyncServer(Plugin::PluginInterface* plugin, const Meta* meta) :
+                         async(plugin, meta) {
+            grpc::ServerBuilder builder;
+            int port = 0;
+            builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+            async.configure(builder);
+            server = builder.BuildAndStart();
+            async.start();
+            channel = grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                          grpc::InsecureChannelCredentials());
+        }
+
+        ~LocalAsyncServer() {
+            async.shutdown(*server);
+        }
+
+        AsyncServer async;
+        std::unique_ptr<grpc::Server> server;
+        std::shared_ptr<grpc::Channel> channel;
+    };
+}  // namespace
+
+TEST(AsyncServerTest, ServesCollector) {
+    MockCollector mockee;
+    ON_CALL(mockee, get_config_policy())
+            .WillByDefault(Return(mockee.fake_policy));
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke([](vector<Metric>& metrics) {
+                for (Metric& met : metrics) {
+                    met.set_data((int64_t)42);
+                }
+                return metrics;
+            }));
+    Meta meta(Plugin::Collector, "mock", 1);
+    meta.polling_threads = 2;
+    LocalAsyncServer local(&mockee, &meta);
+    EXPECT_EQ(2, local.async.thread_count());
+    auto stub = rpc::Collector::NewStub(local.channel);
+
+    // More calls in flight than polling threads.
+    vector<std::thread> clients;
+    for (int c = 0; c < 4; c++) {
+        clients.emplace_back([&stub] {
+            for (int i = 0; i < 10; i++) {
+                grpc::ClientContext context;
+                rpc::MetricsArg arg;
+                arg.add_metrics()->add_namespace_()->set_value("foo");
+                rpc::MetricsReply reply;
+                grpc::Status status = stub->CollectMetrics(&context, arg, &reply);
+                EXPECT_TRUE(status.ok()) << status.error_message();
+                ASSERT_EQ(1, reply.metrics_size());
+                EXPECT_EQ(42, reply.metrics(0).int64_data());
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    grpc::ClientContext context;
+    rpc::Empty empty;
+    rpc::GetConfigPolicyReply policy;
+    EXPECT_TRUE(stub->GetConfigPolicy(&context, empty, &policy).ok());
+    EXPECT_EQ(1, policy.string_policy_size());
+}
+
+TEST(AsyncServerTest, ReportsPluginErrors) {
+    MockPublisher mockee;
+    ON_CALL(mockee, publish_metrics(_, _))
+            .WillByDefault(Invoke([](vector<Metric>&, const Config&) {
+                throw Plugin::PluginException("publish failed");
+            }));
+    Meta meta(Plugin::Publisher, "mock", 1);
+    meta.polling_threads = 1;
+    LocalAsyncServer local(&mockee, &meta);
+    auto stub = rpc::Publisher::NewStub(local.channel);
+
+    grpc::ClientContext context;
+    rpc::PubProcArg arg;
+    rpc::ErrReply reply;
+    grpc::Status status = stub->Publish(&context, arg, &reply);
+    EXPECT_EQ(grpc::StatusCode::UNKNOWN, status.error_code());
+    EXPECT_EQ("publish failed", status.error_message());
+}
+
+TEST(AsyncServerTest, ServesProcessor) {
+    MockProcessor mockee;
+    ON_CALL(mockee, process_metrics(_, _))
+            .WillByDefault(Invoke([](vector<Metric>& metrics, const Config&) {
+                for (Metric& met : metrics) {
+                    met.add_tag({"processed", "true"});
+                }
+            }));
+    Meta meta(Plugin::Processor, "mock", 1);
+    LocalAsyncServer local(&mockee, &meta);
+    EXPECT_LE(1, local.async.thread_count());
+    auto stub = rpc::Processor::NewStub(local.channel);
+
+    grpc::ClientContext context;
+    rpc::PubProcArg arg;
+    arg.add_metrics()->add_namespace_()->set_value("foo");
+    rpc::MetricsReply reply;
+    EXPECT_TRUE(stub->Process(&context, arg, &reply).ok());
+    ASSERT_EQ(1, reply.metrics_size());
+    EXPECT_EQ("true", reply.metrics(0).tags().at("processed"));
+}
+
+TEST(AsyncServerTest, RejectsStreamCollectors) {
+    MockStreamCollector mockee;
+    Meta meta(Plugin::StreamCollector, "mock", 1);
+    EXPECT_FALSE(AsyncServer::supports(Plugin::StreamCollector));
+    EXPECT_THROW(AsyncServer(&mockee, &meta), Plugin::PluginException);
+}
+
+TEST(AsyncServerTest, DrainsWithoutStart) {
+    MockCollector mockee;
+    Meta meta(Plugin::Collector, "mock", 1);
+    meta.polling_threads = 3;
+    AsyncServer async(&mockee, &meta);
+    grpc::ServerBuilder builder;
+    async.configure(builder);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    async.shutdown(*server);
+}
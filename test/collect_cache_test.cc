@@ -0,0 +1,205 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/collect_cache.h"
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mocks.h"
+
+using Plugin::CollectCache;
+using Plugin::Config;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+using ::testing::_;
+using ::testing::Invoke;
+using std::vector;
+
+string extract_ns(const Metric& metric);
+string extract_ns(const rpc::Metric& metric);
+
+namespace {
+    rpc::Metric request(Namespace ns, const std::string& path = "") {
+        rpc::Metric met = *Metric(ns, "", "").get_rpc_metric_ptr();
+        if (!path.empty()) {
+            Config(*met.mutable_config()).set_string("path", path);
+        }
+        return met;
+    }
+
+    /**
+    * collect runs `requested` through the cache, as CollectorImpl does, with
+    * `collected` standing in for collect_metrics. It returns the number of
+    * metrics passed to collect_metrics, and the reply in `reply`.
+    */
+    size_t collect(CollectCache& cache, vector<rpc::Metric> requested,
+                   const vector<rpc::Metric>& collected, vector<Metric>& reply) {
+        vector<Metric> metrics, hits, misses;
+        vector<CollectCache::Miss> missed;
+        for (auto& met : requested) {
+            metrics.emplace_back(&met);
+        }
+        cache.split(metrics, hits, misses, missed);
+        EXPECT_EQ(misses.size(), missed.size());
+        reply.clear();
+        if (!misses.empty()) {
+            for (auto met : collected) {
+                // An owned copy, as the plugin would return.
+                const Metric view(&met);
+                reply.push_back(view);
+            }
+            cache.store(missed, reply);
+        }
+        for (auto& met : hits) {
+            reply.push_back(std::move(met));
+        }
+        return misses.size();
+    }
+}  // namespace
+
+TEST(CollectCacheTest, ServesResultsWithinTTL) {
+    CollectCache cache(std::chrono::hours(1));
+    vector<rpc::Metric> requested = {request(Namespace({"intel", "load"}))};
+    vector<rpc::Metric> collected = requested;
+    collected[0].set_int64_data(3);
+    vector<Metric> reply;
+
+    EXPECT_EQ(1, collect(cache, requested, collected, reply));
+    ASSERT_EQ(1, reply.size());
+    EXPECT_EQ(3, reply[0].get_int64_data());
+
+    collected[0].set_int64_data(4);
+    EXPECT_EQ(0, collect(cache, requested, collected, reply));
+    ASSERT_EQ(1, reply.size());
+    EXPECT_EQ("/intel/load", extract_ns(reply[0]));
+    EXPECT_EQ(3, reply[0].get_int64_data());
+
+    CollectCache::Stats stats = cache.stats();
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(1, stats.entries);
+}
+
+TEST(CollectCacheTest, CollectsAgainOnceExpired) {
+    CollectCache cache(std::chrono::milliseconds(10));
+    vector<rpc::Metric> requested = {request(Namespace({"intel", "load"}))};
+    vector<Metric> reply;
+
+    EXPECT_EQ(1, collect(cache, requested, requested, reply));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(1, collect(cache, requested, requested, reply));
+    EXPECT_EQ(2, cache.stats().misses);
+
+    cache.clear();
+    EXPECT_EQ(0, cache.stats().entries);
+}
+
+TEST(CollectCacheTest, KeysByConfig) {
+    CollectCache cache(std::chrono::hours(1));
+    vector<Metric> reply;
+    vector<rpc::Metric> sda = {request(Namespace({"intel", "disk"}), "/dev/sda")};
+    vector<rpc::Metric> sdb = {request(Namespace({"intel", "disk"}), "/dev/sdb")};
+
+    EXPECT_EQ(1, collect(cache, sda, sda, reply));
+    EXPECT_EQ(1, collect(cache, sdb, sdb, reply));
+    EXPECT_EQ(0, collect(cache, sda, sda, reply));
+    EXPECT_EQ(2, cache.stats().entries);
+}
+
+TEST(CollectCacheTest, FilesResultsUnderMatchingRequest) {
+    CollectCache cache(std::chrono::hours(1));
+    vector<rpc::Metric> requested = {
+        request(Namespace({"intel", "load"})),
+        request(Namespace({"intel"}).add_dynamic_element("cpu").add_static_element("user")),
+        request(Namespace({"intel", "*", "idle"})),
+    };
+    vector<rpc::Metric> collected = {
+        request(Namespace({"intel", "0", "user"})),
+        request(Namespace({"intel", "1", "user"})),
+        request(Namespace({"intel", "0", "idle"})),
+    };
+    vector<Metric> reply;
+
+    EXPECT_EQ(3, collect(cache, requested, collected, reply));
+    EXPECT_EQ(0, collect(cache, {requested[1]}, {}, reply));
+    ASSERT_EQ(2, reply.size());
+    EXPECT_EQ("/intel/0/user", extract_ns(reply[0]));
+    EXPECT_EQ("/intel/1/user", extract_ns(reply[1]));
+
+    EXPECT_EQ(0, collect(cache, {requested[2]}, {}, reply));
+    ASSERT_EQ(1, reply.size());
+    EXPECT_EQ("/intel/0/idle", extract_ns(reply[0]));
+
+    // The load metric was requested but not returned.
+    EXPECT_EQ(0, collect(cache, {requested[0]}, {}, reply));
+    EXPECT_EQ(0, reply.size());
+}
+
+TEST(CollectCacheTest, StopsCachingWhenFull) {
+    CollectCache cache(std::chrono::hours(1), 1);
+    vector<Metric> reply;
+    vector<rpc::Metric> load = {request(Namespace({"intel", "load"}))};
+    vector<rpc::Metric> idle = {request(Namespace({"intel", "idle"}))};
+
+    EXPECT_EQ(1, collect(cache, load, load, reply));
+    EXPECT_EQ(1, collect(cache, idle, idle, reply));
+    EXPECT_EQ(1, collect(cache, idle, idle, reply));
+    EXPECT_EQ(0, collect(cache, load, load, reply));
+    EXPECT_EQ(1, cache.stats().entries);
+}
+
+TEST(CollectCacheTest, CollectorProxyServesCachedMetrics) {
+    MockCollector mockee;
+    int calls = 0;
+    vector<size_t> sizes;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        sizes.push_back(metrics.size());
+        calls++;
+        for (auto& met : metrics) {
+            met.set_data((int64_t)calls);
+        }
+        return metrics;
+    };
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    Plugin::Meta meta(Plugin::Collector, "mock", 1);
+    meta.collect_cache = true;
+    meta.cache_ttl = std::chrono::hours(1);
+    CollectorImpl collector(&mockee, &meta);
+    ASSERT_NE(nullptr, collector.collect_cache());
+
+    rpc::MetricsArg first, second;
+    *first.add_metrics() = request(Namespace({"intel", "load"}));
+    *second.add_metrics() = request(Namespace({"intel", "idle"}));
+    *second.add_metrics() = request(Namespace({"intel", "load"}));
+    rpc::MetricsReply resp;
+    EXPECT_TRUE(collector.CollectMetrics(nullptr, &first, &resp).ok());
+    resp.Clear();
+    EXPECT_TRUE(collector.CollectMetrics(nullptr, &second, &resp).ok());
+
+    EXPECT_EQ(vector<size_t>({1, 1}), sizes);
+    ASSERT_EQ(2, resp.metrics_size());
+    EXPECT_EQ("/intel/idle", extract_ns(resp.metrics(0)));
+    EXPECT_EQ(2, resp.metrics(0).int64_data());
+    EXPECT_EQ("/intel/load", extract_ns(resp.metrics(1)));
+    EXPECT_EQ(1, resp.metrics(1).int64_data());
+    EXPECT_EQ(1, collector.collect_cache()->stats().hits);
+    EXPECT_EQ(2, collector.collect_cache()->stats().misses);
+}
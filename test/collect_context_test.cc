@@ -0,0 +1,266 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/collect_context.h"
+#include "snap/metric_frame.h"
+#include "snap/metric_prototype.h"
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include "mocks.h"
+
+using Plugin::CollectContext;
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Meta;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Invoke;
+using std::vector;
+
+namespace {
+    /**
+    * PatientCollector takes 30ms per metric, and stops once its context
+    * expired.
+    */
+    class PatientCollector final : public Plugin::CollectorInterface {
+    public:
+        const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+        std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+        std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+            return collect_metrics_until(metrics, CollectContext());
+        }
+
+        std::vector<Metric> collect_metrics_until(std::vector<Metric> &metrics,
+                                                  const CollectContext& context) {
+            std::vector<Metric> result;
+            for (auto& met : metrics) {
+                if (context.expired()) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                met.set_data((int64_t)42);
+                result.push_back(std::move(met));
+            }
+            return result;
+        }
+    };
+
+    /**
+    * FrameCollector returns the reads of sd0 as a frame, and nothing else
+    * before its context expires.
+    */
+    class FrameCollector final : public Plugin::CollectorInterface {
+    public:
+        const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+        std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+        std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+            return {};
+        }
+
+        std::vector<Metric> collect_metrics_until(std::vector<Metric> &metrics,
+                                                  const CollectContext& context) {
+            while (!context.expired()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return {};
+        }
+
+        Plugin::MetricFrames collect_frames(const std::vector<Metric> &metrics) {
+            Plugin::MetricPrototype reads(Namespace({"intel"}).add_dynamic_element("source")
+                                                              .add_static_element("reads"));
+            std::unique_ptr<Plugin::MetricFrame<int64_t>> frame(
+                new Plugin::MetricFrame<int64_t>(reads));
+            frame->add({frame->encode(0, "sd0")}, 42);
+            Plugin::MetricFrames frames;
+            frames.push_back(std::move(frame));
+            return frames;
+        }
+    };
+
+    /**
+    * Serves `plugin` with a CollectorImpl on a local port for the lifetime
+    * of the fixture.
+    */
+    class LocalCollector {
+    public:
+        LocalCollector(Plugin::CollectorInterface* plugin, const Meta* meta) :
+                       impl(plugin, meta) {
+            grpc::ServerBuilder builder;
+            int port = 0;
+            builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+            builder.RegisterService(&impl);
+            server = builder.BuildAndStart();
+            auto channel = grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                               grpc::InsecureChannelCredentials());
+            stub = rpc::Collector::NewStub(channel);
+        }
+
+        ~LocalCollector() {
+            server->Shutdown();
+        }
+
+        /**
+        * collect requests `sources`, giving the call `timeout`.
+        */
+        grpc::Status collect(const vector<string>& sources, std::chrono::milliseconds timeout,
+                             rpc::MetricsReply* reply) {
+            grpc::ClientContext context;
+            context.set_deadline(std::chrono::system_clock::now() + timeout);
+            rpc::MetricsArg arg;
+            for (const string& source : sources) {
+                Metric met(Namespace({"intel", source, "reads"}), "", "");
+                *arg.add_metrics() = *met.get_rpc_metric_ptr();
+            }
+            return stub->CollectMetrics(&context, arg, reply);
+        }
+
+        CollectorImpl impl;
+        std::unique_ptr<grpc::Server> server;
+        std::unique_ptr<rpc::Collector::Stub> stub;
+    };
+
+    vector<string> sources(int count) {
+        vector<string> names;
+        for (int i = 0; i < count; i++) {
+            names.push_back("sd" + std::to_string(i));
+        }
+        return names;
+    }
+}  // namespace
+
+TEST(CollectContextTest, ExpiresAtDeadline) {
+    CollectContext forever;
+    EXPECT_FALSE(forever.has_deadline());
+    EXPECT_FALSE(forever.expired());
+    EXPECT_EQ(CollectContext::Clock::duration::max(), forever.remaining());
+
+    CollectContext soon(CollectContext::Clock::now() + std::chrono::milliseconds(20));
+    EXPECT_TRUE(soon.has_deadline());
+    EXPECT_FALSE(soon.expired());
+    EXPECT_LT(CollectContext::Clock::duration::zero(), soon.remaining());
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    EXPECT_TRUE(soon.expired());
+    EXPECT_EQ(CollectContext::Clock::duration::zero(), soon.remaining());
+}
+
+TEST(CollectContextTest, CollectorProxyRepliesPartialResults) {
+    PatientCollector plugin;
+    Meta meta(Plugin::Collector, "patient", 1);
+    meta.deadline_margin = std::chrono::milliseconds(100);
+    LocalCollector local(&plugin, &meta);
+
+    rpc::MetricsReply reply;
+    grpc::Status status = local.collect(sources(20), std::chrono::milliseconds(400), &reply);
+
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_LT(0, reply.metrics_size());
+    EXPECT_GT(20, reply.metrics_size());
+    EXPECT_THAT(reply.error(), HasSubstr("deadline exceeded, missing "));
+    EXPECT_THAT(reply.error(), HasSubstr("intel/sd19/reads"));
+    EXPECT_THAT(reply.error(), ::testing::Not(HasSubstr("intel/sd0/reads,")));
+}
+
+TEST(CollectContextTest, CollectorProxyRepliesAllWithinDeadline) {
+    PatientCollector plugin;
+    Meta meta(Plugin::Collector, "patient", 1);
+    LocalCollector local(&plugin, &meta);
+
+    rpc::MetricsReply reply;
+    grpc::Status status = local.collect(sources(3), std::chrono::seconds(10), &reply);
+
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_EQ(3, reply.metrics_size());
+    EXPECT_EQ("", reply.error());
+}
+
+TEST(CollectContextTest, ShardedCollectionLeavesOutLateShards) {
+    MockCollector mockee;
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke([](vector<Metric>& metrics) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return metrics;
+            }));
+    Meta meta(Plugin::Collector, "mock", 1);
+    meta.collect_threads = 1;
+    meta.deadline_margin = std::chrono::milliseconds(100);
+    LocalCollector local(&mockee, &meta);
+
+    rpc::MetricsReply reply;
+    grpc::Status status = local.collect(sources(10), std::chrono::milliseconds(400), &reply);
+
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_LT(0, reply.metrics_size());
+    EXPECT_GT(10, reply.metrics_size());
+    EXPECT_THAT(reply.error(), HasSubstr("deadline exceeded, missing "));
+}
+
+TEST(CollectContextTest, CollectorProxyCountsFrameRows) {
+    FrameCollector plugin;
+    Meta meta(Plugin::Collector, "frames", 1);
+    meta.deadline_margin = std::chrono::milliseconds(100);
+    LocalCollector local(&plugin, &meta);
+
+    rpc::MetricsReply reply;
+    grpc::Status status = local.collect(sources(2), std::chrono::milliseconds(200), &reply);
+
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_EQ(1, reply.metrics_size());
+    EXPECT_THAT(reply.error(), HasSubstr("intel/sd1/reads"));
+    EXPECT_THAT(reply.error(), ::testing::Not(HasSubstr("sd0")));
+}
+
+TEST(CollectContextTest, CoalescedPartialResultsAreNotCached) {
+    PatientCollector plugin;
+    Meta meta(Plugin::Collector, "patient", 1);
+    meta.deadline_margin = std::chrono::milliseconds(100);
+    meta.collect_cache = true;
+    meta.coalesce_collects = true;
+    LocalCollector local(&plugin, &meta);
+
+    // the second call joins the collection of the first, which is cut short.
+    rpc::MetricsReply short_reply, joined_reply;
+    std::thread first([&] {
+        local.collect(sources(20), std::chrono::milliseconds(400), &short_reply);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    grpc::Status status = local.collect(sources(20), std::chrono::seconds(10), &joined_reply);
+    first.join();
+
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_EQ(1, local.impl.single_flight()->coalesced());
+    EXPECT_GT(20, joined_reply.metrics_size());
+    EXPECT_THAT(joined_reply.error(), HasSubstr("deadline exceeded, missing "));
+
+    rpc::MetricsReply full_reply;
+    status = local.collect(sources(20), std::chrono::seconds(10), &full_reply);
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_EQ(20, full_reply.metrics_size());
+    EXPECT_EQ("", full_reply.error());
+}
@@ -16,6 +16,8 @@ limitations under the License.
 #include <snap/proxy/collector_proxy.h>
 #include "gmock/gmock.h"
 
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -100,6 +102,158 @@ TEST(CollectorProxySuccessTest, CollectMetricsWorks) {
     EXPECT_EQ("/foo/bar", ns_str);
 }
 
+TEST(CollectorProxySuccessTest, CollectMetricsWithArenaWorks) {
+    MockCollector mockee;
+    rpc::MetricsReply resp;
+    grpc::Status status;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        vector<Metric> result;
+        for (auto& met : metrics) {
+            met.set_data((int64_t)7);
+            result.push_back(met);
+        }
+        return result;
+    };
+    Plugin::Meta meta(Plugin::Collector, "mock", 1);
+    meta.arena_allocation = true;
+
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    EXPECT_NO_THROW({
+                        CollectorImpl collector(&mockee, &meta);
+                        rpc::MetricsArg args;
+                        *args.add_metrics() = *mockee.fake_metric.get_rpc_metric_ptr();
+                        *args.add_metrics() = *mockee.fake_metric.get_rpc_metric_ptr();
+                        status = collector.CollectMetrics(nullptr, &args, &resp);
+                    });
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    ASSERT_EQ(2, resp.metrics_size());
+    EXPECT_EQ(7, resp.metrics(1).int64_data());
+    EXPECT_EQ("/foo/bar", extract_ns(resp.metrics(1)));
+}
+
+TEST(CollectorProxySuccessTest, CollectMetricsDoesNotCopyMetrics) {
+    MockCollector mockee;
+    rpc::MetricsReply resp;
+    grpc::Status status;
+    int copies = -1;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        std::set<const rpc::Metric*> requested;
+        for (const Metric& met : metrics) {
+            requested.insert(met.get_rpc_metric_ptr());
+        }
+        vector<Metric> result;
+        for (Metric& met : metrics) {
+            result.push_back(std::move(met));
+        }
+        copies = 0;
+        for (const Metric& met : result) {
+            if (!requested.count(met.get_rpc_metric_ptr())) copies++;
+        }
+        return result;
+    };
+
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    EXPECT_NO_THROW({
+                        CollectorImpl collector(&mockee);
+                        rpc::MetricsArg args;
+                        for (int i = 0; i < 50; i++) {
+                            *args.add_metrics() = *mockee.fake_metric.get_rpc_metric_ptr();
+                        }
+                        status = collector.CollectMetrics(nullptr, &args, &resp);
+                    });
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    EXPECT_EQ(50, resp.metrics_size());
+    EXPECT_EQ(0, copies);
+}
+
+TEST(CollectorProxySuccessTest, CollectMetricsSplicesReply) {
+    MockCollector mockee;
+    rpc::MetricsReply resp;
+    grpc::Status status;
+    std::set<const rpc::Metric*> collected;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        vector<Metric> result;
+        for (int i = 0; i < 50; i++) {
+            result.emplace_back(Plugin::Namespace({"foo", std::to_string(i)}), "", "");
+            collected.insert(result.back().get_rpc_metric_ptr());
+        }
+        return result;
+    };
+
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    EXPECT_NO_THROW({
+                        CollectorImpl collector(&mockee);
+                        rpc::MetricsArg args;
+                        *args.add_metrics() = *mockee.fake_metric.get_rpc_metric_ptr();
+                        status = collector.CollectMetrics(nullptr, &args, &resp);
+                    });
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    ASSERT_EQ(50, resp.metrics_size());
+    int copies = 0;
+    for (const rpc::Metric& met : resp.metrics()) {
+        if (!collected.count(&met)) copies++;
+    }
+    EXPECT_EQ(0, copies);
+    EXPECT_EQ("49", resp.metrics(49).namespace_(1).value());
+}
+
+TEST(CollectorProxySuccessTest, CollectMetricsWrapsRequestInPlace) {
+    MockCollector mockee;
+    RequestCopies copies;
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke([&] (vector<Metric> &metrics) {
+                copies.count(metrics);
+                return vector<Metric>();
+            }));
+
+    CollectorImpl collector(&mockee);
+    rpc::MetricsReply resp;
+    copies.send_batches<rpc::MetricsArg>(mockee.fake_metric, [&] (rpc::MetricsArg* args) {
+        return collector.CollectMetrics(nullptr, args, &resp);
+    });
+    EXPECT_EQ(vector<int>({0, 0, 0}), copies.copied);
+}
+
+TEST(CollectorProxySuccessTest, CollectMetricsInParallelWorks) {
+    MockCollector mockee;
+    std::mutex mutex;
+    std::multiset<string> shards;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        std::lock_guard<std::mutex> lock(mutex);
+        shards.insert(metrics.at(0).ns().get_string());
+        for (auto& met : metrics) {
+            met.set_data((int64_t)metrics.size());
+        }
+        return metrics;
+    };
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    Plugin::Meta meta(Plugin::Collector, "mock", 1);
+    meta.collect_threads = 2;
+
+    rpc::MetricsArg args;
+    for (auto& source : {"sda", "sdb", "sda", "sdc"}) {
+        Metric met(Namespace({"intel", "disk", source, "reads"}), "", "");
+        *args.add_metrics() = *met.get_rpc_metric_ptr();
+    }
+    rpc::MetricsReply resp;
+    CollectorImpl collector(&mockee, &meta);
+    grpc::Status status = collector.CollectMetrics(nullptr, &args, &resp);
+
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    EXPECT_EQ(3, shards.size());
+    ASSERT_EQ(4, resp.metrics_size());
+    EXPECT_EQ("/intel/disk/sda/reads", extract_ns(resp.metrics(0)));
+    EXPECT_EQ("/intel/disk/sda/reads", extract_ns(resp.metrics(1)));
+    EXPECT_EQ(2, resp.metrics(1).int64_data());
+    EXPECT_EQ("/intel/disk/sdb/reads", extract_ns(resp.metrics(2)));
+    EXPECT_EQ("/intel/disk/sdc/reads", extract_ns(resp.metrics(3)));
+    EXPECT_EQ(1, resp.metrics(3).int64_data());
+}
+
 TEST(CollectorProxySuccessTest, PingWorks) {
     MockCollector mockee;
     rpc::ErrReply resp;
@@ -169,3 +323,28 @@ TEST(CollectorProxyFailureTest, CollectMetricsReportsError) {
     EXPECT_EQ(grpc::StatusCode::UNKNOWN, status.error_code());
     EXPECT_EQ("nothing to look at", status.error_message());
 }
+
+TEST(CollectorProxyFailureTest, CollectMetricsInParallelReportsError) {
+    MockCollector mockee;
+    auto reporter = [&] (vector<Metric> &metrics) {
+        if (metrics.at(0).ns()[2].get_value() == "sdb") {
+            throw Plugin::PluginException("sdb is gone");
+        }
+        return metrics;
+    };
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+    Plugin::Meta meta(Plugin::Collector, "mock", 1);
+    meta.collect_threads = 2;
+
+    rpc::MetricsArg args;
+    for (auto& source : {"sda", "sdb", "sdc"}) {
+        Metric met(Namespace({"intel", "disk", source, "reads"}), "", "");
+        *args.add_metrics() = *met.get_rpc_metric_ptr();
+    }
+    rpc::MetricsReply resp;
+    CollectorImpl collector(&mockee, &meta);
+    grpc::Status status = collector.CollectMetrics(nullptr, &args, &resp);
+    EXPECT_EQ(grpc::StatusCode::UNKNOWN, status.error_code());
+    EXPECT_EQ("sdb is gone", resp.error());
+}
@@ -0,0 +1,244 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/compiled_config_policy.h"
+#include "snap/plugin.h"
+#include "snap/proxy/collector_proxy.h"
+#include "snap/proxy/publisher_proxy.h"
+#include "gmock/gmock.h"
+
+#include <string>
+#include <vector>
+
+#include "mocks.h"
+
+using Plugin::CompiledConfigPolicy;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::NamespaceView;
+using Plugin::PluginException;
+using Plugin::Proxy::CollectorImpl;
+using Plugin::Proxy::PublisherImpl;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using std::string;
+using std::vector;
+
+namespace {
+    ConfigPolicy db_policy() {
+        ConfigPolicy policy;
+        policy.add_rule({""}, Plugin::StringRule{"host", {"localhost", false}});
+        policy.add_rule({""}, Plugin::StringRule{"user", true});
+        policy.add_rule({""}, Plugin::IntRule{"port", {5432, false, 1024, 32767}});
+        policy.add_rule({""}, Plugin::BoolRule{"tls", {false, false}});
+        return policy;
+    }
+
+    rpc::NamespaceElement element(const string& value) {
+        rpc::NamespaceElement elem;
+        elem.set_value(value);
+        return elem;
+    }
+}  // namespace
+
+TEST(CompiledConfigPolicyTest, FillsDefaults) {
+    CompiledConfigPolicy policy(db_policy());
+    EXPECT_EQ(4, policy.size());
+
+    rpc::ConfigMap map;
+    (*map.mutable_stringmap())["user"] = "admin";
+    (*map.mutable_intmap())["port"] = 2000;
+    policy.apply(map);
+
+    EXPECT_EQ("admin", map.stringmap().at("user"));
+    EXPECT_EQ("localhost", map.stringmap().at("host"));
+    EXPECT_EQ(2000, map.intmap().at("port"));
+    EXPECT_FALSE(map.boolmap().at("tls"));
+}
+
+TEST(CompiledConfigPolicyTest, MatchesApplyDefaults) {
+    ConfigPolicy cpolicy = db_policy();
+    rpc::ConfigMap compiled, applied;
+    (*compiled.mutable_stringmap())["user"] = "admin";
+    applied = compiled;
+
+    CompiledConfigPolicy(cpolicy).apply(compiled);
+    Plugin::Config(applied).apply_defaults(cpolicy);
+    EXPECT_EQ(Plugin::Config(applied).fingerprint(), Plugin::Config(compiled).fingerprint());
+}
+
+TEST(CompiledConfigPolicyTest, ReportsEveryViolation) {
+    CompiledConfigPolicy policy(db_policy());
+    rpc::ConfigMap map;
+    (*map.mutable_intmap())["port"] = 80;
+
+    try {
+        policy.apply(map);
+        FAIL() << "apply accepted an invalid config";
+    } catch (PluginException& e) {
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("config value user is required"));
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("config value port = 80 is out of range [1024, 32767]"));
+    }
+    EXPECT_EQ(0, map.stringmap_size());
+    EXPECT_EQ(0, map.boolmap_size());
+}
+
+TEST(CompiledConfigPolicyTest, FillsDefaultsOfInvalidConfigs) {
+    CompiledConfigPolicy policy(db_policy());
+    rpc::ConfigMap map;
+    (*map.mutable_intmap())["port"] = 80;
+
+    const std::string violations = policy.fill_defaults(map);
+    EXPECT_THAT(violations, ::testing::HasSubstr("config value user is required"));
+    EXPECT_THAT(violations, ::testing::HasSubstr("out of range"));
+    EXPECT_EQ("localhost", map.stringmap().at("host"));
+    EXPECT_FALSE(map.boolmap().at("tls"));
+    EXPECT_EQ(80, map.intmap().at("port"));
+
+    rpc::ConfigMap valid;
+    (*valid.mutable_stringmap())["user"] = "admin";
+    EXPECT_EQ("", policy.fill_defaults(valid));
+    EXPECT_EQ("localhost", valid.stringmap().at("host"));
+}
+
+TEST(CompiledConfigPolicyTest, CachesOutcomes) {
+    CompiledConfigPolicy policy(db_policy());
+    for (int i = 0; i < 3; i++) {
+        rpc::ConfigMap map;
+        (*map.mutable_stringmap())["user"] = "admin";
+        policy.apply(map);
+        EXPECT_EQ("localhost", map.stringmap().at("host"));
+        EXPECT_EQ(5432, map.intmap().at("port"));
+
+        rpc::ConfigMap bad;
+        EXPECT_THROW(policy.apply(bad), PluginException);
+    }
+
+    CompiledConfigPolicy uncached(db_policy(), 0);
+    rpc::ConfigMap bad;
+    EXPECT_THROW(uncached.apply(bad), PluginException);
+}
+
+TEST(CompiledConfigPolicyTest, AppliesSectionsOfNamespace) {
+    ConfigPolicy cpolicy;
+    cpolicy.add_rule({""}, Plugin::IntRule{"interval", {10, false}});
+    cpolicy.add_rule({"intel"}, Plugin::IntRule{"interval", {5, false}});
+    cpolicy.add_rule({"intel", "disk"}, Plugin::StringRule{"device", true});
+    CompiledConfigPolicy policy(cpolicy);
+
+    google::protobuf::RepeatedPtrField<rpc::NamespaceElement> cpu, disk, other;
+    *cpu.Add() = element("intel");
+    *cpu.Add() = element("cpu");
+    *disk.Add() = element("intel");
+    *disk.Add() = element("disk");
+    *other.Add() = element("acme");
+
+    rpc::ConfigMap map;
+    policy.apply(map, NamespaceView(cpu));
+    EXPECT_EQ(5, map.intmap().at("interval"));
+
+    map.Clear();
+    policy.apply(map, NamespaceView(other));
+    EXPECT_EQ(10, map.intmap().at("interval"));
+
+    map.Clear();
+    EXPECT_THROW(policy.apply(map, NamespaceView(disk)), PluginException);
+    (*map.mutable_stringmap())["device"] = "sda";
+    policy.apply(map, NamespaceView(disk));
+    EXPECT_EQ(5, map.intmap().at("interval"));
+}
+
+TEST(CompiledConfigPolicyTest, PublisherProxyValidatesConfig) {
+    MockPublisher mockee;
+    EXPECT_CALL(mockee, get_config_policy())
+            .WillOnce(Return(db_policy()));
+    EXPECT_CALL(mockee, publish_metrics(_, _))
+            .WillOnce(Invoke([](vector<Metric>&, const Plugin::Config& config) {
+                EXPECT_EQ("localhost", config.get_string("host"));
+            }));
+    Plugin::Meta meta(Plugin::Publisher, "test", 1);
+    meta.validate_config = true;
+    PublisherImpl publisher(&mockee, &meta);
+
+    rpc::PubProcArg args;
+    rpc::ErrReply reply;
+    grpc::Status status = publisher.Publish(nullptr, &args, &reply);
+    EXPECT_EQ(grpc::StatusCode::UNKNOWN, status.error_code());
+    EXPECT_THAT(reply.error(), ::testing::HasSubstr("user is required"));
+
+    (*args.mutable_config()->mutable_stringmap())["user"] = "admin";
+    status = publisher.Publish(nullptr, &args, &reply);
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+}
+
+TEST(CompiledConfigPolicyTest, CollectorProxyFillsMetricConfigs) {
+    MockCollector mockee;
+    ConfigPolicy cpolicy;
+    cpolicy.add_rule({"intel"}, Plugin::IntRule{"interval", {5, false}});
+    EXPECT_CALL(mockee, get_config_policy())
+            .WillOnce(Return(cpolicy));
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke([](vector<Metric>& metrics) {
+                EXPECT_EQ(5, metrics[0].get_config().get_int("interval"));
+                return metrics;
+            }));
+    Plugin::Meta meta(Plugin::Collector, "test", 1);
+    meta.validate_config = true;
+    CollectorImpl collector(&mockee, &meta);
+
+    rpc::MetricsArg args;
+    *args.add_metrics()->add_namespace_() = element("intel");
+    rpc::MetricsReply reply;
+    grpc::Status status = collector.CollectMetrics(nullptr, &args, &reply);
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    EXPECT_EQ(1, reply.metrics_size());
+}
+
+TEST(CompiledConfigPolicyTest, CollectorProxyLeavesConfiglessMetricsAlone) {
+    MockCollector mockee;
+    ConfigPolicy cpolicy;
+    cpolicy.add_rule({"intel"}, Plugin::IntRule{"interval", true});
+    cpolicy.add_rule({"other"}, Plugin::IntRule{"port", {80, false}});
+    EXPECT_CALL(mockee, get_config_policy())
+            .WillRepeatedly(Return(cpolicy));
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke([](vector<Metric>& metrics) { return metrics; }));
+
+    rpc::MetricsArg args;
+    *args.add_metrics()->add_namespace_() = element("cpu");
+    rpc::MetricsReply reply;
+    {
+        // validation is off by default.
+        CollectorImpl collector(&mockee);
+        EXPECT_TRUE(collector.CollectMetrics(nullptr, &args, &reply).ok());
+        ASSERT_EQ(1, reply.metrics_size());
+        EXPECT_FALSE(reply.metrics(0).has_config());
+    }
+
+    // no rule of the namespace has a default to fill in.
+    Plugin::Meta meta(Plugin::Collector, "test", 1);
+    meta.validate_config = true;
+    CollectorImpl collector(&mockee, &meta);
+    reply.Clear();
+    EXPECT_TRUE(collector.CollectMetrics(nullptr, &args, &reply).ok());
+    ASSERT_EQ(1, reply.metrics_size());
+    EXPECT_FALSE(reply.metrics(0).has_config());
+
+    // the required key is still checked.
+    *args.mutable_metrics(0)->mutable_namespace_(0) = element("intel");
+    reply.Clear();
+    EXPECT_EQ(grpc::StatusCode::UNKNOWN,
+              collector.CollectMetrics(nullptr, &args, &reply).error_code());
+    EXPECT_THAT(reply.error(), ::testing::HasSubstr("interval is required"));
+}
@@ -0,0 +1,135 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/config_state_cache.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Plugin::Config;
+using Plugin::ConfigStateCache;
+using std::string;
+
+namespace {
+    struct Connection {
+        string path;
+    };
+}  // namespace
+
+TEST(ConfigStateCacheTest, BuildsStateOncePerConfig) {
+    ConfigStateCache<Connection> cache(4);
+    int built = 0;
+    auto connect = [&](const Config& config) {
+        built++;
+        return Connection{config.get_string("path")};
+    };
+
+    rpc::ConfigMap map1, map2;
+    Config config1(map1), config2(map2);
+    config1.set_string("path", "/a");
+    config2.set_string("path", "/a");
+
+    std::shared_ptr<Connection> conn = cache.get(config1, connect);
+    EXPECT_EQ("/a", conn->path);
+    EXPECT_EQ(conn, cache.get(config2, connect));
+    EXPECT_EQ(1, built);
+
+    config2.set_string("path", "/b");
+    EXPECT_EQ("/b", cache.get(config2, connect)->path);
+    EXPECT_EQ(2, built);
+    EXPECT_EQ(2, cache.size());
+
+    cache.erase(config1);
+    EXPECT_EQ(1, cache.size());
+    EXPECT_NE(conn, cache.get(config1, connect));
+    EXPECT_EQ(3, built);
+    EXPECT_EQ("/a", conn->path);
+}
+
+TEST(ConfigStateCacheTest, KeepsSaltsApart) {
+    ConfigStateCache<Connection> cache(4);
+    auto connect = [](const Config& config) {
+        return Connection{config.get_string("path")};
+    };
+
+    rpc::ConfigMap map;
+    Config config(map);
+    config.set_string("path", "/a");
+    std::shared_ptr<Connection> conn1 = cache.get(config, 1, connect);
+    std::shared_ptr<Connection> conn2 = cache.get(config, 2, connect);
+    EXPECT_NE(conn1, conn2);
+    EXPECT_EQ(conn1, cache.get(config, 1, connect));
+
+    cache.erase(config, 1);
+    EXPECT_EQ(1, cache.size());
+    EXPECT_EQ(conn2, cache.get(config, 2, connect));
+}
+
+TEST(ConfigStateCacheTest, EvictsLeastRecentlyUsed) {
+    ConfigStateCache<int> cache(2);
+    rpc::ConfigMap maps[3];
+    std::vector<Config> configs;
+    for (int i = 0; i < 3; i++) {
+        configs.emplace_back(maps[i]);
+        configs.back().set_int("id", i);
+    }
+    auto make = [](const Config& config) {
+        return std::unique_ptr<int>(new int(config.get_int("id")));
+    };
+
+    cache.get(configs[0], make);
+    cache.get(configs[1], make);
+    cache.get(configs[0], make);
+    cache.get(configs[2], make);
+    EXPECT_EQ(2, cache.size());
+
+    int built = 0;
+    auto counting = [&](const Config& config) {
+        built++;
+        return config.get_int("id");
+    };
+    EXPECT_EQ(0, *cache.get(configs[0], counting));
+    EXPECT_EQ(2, *cache.get(configs[2], counting));
+    EXPECT_EQ(0, built);
+    EXPECT_EQ(1, *cache.get(configs[1], counting));
+    EXPECT_EQ(1, built);
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+}
+
+TEST(ConfigStateCacheTest, SharedBetweenThreads) {
+    ConfigStateCache<int> cache(8);
+    std::vector<std::thread> threads;
+    std::vector<std::shared_ptr<int>> states(8);
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&cache, &states, t] {
+            rpc::ConfigMap map;
+            Config config(map);
+            config.set_int("id", 7);
+            for (int i = 0; i < 1000; i++) {
+                states[t] = cache.get(config, [](const Config& c) { return c.get_int("id"); });
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(1, cache.size());
+    for (const auto& state : states) {
+        EXPECT_EQ(states[0], state);
+    }
+}
@@ -12,6 +12,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "snap/config.h"
+#include "snap/plugin.h"
 #include "gtest/gtest.h"
 
 #include <sstream>
@@ -163,3 +164,92 @@ TEST(PluginConfigTest, ApplyDefaultsWorks) {
     EXPECT_EQ(config.get_int("number"), 10);
     EXPECT_EQ(config.get_bool("question"), true);
 }
+
+TEST(ConfigKeyTest, ReadsValuesAndPolicyDefaults) {
+    Plugin::ConfigPolicy cpolicy;
+    cpolicy.add_rule({"intel"}, Plugin::StringRule{"login", {"admin", true}});
+    cpolicy.add_rule({"intel"}, Plugin::IntRule{"number", {10, true}});
+    cpolicy.add_rule({"intel"}, Plugin::BoolRule{"question", false});
+    const Plugin::ConfigKey<std::string> login(cpolicy, "login", {"intel"});
+    const Plugin::ConfigKey<int> number(cpolicy, "number", {"intel"});
+    const Plugin::ConfigKey<bool> question(cpolicy, "question", {"intel"});
+    EXPECT_TRUE(login.has_default());
+    EXPECT_FALSE(question.has_default());
+
+    rpc::ConfigMap baseMap;
+    Plugin::Config config(baseMap);
+    EXPECT_EQ("admin", config.get(login));
+    EXPECT_EQ(10, config.get(number));
+    EXPECT_THROW(config.get(question), Plugin::PluginException);
+
+    config.set_string("login", "root");
+    config.set_int("number", -4);
+    config.set_bool("question", true);
+    EXPECT_EQ("root", config.get(login));
+    EXPECT_EQ(&baseMap.stringmap().at("login"), &config.get(login));
+    EXPECT_EQ(-4, config.get(number));
+    EXPECT_TRUE(config.get(question));
+}
+
+TEST(ConfigKeyTest, RequiresMatchingRule) {
+    Plugin::ConfigPolicy cpolicy(Plugin::StringRule{"path", true});
+    EXPECT_NO_THROW(Plugin::ConfigKey<std::string>(cpolicy, "path"));
+    EXPECT_THROW(Plugin::ConfigKey<int>(cpolicy, "path"), Plugin::PluginException);
+    EXPECT_THROW(Plugin::ConfigKey<std::string>(cpolicy, "path", {"intel"}),
+                 Plugin::PluginException);
+
+    rpc::ConfigMap baseMap;
+    Plugin::Config config(baseMap);
+    config.set_string("path", "/tmp");
+    EXPECT_EQ("/tmp", config.get(Plugin::ConfigKey<std::string>("path")));
+}
+
+TEST(ConfigPolicyTest, AddRuleKeepsRulesOfSameNamespace) {
+    ConfigPolicy policy;
+    policy.add_rule({"intel"}, Plugin::IntRule{"port", {80, false}});
+    policy.add_rule({"intel"}, Plugin::IntRule{"timeout", {5, false}});
+    EXPECT_EQ(2, policy.integer_policy().at("intel").rules_size());
+}
+
+TEST(PluginConfigTest, SameEntriesComparesContent) {
+    rpc::ConfigMap map1, map2;
+    Plugin::Config config1(map1), config2(map2);
+    EXPECT_TRUE(config1.same_entries(map2));
+
+    config1.set_int("port", 80);
+    config1.set_string("path", "/tmp");
+    config2.set_string("path", "/tmp");
+    EXPECT_FALSE(config1.same_entries(map2));
+    config2.set_int("port", 80);
+    EXPECT_TRUE(config1.same_entries(map2));
+    EXPECT_TRUE(config2.same_entries(map1));
+
+    config2.set_bool("port", true);
+    EXPECT_FALSE(config1.same_entries(map2));
+}
+
+TEST(PluginConfigTest, FingerprintDependsOnContentOnly) {
+    rpc::ConfigMap map1, map2;
+    Plugin::Config config1(map1), config2(map2);
+    EXPECT_EQ(config1.fingerprint(), config2.fingerprint());
+
+    for (int i = 0; i < 20; i++) {
+        config1.set_int("key" + std::to_string(i), i);
+        config2.set_int("key" + std::to_string(19 - i), 19 - i);
+    }
+    config1.set_string("path", "/tmp");
+    config2.set_string("path", "/tmp");
+    EXPECT_EQ(config1.fingerprint(), config2.fingerprint());
+
+    config2.set_string("path", "/tmp/");
+    EXPECT_NE(config1.fingerprint(), config2.fingerprint());
+    config2.set_string("path", "/tmp");
+    config2.set_bool("path", true);
+    EXPECT_NE(config1.fingerprint(), config2.fingerprint());
+
+    rpc::ConfigMap map3, map4;
+    Plugin::Config config3(map3), config4(map4);
+    config3.set_string("ab", "c");
+    config4.set_string("a", "bc");
+    EXPECT_NE(config3.fingerprint(), config4.fingerprint());
+}
@@ -0,0 +1,177 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/metric_frame.h"
+#include "snap/metric_prototype.h"
+#include "snap/plugin.h"
+#include "snap/proxy/collector_proxy.h"
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::MetricFrame;
+using Plugin::MetricFrames;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+using std::chrono::system_clock;
+using std::vector;
+
+static MetricPrototype cpu_prototype() {
+    return MetricPrototype(Namespace({"intel", "cpu"}).add_dynamic_element("cpu", "cpu id")
+                                                      .add_static_element("util"),
+                           "%", "cpu utilization");
+}
+
+TEST(MetricFrameTest, EncodesDynamicElements) {
+    MetricFrame<double> frame(cpu_prototype());
+    uint32_t cpu0 = frame.encode(0, "cpu0");
+    uint32_t cpu1 = frame.encode(0, "cpu1");
+    EXPECT_NE(cpu0, cpu1);
+    EXPECT_EQ(cpu0, frame.encode(0, "cpu0"));
+    EXPECT_EQ("cpu1", frame.decode(0, cpu1));
+
+    frame.add({cpu1}, 0.5);
+    frame.add({cpu0}, 0.25);
+    ASSERT_EQ(2, frame.size());
+    EXPECT_EQ(cpu0, frame.code(1, 0));
+    EXPECT_EQ(vector<double>({0.5, 0.25}), frame.values());
+}
+
+TEST(MetricFrameTest, RejectsBadRows) {
+    MetricFrame<double> frame(cpu_prototype());
+    uint32_t cpu0 = frame.encode(0, "cpu0");
+    EXPECT_THROW(frame.add({}, 1.0), Plugin::PluginException);
+    EXPECT_THROW(frame.add({cpu0, cpu0}, 1.0), Plugin::PluginException);
+    EXPECT_THROW(frame.add({cpu0 + 1}, 1.0), Plugin::PluginException);
+    EXPECT_EQ(0, frame.size());
+    EXPECT_EQ(0, frame.values().size());
+}
+
+TEST(MetricFrameTest, AppendsRowsAsMetrics) {
+    MetricFrame<uint64_t> frame(cpu_prototype());
+    system_clock::time_point ts = system_clock::from_time_t(1000000000);
+    frame.add({frame.encode(0, "cpu0")}, 7, ts);
+    frame.add({frame.encode(0, "cpu1")}, 9);
+    uint64_t* values = frame.values_data();
+    for (size_t i = 0; i < frame.size(); i++) {
+        values[i] *= 10;
+    }
+    EXPECT_THROW(frame.value(2), std::out_of_range);
+
+    google::protobuf::RepeatedPtrField<rpc::Metric> field;
+    frame.append_to(&field);
+    ASSERT_EQ(2, field.size());
+    EXPECT_EQ("cpu1", field.Get(1).namespace_(2).value());
+    EXPECT_EQ("cpu", field.Get(1).namespace_(2).name());
+    EXPECT_EQ("util", field.Get(1).namespace_(3).value());
+    EXPECT_EQ("%", field.Get(1).unit());
+    EXPECT_EQ(90, field.Get(1).uint64_data());
+    EXPECT_EQ(1000000000, field.Get(0).timestamp().sec());
+    EXPECT_FALSE(field.Get(1).has_timestamp());
+
+    frame.set_timestamps(ts);
+    vector<Metric> metrics;
+    frame.expand(metrics);
+    ASSERT_EQ(2, metrics.size());
+    EXPECT_EQ("intel/cpu/cpu0/util", metrics[0].ns_string());
+    EXPECT_EQ(70, metrics[0].get<uint64_t>());
+    EXPECT_EQ(ts, metrics[1].timestamp());
+}
+
+TEST(MetricFrameTest, ClearKeepsDictionaries) {
+    MetricFrame<int64_t> frame(cpu_prototype());
+    uint32_t cpu0 = frame.encode(0, "cpu0");
+    frame.add({cpu0}, 1);
+    frame.clear();
+    EXPECT_EQ(0, frame.size());
+    EXPECT_TRUE(frame.values().empty());
+    frame.add({cpu0}, 2);
+    EXPECT_EQ("cpu0", frame.decode(0, frame.code(0, 0)));
+}
+
+TEST(MetricFrameTest, SetsTimestampsPerRow) {
+    MetricFrame<int64_t> frame(cpu_prototype());
+    uint32_t cpu0 = frame.encode(0, "cpu0");
+    frame.add({cpu0}, 1);
+    frame.add({cpu0}, 2);
+    const MetricFrame<int64_t>::time_point ts(std::chrono::seconds(1000000000));
+    frame.set_timestamp(1, ts);
+    EXPECT_EQ(MetricFrame<int64_t>::time_point(), frame.timestamps()[0]);
+    EXPECT_EQ(ts, frame.timestamps()[1]);
+    EXPECT_THROW(frame.set_timestamp(2, ts), std::out_of_range);
+}
+
+TEST(MetricFrameTest, StoresBoolsAsBytes) {
+    MetricFrame<bool> frame(cpu_prototype());
+    uint32_t cpu0 = frame.encode(0, "cpu0");
+    frame.add({cpu0}, true);
+    frame.add({cpu0}, false);
+    frame.value(0) = !frame.value(0);
+    frame.value(1) = !frame.value(1);
+
+    vector<Metric> metrics;
+    frame.expand(metrics);
+    ASSERT_EQ(2, metrics.size());
+    EXPECT_FALSE(metrics[0].get<bool>());
+    EXPECT_TRUE(metrics[1].get<bool>());
+}
+
+/**
+* FrameCollector returns one metric from collect_metrics and a frame of
+* per-cpu values from collect_frames.
+*/
+class FrameCollector final : public Plugin::CollectorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::vector<Metric> result;
+        result.emplace_back(Namespace({"intel", "load"}), "", "");
+        result.back().set_data(1.0);
+        return result;
+    }
+
+    MetricFrames collect_frames(const std::vector<Metric> &metrics) {
+        std::unique_ptr<MetricFrame<double>> frame(new MetricFrame<double>(cpu_prototype()));
+        for (int i = 0; i < 4; i++) {
+            frame->add({frame->encode(0, "cpu" + std::to_string(i))}, i / 4.0);
+        }
+        MetricFrames frames;
+        frames.push_back(std::move(frame));
+        return frames;
+    }
+};
+
+TEST(MetricFrameTest, CollectorProxyExpandsFrames) {
+    FrameCollector plugin;
+    CollectorImpl collector(&plugin);
+    rpc::MetricsArg args;
+    rpc::MetricsReply resp;
+    grpc::Status status = collector.CollectMetrics(nullptr, &args, &resp);
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    ASSERT_EQ(5, resp.metrics_size());
+    EXPECT_EQ("load", resp.metrics(0).namespace_(1).value());
+    EXPECT_EQ("cpu3", resp.metrics(4).namespace_(2).value());
+    EXPECT_EQ(0.75, resp.metrics(4).float64_data());
+}
@@ -0,0 +1,136 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/metric_pool.h"
+#include "snap/metric_prototype.h"
+#include "snap/proxy/collector_proxy.h"
+#include "gmock/gmock.h"
+
+#include <string>
+#include <vector>
+
+#include "mocks.h"
+
+using Plugin::Metric;
+using Plugin::MetricPool;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::Proxy::CollectorImpl;
+using ::testing::_;
+using ::testing::Invoke;
+using std::vector;
+
+TEST(MetricPoolTest, RecyclesStorage) {
+    MetricPool pool;
+    MetricPrototype prototype(Namespace({"intel", "cpp", "load"}), "%");
+    const rpc::Metric* rpc_metric;
+    {
+        Metric met = pool.acquire(prototype);
+        EXPECT_TRUE(met.is_pooled());
+        met.set_data((int64_t)42);
+        met.set_timestamp();
+        met.add_tag({"host", "host0"});
+        rpc_metric = met.get_rpc_metric_ptr();
+        EXPECT_EQ(0, pool.idle());
+    }
+    EXPECT_EQ(1, pool.idle());
+
+    Metric met = pool.acquire(prototype);
+    EXPECT_EQ(rpc_metric, met.get_rpc_metric_ptr());
+    EXPECT_EQ(0, pool.idle());
+    EXPECT_EQ(Metric::NotSet, met.data_type());
+    EXPECT_FALSE(met.get_rpc_metric_ptr()->has_timestamp());
+    EXPECT_EQ("intel/cpp/load", met.ns_string());
+    EXPECT_EQ("%", met.get_rpc_metric_ptr()->unit());
+    EXPECT_TRUE(met.tags().empty());
+}
+
+TEST(MetricPoolTest, RecycledMetricsStartFresh) {
+    MetricPool pool;
+    MetricPrototype host(Namespace({"intel"}).add_dynamic_element("host").add_static_element("up"));
+    {
+        Metric met = pool.acquire(host, {"host0"});
+        met.add_tag({"rack", "r1"});
+        rpc::ConfigMap map;
+        (*map.mutable_stringmap())["user"] = "root";
+        met.set_diagnostic_config(Plugin::Config(map));
+    }
+    {
+        Metric met = pool.acquire(host);
+        EXPECT_EQ("intel/*/up", met.ns_string());
+        EXPECT_TRUE(met.tags().empty());
+        Namespace other({"intel", "other"});
+        met.set_ns(other);
+    }
+    Metric met = pool.acquire(host, {"host1"});
+    EXPECT_EQ("intel/host1/up", met.ns_string());
+    EXPECT_TRUE(met.tags().empty());
+    EXPECT_EQ(0, met.get_rpc_metric_ptr()->config().ByteSizeLong());
+}
+
+TEST(MetricPoolTest, KeepsShapesApart) {
+    MetricPool pool;
+    MetricPrototype load(Namespace({"intel", "load"}));
+    MetricPrototype host(Namespace({"intel"}).add_dynamic_element("host").add_static_element("up"));
+    {
+        vector<Metric> metrics;
+        metrics.push_back(pool.acquire(load));
+        metrics.push_back(pool.acquire(host, {"host0"}));
+        metrics.push_back(pool.acquire(host, {"host1"}));
+    }
+    EXPECT_EQ(3, pool.idle());
+
+    EXPECT_EQ("intel/host2/up", pool.acquire(host, {"host2"}).ns_string());
+    EXPECT_EQ("intel/load", pool.acquire(load).ns_string());
+    EXPECT_THROW(pool.acquire(host, {}), Plugin::PluginException);
+}
+
+TEST(MetricPoolTest, CopiesAndReleasesAreNotPooled) {
+    MetricPool pool;
+    MetricPrototype prototype(Namespace({"intel", "load"}));
+    Metric met = pool.acquire(prototype);
+    Metric copy(met);
+    EXPECT_FALSE(copy.is_pooled());
+
+    delete met.release_rpc();
+    EXPECT_FALSE(met.is_pooled());
+    EXPECT_EQ(0, pool.idle());
+}
+
+TEST(MetricPoolTest, CollectorProxyReturnsMetricsToPool) {
+    MockCollector mockee;
+    MetricPool pool;
+    MetricPrototype prototype(Namespace({"intel", "load"}));
+    auto reporter = [&] (vector<Metric> &metrics) {
+        vector<Metric> result;
+        for (int i = 0; i < 10; i++) {
+            result.push_back(pool.acquire(prototype));
+            result.back().set_data((int64_t)i);
+        }
+        return result;
+    };
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+
+    CollectorImpl collector(&mockee);
+    for (int cycle = 0; cycle < 2; cycle++) {
+        rpc::MetricsArg args;
+        rpc::MetricsReply resp;
+        grpc::Status status = collector.CollectMetrics(nullptr, &args, &resp);
+        EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+        ASSERT_EQ(10, resp.metrics_size());
+        EXPECT_EQ(9, resp.metrics(9).int64_data());
+        EXPECT_EQ(10, pool.idle());
+    }
+}
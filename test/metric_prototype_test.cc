@@ -0,0 +1,56 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/metric_prototype.h"
+#include "snap/plugin.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using Plugin::Metric;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+
+TEST(MetricPrototypeTest, MakeCopiesSharedParts) {
+    MetricPrototype prototype(Namespace({"intel", "cpp", "load"}), "%", "system load");
+    Metric first = prototype.make();
+    Metric second = prototype.make();
+    first.set_data((int64_t)1);
+
+    EXPECT_EQ("intel/cpp/load", first.ns_string());
+    EXPECT_EQ("%", first.get_rpc_metric_ptr()->unit());
+    EXPECT_EQ("system load", second.get_rpc_metric_ptr()->description());
+    EXPECT_NE(first.get_rpc_metric_ptr(), second.get_rpc_metric_ptr());
+    EXPECT_EQ(Metric::NotSet, second.data_type());
+    EXPECT_EQ("%", prototype.unit());
+    EXPECT_EQ("system load", prototype.description());
+}
+
+TEST(MetricPrototypeTest, MakeSetsDynamicValues) {
+    MetricPrototype prototype(Namespace({"intel", "cpp"}).add_dynamic_element("host", "host name")
+                                                          .add_static_element("load"));
+    Metric met = prototype.make({"host0"});
+
+    EXPECT_EQ("intel/cpp/host0/load", met.ns_string());
+    EXPECT_EQ("host", met.ns()[2].get_name());
+    EXPECT_EQ("host name", met.ns()[2].get_description());
+    EXPECT_EQ("intel/cpp/*/load", prototype.ns().get_string());
+}
+
+TEST(MetricPrototypeTest, MakeRejectsWrongDynamicValues) {
+    MetricPrototype prototype(Namespace({"intel"}).add_dynamic_element("host"));
+    EXPECT_THROW(prototype.make({"host0", "host1"}), Plugin::PluginException);
+    EXPECT_THROW(prototype.make({}), Plugin::PluginException);
+}
@@ -13,13 +13,20 @@ limitations under the License.
 */
 #include "snap/config.h"
 #include "snap/metric.h"
+#include "snap/plugin.h"
 #include "gtest/gtest.h"
 
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <ctime>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 
@@ -108,6 +115,195 @@ TEST(MetricTest, SetFromRpcMetricWorks) {
     EXPECT_EQ("bonk", fake_metric.get_rpc_metric_ptr()->tags().at("node"));
 }
 
+TEST(MetricTest, CopyOfArenaMetricUsesArena) {
+    google::protobuf::Arena arena;
+    rpc::Metric* source_metric = google::protobuf::Arena::CreateMessage<rpc::Metric>(&arena);
+    source_metric->add_namespace_()->set_value("foo");
+    Metric wrapped_metric(source_metric);
+
+    Metric copied_metric(wrapped_metric);
+    EXPECT_EQ(&arena, copied_metric.get_rpc_metric_ptr()->GetArena());
+    EXPECT_EQ("/foo", extract_ns(copied_metric));
+}
+
+TEST(MetricTest, MoveKeepsRpcMetric) {
+    Metric source_metric(Namespace({"foo","bar"}),"atoms","critical metric");
+    source_metric.set_data((int64_t)42);
+    const rpc::Metric* rpc_metric = source_metric.get_rpc_metric_ptr();
+
+    Metric moved_metric(std::move(source_metric));
+    EXPECT_EQ(rpc_metric, moved_metric.get_rpc_metric_ptr());
+    EXPECT_EQ("/foo/bar", extract_ns(moved_metric));
+
+    Metric assigned_metric;
+    assigned_metric = std::move(moved_metric);
+    EXPECT_EQ(rpc_metric, assigned_metric.get_rpc_metric_ptr());
+    EXPECT_EQ(42, assigned_metric.get_int64_data());
+}
+
+TEST(MetricTest, CopyAssignmentCopiesRpcMetric) {
+    Metric source_metric(Namespace({"foo","bar"}),"atoms","critical metric");
+    Metric copied_metric;
+    copied_metric = source_metric;
+    source_metric.set_data((int64_t)42);
+
+    EXPECT_NE(source_metric.get_rpc_metric_ptr(), copied_metric.get_rpc_metric_ptr());
+    EXPECT_EQ("/foo/bar", extract_ns(copied_metric));
+    EXPECT_EQ(Metric::NotSet, copied_metric.data_type());
+}
+
+TEST(MetricTest, VectorGrowthDoesNotCopyRpcMetrics) {
+    std::vector<Metric> metrics;
+    std::vector<const rpc::Metric*> rpc_metrics;
+    for (int i = 0; i < 100; i++) {
+        metrics.emplace_back(Namespace({"foo", std::to_string(i)}), "", "");
+        rpc_metrics.push_back(metrics.back().get_rpc_metric_ptr());
+    }
+
+    int copies = 0;
+    for (int i = 0; i < 100; i++) {
+        if (metrics[i].get_rpc_metric_ptr() != rpc_metrics[i]) copies++;
+    }
+    EXPECT_EQ(0, copies);
+}
+
+TEST(MetricTest, ReleaseRpcHandsOverOwnedMetric) {
+    Metric fake_metric(Namespace({"foo","bar"}),"atoms","critical metric");
+    fake_metric.set_data((int64_t)42);
+    const rpc::Metric* rpc_metric = fake_metric.get_rpc_metric_ptr();
+
+    std::unique_ptr<rpc::Metric> released(fake_metric.release_rpc());
+    EXPECT_EQ(rpc_metric, released.get());
+    EXPECT_EQ(nullptr, fake_metric.get_rpc_metric_ptr());
+    EXPECT_EQ(42, released->int64_data());
+}
+
+TEST(MetricTest, ReleaseRpcOfWrappedMetricTakesContents) {
+    rpc::Metric rpc_metric;
+    rpc_metric.set_unit("atoms");
+    Metric fake_metric(&rpc_metric);
+
+    std::unique_ptr<rpc::Metric> released(fake_metric.release_rpc());
+    EXPECT_NE(&rpc_metric, released.get());
+    EXPECT_EQ("atoms", released->unit());
+    EXPECT_EQ("", rpc_metric.unit());
+}
+
+TEST(MetricTest, NsViewWorks) {
+    Metric fake_metric(Namespace({"foo","bar"}).add_dynamic_element("baz", "dynamic"),
+                       "", "");
+    Plugin::NamespaceView ns = fake_metric.ns_view();
+
+    EXPECT_EQ(3, ns.size());
+    EXPECT_EQ("bar", ns[1].value());
+    EXPECT_FALSE(ns[1].is_dynamic());
+    EXPECT_EQ("baz", ns[2].name());
+    EXPECT_EQ("dynamic", ns[2].description());
+    EXPECT_TRUE(ns.is_dynamic());
+    EXPECT_EQ("foo/bar/*", ns.get_string());
+    EXPECT_EQ(fake_metric.ns().get_string(), ns.to_namespace().get_string());
+
+    std::vector<std::string> values;
+    for (Plugin::NamespaceElementView elem : ns) {
+        values.push_back(elem.value().to_string());
+    }
+    EXPECT_EQ(std::vector<std::string>({"foo", "bar", "*"}), values);
+    EXPECT_EQ(3, ns.end() - ns.begin());
+}
+
+TEST(MetricTest, NsViewMatchesWorks) {
+    Metric pattern(Namespace({"intel"}).add_dynamic_element("cpu").add_static_element("user"),
+                   "", "");
+    Metric star(Namespace({"intel", "*", "user"}), "", "");
+    Metric cpu0(Namespace({"intel", "0", "user"}), "", "");
+    Metric idle(Namespace({"intel", "0", "idle"}), "", "");
+    Metric longer(Namespace({"intel", "0", "user", "ticks"}), "", "");
+
+    EXPECT_TRUE(pattern.ns_view().matches(cpu0.ns_view()));
+    EXPECT_TRUE(star.ns_view().matches(cpu0.ns_view()));
+    EXPECT_TRUE(cpu0.ns_view().matches(cpu0.ns_view()));
+    EXPECT_FALSE(cpu0.ns_view().matches(pattern.ns_view()));
+    EXPECT_FALSE(pattern.ns_view().matches(idle.ns_view()));
+    EXPECT_FALSE(pattern.ns_view().matches(longer.ns_view()));
+}
+
+TEST(MetricTest, NsViewDoesNotCopy) {
+    Metric fake_metric(Namespace({"foo","bar"}), "", "");
+    const rpc::Metric* rpc_metric = fake_metric.get_rpc_metric_ptr();
+
+    EXPECT_EQ(rpc_metric->namespace_(1).value().data(),
+              fake_metric.ns_view()[1].value().data());
+}
+
+TEST(MetricTest, NamespaceStringIsCached) {
+    Namespace ns({"foo","bar"});
+    const std::string& joined = ns.get_string();
+
+    EXPECT_EQ("foo/bar", joined);
+    EXPECT_EQ(&joined, &ns.get_string());
+    EXPECT_EQ(0x571d17d6ef2def0dULL, ns.hash());
+
+    ns.add_static_element("baz");
+    EXPECT_EQ("foo/bar/baz", ns.get_string());
+    EXPECT_NE(0x571d17d6ef2def0dULL, ns.hash());
+
+    ns[2].set_value("qux");
+    EXPECT_EQ("foo/bar/qux", ns.get_string());
+}
+
+TEST(MetricTest, NamespaceStringIsSharedAcrossThreads) {
+    const Namespace ns({"foo","bar","baz"});
+    std::vector<const std::string*> joined(8);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < joined.size(); i++) {
+        readers.emplace_back([&ns, &joined, i]() { joined[i] = &ns.get_string(); });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (const std::string* str : joined) {
+        EXPECT_EQ(&ns.get_string(), str);
+    }
+    EXPECT_EQ("foo/bar/baz", ns.get_string());
+
+    Namespace copy(ns);
+    EXPECT_EQ(ns.hash(), copy.hash());
+    copy.add_static_element("qux");
+    EXPECT_EQ("foo/bar/baz/qux", copy.get_string());
+    EXPECT_EQ("foo/bar/baz", ns.get_string());
+}
+
+TEST(MetricTest, NamespaceWorksAsUnorderedKey) {
+    std::unordered_map<Namespace, int> last_values;
+    last_values[Namespace({"foo","bar"})] = 1;
+    last_values[Namespace({"foo","baz"})] = 2;
+    last_values[Namespace({"foo","bar"})] = 3;
+
+    EXPECT_EQ(2, last_values.size());
+    EXPECT_EQ(3, last_values.at(Namespace({"foo","bar"})));
+    EXPECT_EQ(Namespace({"foo","baz"}), Namespace({"foo","baz"}));
+    EXPECT_NE(Namespace({"foo","baz"}), Namespace({"foo","bar"}));
+}
+
+TEST(MetricTest, NamespaceEqualityComparesElements) {
+    EXPECT_NE(Namespace({"a/b", "c"}), Namespace({"a", "b/c"}));
+    EXPECT_EQ(Namespace({"a/b", "c"}).hash(), Namespace({"a", "b/c"}).hash());
+    EXPECT_NE(Namespace({"foo"}).add_dynamic_element("host"), Namespace({"foo", "*"}));
+    EXPECT_EQ(Namespace({"foo"}).add_dynamic_element("host"),
+              Namespace({"foo"}).add_dynamic_element("host", "name of the host"));
+}
+
+TEST(MetricTest, SetNsInvalidatesNsHash) {
+    Metric fake_metric(Namespace({"foo","bar"}), "", "");
+    EXPECT_EQ("foo/bar", fake_metric.ns_string());
+    EXPECT_EQ(Namespace({"foo","bar"}).hash(), fake_metric.ns_hash());
+
+    Namespace other({"foo","baz"});
+    fake_metric.set_ns(other);
+    EXPECT_EQ("foo/baz", fake_metric.ns_string());
+    EXPECT_EQ(other.hash(), fake_metric.ns_hash());
+}
+
 TEST(MetricTest, SetTagsWorks) {
     Metric fake_metric;
     fake_metric.add_tag(make_pair("host", "zero"));
@@ -116,6 +312,65 @@ TEST(MetricTest, SetTagsWorks) {
     EXPECT_EQ("1hr", fake_metric.tags().at("period"));
 }
 
+TEST(MetricTest, AddTagInvalidatesMemoizedTags) {
+    Metric fake_metric;
+    EXPECT_TRUE(fake_metric.tags().empty());
+    fake_metric.add_tag(make_pair("host", "zero"));
+    EXPECT_EQ(1, fake_metric.tags().size());
+    fake_metric.add_tag(make_pair("host", "one"));
+    EXPECT_EQ("one", fake_metric.tags().at("host"));
+    fake_metric.add_tags({{"period", "1hr"}, {"dc", "east"}});
+    EXPECT_EQ(3, fake_metric.tags().size());
+    EXPECT_EQ("east", fake_metric.tags().at("dc"));
+
+    // a copy assigned over the metric brings its own tags.
+    Metric other;
+    other.add_tag(make_pair("rack", "r1"));
+    fake_metric = other;
+    EXPECT_EQ(1, fake_metric.tags().size());
+    EXPECT_EQ("r1", fake_metric.tags().at("rack"));
+}
+
+TEST(MetricTest, AddTagsWorks) {
+    Metric fake_metric;
+    std::vector<pair<string, string>> tags{{"host", "zero"}, {"period", "1hr"}};
+    fake_metric.add_tags(tags);
+    std::map<string, string> more{{"dc", "east"}, {"host", "one"}};
+    fake_metric.add_tags(more);
+    EXPECT_EQ(3, fake_metric.get_rpc_metric_ptr()->tags().size());
+    EXPECT_EQ("one", fake_metric.get_rpc_metric_ptr()->tags().at("host"));
+    EXPECT_EQ("1hr", fake_metric.get_rpc_metric_ptr()->tags().at("period"));
+}
+
+TEST(MetricTest, TagViewWorks) {
+    Metric fake_metric;
+    EXPECT_TRUE(fake_metric.tag_view().empty());
+    fake_metric.add_tags({{"period", "1hr"}, {"host", "zero"}, {"dc", "east"}});
+
+    Plugin::TagView view = fake_metric.tag_view();
+    EXPECT_EQ(3, view.size());
+    EXPECT_TRUE(view.contains("host"));
+    EXPECT_FALSE(view.contains("rack"));
+    EXPECT_EQ("zero", view.get("host"));
+    EXPECT_TRUE(view.get("rack").empty());
+    EXPECT_EQ(fake_metric.get_rpc_metric_ptr()->tags().at("host").data(),
+              view.get("host").data());
+
+    int count = 0;
+    for (const auto& tag : view) {
+        EXPECT_EQ(fake_metric.tags().at(tag.first), tag.second);
+        count++;
+    }
+    EXPECT_EQ(3, count);
+
+    std::vector<Plugin::TagView::Tag> sorted = view.sorted();
+    ASSERT_EQ(3, sorted.size());
+    EXPECT_EQ("dc", sorted[0].first);
+    EXPECT_EQ("host", sorted[1].first);
+    EXPECT_EQ("period", sorted[2].first);
+    EXPECT_EQ("1hr", sorted[2].second);
+}
+
 TEST(MetricTest, SetTimestampWorks) {
     Metric fake_metric;
     std::tm source_time{56,10,8,2,5,92,6,122,1}; // 02 May 1992, 08:10:56
@@ -130,6 +385,31 @@ TEST(MetricTest, SetTimestampWorks) {
     EXPECT_EQ(56, metric_time.tm_sec);
 }
 
+TEST(MetricTest, SetTimestampsStampsBatch) {
+    std::vector<Metric> metrics(3);
+    system_clock::time_point tp = system_clock::from_time_t(704794256);
+    Metric::set_timestamps(metrics, tp);
+    for (const Metric& met : metrics) {
+        EXPECT_TRUE(tp == met.timestamp());
+    }
+
+    system_clock::time_point before = system_clock::now();
+    Metric::set_advertised_times(metrics);
+    for (const Metric& met : metrics) {
+        EXPECT_TRUE(metrics[0].timestamp() == met.timestamp());
+        EXPECT_EQ(met.get_rpc_metric_ptr()->timestamp().nsec(),
+                  met.get_rpc_metric_ptr()->lastadvertisedtime().nsec());
+    }
+    EXPECT_FALSE(metrics[0].timestamp() < before);
+}
+
+TEST(MetricTest, CoarseClockIsCloseToRealtime) {
+    system_clock::time_point realtime = Plugin::clock_now(Plugin::RealtimeClock);
+    system_clock::time_point coarse = Plugin::clock_now(Plugin::RealtimeCoarseClock);
+    EXPECT_LT(std::abs(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           coarse - realtime).count()), 100);
+}
+
 TEST(MetricTest, SetLastAdvertisedTimeWorks) {
     Metric fake_metric;
     std::tm source_time{13,55,15,29,9,8,1,272,1}; // Mon, 29 Sep 2008 15:55:13 -0400
@@ -181,6 +461,79 @@ TEST(MetricTest, SetDataWorks) {
     EXPECT_EQ(uint64_var, fake_metric.get_uint64_data());
 }
 
+TEST(MetricTest, TypedGetWorks) {
+    Metric fake_metric;
+    fake_metric.set_data(std::string("hop"));
+    EXPECT_EQ("hop", fake_metric.get<std::string>());
+    EXPECT_EQ(&fake_metric.get_string_data(), &fake_metric.get<std::string>());
+
+    fake_metric.set_data((int64_t)40991);
+    EXPECT_EQ(40991, fake_metric.get<int64_t>());
+    EXPECT_EQ(Metric::Int64, fake_metric.data_type());
+    EXPECT_THROW(fake_metric.get<double>(), Plugin::PluginException);
+
+    uint32_t uint32_var = 0;
+    EXPECT_FALSE(fake_metric.try_get(uint32_var));
+    fake_metric.set_data((uint32_t)40992);
+    EXPECT_TRUE(fake_metric.try_get(uint32_var));
+    EXPECT_EQ(40992, uint32_var);
+
+    EXPECT_THROW(Metric().get<bool>(), Plugin::PluginException);
+}
+
+TEST(MetricTest, DataTypeFollowsWrappedMetric) {
+    rpc::Metric rpc_metric;
+    rpc_metric.set_float32_data(1.5);
+    const Metric wrapped(&rpc_metric);
+    EXPECT_EQ(Metric::Float32, wrapped.data_type());
+    EXPECT_EQ(1.5f, wrapped.get<float>());
+
+    Metric copy(wrapped);
+    EXPECT_EQ(Metric::Float32, copy.data_type());
+    rpc_metric.set_bool_data(true);
+    EXPECT_EQ(Metric::Bool, wrapped.data_type());
+    EXPECT_TRUE(wrapped.get<bool>());
+}
+
+TEST(MetricTest, VisitDataWorks) {
+    auto print = [](const Metric& metric) {
+        std::ostringstream os;
+        metric.visit_data([&os](const auto& value) { os << value; });
+        return os.str();
+    };
+    Metric fake_metric;
+    EXPECT_EQ("not set", print(fake_metric));
+    fake_metric.set_data(std::string("hop"));
+    EXPECT_EQ("hop", print(fake_metric));
+    fake_metric.set_data((uint64_t)40993);
+    EXPECT_EQ("40993", print(fake_metric));
+    fake_metric.set_data(true);
+    EXPECT_EQ("1", print(fake_metric));
+
+    fake_metric.set_data(0.5);
+    auto is_double = fake_metric.visit_data([](const auto& value) {
+        return std::is_same<std::decay_t<decltype(value)>, double>::value;
+    });
+    EXPECT_TRUE(is_double);
+}
+
+TEST(MetricTest, ExtractDataWorks) {
+    std::vector<Metric> metrics(6);
+    metrics[0].set_data((int32_t)-3);
+    metrics[1].set_data((uint64_t)5);
+    metrics[2].set_data(0.25f);
+    metrics[3].set_data(std::string("hop"));
+    metrics[5].set_data(true);
+
+    std::vector<double> values{42};
+    Metric::extract_data(metrics, values, -1.0);
+    EXPECT_EQ(std::vector<double>({42, -3, 5, 0.25, -1, -1, 1}), values);
+
+    std::vector<int64_t> ints;
+    Metric::extract_data(metrics, ints);
+    EXPECT_EQ(std::vector<int64_t>({-3, 5, 0, 0, 0, 1}), ints);
+}
+
 TEST(MetricTest, GetStringWorks) {
     Plugin::Namespace mynamespace({"intel","sdi","check","it"});
 
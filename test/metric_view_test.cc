@@ -0,0 +1,209 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric_view.h"
+#include "snap/plugin.h"
+#include "snap/proxy/publisher_proxy.h"
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mocks.h"
+
+using Plugin::Metric;
+using Plugin::MetricBatchView;
+using Plugin::MetricView;
+using Plugin::Namespace;
+using Plugin::NoData;
+using Plugin::Proxy::PublisherImpl;
+using ::testing::_;
+using ::testing::Invoke;
+using std::string;
+using std::vector;
+
+namespace {
+    Metric sample_metric() {
+        Namespace ns({"intel", "cpp"});
+        ns.add_dynamic_element("host", "host name").add_static_element("load");
+        ns[2].set_value("host0");
+        Metric met(ns, "%", "cpu load");
+        met.add_tags({{"rack", "r1"}, {"dc", "eu"}});
+        met.set_timestamp(std::chrono::system_clock::time_point(std::chrono::seconds(1500000000)));
+        return met;
+    }
+
+    string serialize(const vector<Metric>& metrics) {
+        rpc::PubProcArg args;
+        for (const Metric& met : metrics) {
+            *args.add_metrics() = *met.get_rpc_metric_ptr();
+        }
+        (*args.mutable_config()->mutable_stringmap())["path"] = "/tmp/out";
+        return args.SerializeAsString();
+    }
+}  // namespace
+
+TEST(MetricViewTest, ReadsFieldsFromBuffer) {
+    Metric met = sample_metric();
+    met.set_data(-7);
+    const string wire = serialize({met});
+
+    MetricBatchView batch;
+    ASSERT_TRUE(batch.parse(wire));
+    ASSERT_EQ(1, batch.metrics().size());
+    const MetricView& view = batch.metrics()[0];
+
+    EXPECT_EQ(4, view.ns_size());
+    EXPECT_EQ("intel/cpp/host0/load", view.ns_string());
+    EXPECT_EQ("host", view.ns_element(2).name);
+    EXPECT_EQ("host name", view.ns_element(2).description);
+    EXPECT_TRUE(view.ns_element(2).is_dynamic());
+    EXPECT_FALSE(view.ns_element(3).is_dynamic());
+    EXPECT_EQ("%", view.unit());
+    EXPECT_EQ("cpu load", view.description());
+    EXPECT_EQ(met.timestamp(), view.timestamp());
+    EXPECT_EQ(2, view.tags_size());
+    EXPECT_EQ("r1", view.tag_value("rack"));
+    EXPECT_EQ("", view.tag_value("missing"));
+    EXPECT_EQ("/tmp/out", batch.config().stringmap().at("path"));
+
+    // Strings point into the buffer rather than into copies.
+    const char* unit = view.unit().data();
+    EXPECT_TRUE(unit >= wire.data() && unit < wire.data() + wire.size());
+}
+
+TEST(MetricViewTest, DecodesEveryDataType) {
+    vector<Metric> metrics(9, sample_metric());
+    metrics[0].set_data((int32_t)-3);
+    metrics[1].set_data((int64_t)-1 << 40);
+    metrics[2].set_data((uint32_t)4000000000u);
+    metrics[3].set_data((uint64_t)1 << 63);
+    metrics[4].set_data(1.5f);
+    metrics[5].set_data(-2.25);
+    metrics[6].set_data(true);
+    metrics[7].set_data(string("hop"));
+    const string wire = serialize(metrics);
+
+    MetricBatchView batch;
+    ASSERT_TRUE(batch.parse(wire));
+    const vector<MetricView>& views = batch.metrics();
+    ASSERT_EQ(9, views.size());
+    EXPECT_EQ(-3, views[0].get<int32_t>());
+    EXPECT_EQ((int64_t)-1 << 40, views[1].get<int64_t>());
+    EXPECT_EQ(4000000000u, views[2].get<uint32_t>());
+    EXPECT_EQ((uint64_t)1 << 63, views[3].get<uint64_t>());
+    EXPECT_EQ(1.5f, views[4].get<float>());
+    EXPECT_EQ(-2.25, views[5].get<double>());
+    EXPECT_TRUE(views[6].get<bool>());
+    EXPECT_EQ("hop", views[7].get<boost::string_ref>());
+    EXPECT_EQ(Metric::NotSet, views[8].data_type());
+
+    for (size_t i = 0; i < views.size(); i++) {
+        EXPECT_EQ(metrics[i].data_type(), views[i].data_type());
+        std::ostringstream expected, actual;
+        metrics[i].visit_data([&](const auto& v) { expected << v; });
+        views[i].visit_data([&](const auto& v) { actual << v; });
+        EXPECT_EQ(expected.str(), actual.str());
+    }
+
+    float f = 0;
+    EXPECT_FALSE(views[0].try_get(f));
+    EXPECT_TRUE(views[4].try_get(f));
+    EXPECT_THROW(views[0].get<double>(), Plugin::PluginException);
+}
+
+TEST(MetricViewTest, RejectsMalformedInput) {
+    string wire = serialize({sample_metric(), sample_metric()});
+    MetricBatchView batch;
+    EXPECT_FALSE(batch.parse(wire.substr(0, wire.size() - 3)));
+    EXPECT_EQ(0, batch.metrics().size());
+    EXPECT_FALSE(batch.parse("\x0a\x7f"));
+    EXPECT_TRUE(batch.parse(""));
+    EXPECT_TRUE(batch.parse(wire));
+    EXPECT_EQ(2, batch.metrics().size());
+}
+
+TEST(MetricViewTest, WireParsesBackIntoMetric) {
+    Metric met = sample_metric();
+    met.set_data(3.5);
+    const string wire = serialize({met});
+    MetricBatchView batch;
+    ASSERT_TRUE(batch.parse(wire));
+
+    rpc::Metric parsed;
+    const boost::string_ref bytes = batch.metrics()[0].wire();
+    ASSERT_TRUE(parsed.ParseFromArray(bytes.data(), bytes.size()));
+    // Map entries are serialized in no particular order, so the metrics are
+    // compared field by field rather than byte by byte.
+    Metric copy(&parsed);
+    EXPECT_EQ(met.ns_string(), copy.ns_string());
+    EXPECT_EQ(met.tags(), copy.tags());
+    EXPECT_EQ(met.timestamp(), copy.timestamp());
+    EXPECT_EQ(3.5, copy.get<double>());
+}
+
+TEST(MetricViewTest, DefaultPublishMetricViewsCallsPublishMetrics) {
+    MockPublisher mockee;
+    vector<string> published;
+    auto reporter = [&] (vector<Metric> &metrics, const Plugin::Config& config) {
+        for (const Metric& met : metrics) {
+            published.push_back(met.ns_string() + "=" + std::to_string(met.get<int64_t>()));
+        }
+        EXPECT_EQ("/tmp/out", config.get_string("path"));
+    };
+    EXPECT_CALL(mockee, publish_metrics(_, _)).WillOnce(Invoke(reporter));
+
+    Metric met = sample_metric();
+    met.set_data((int64_t)42);
+    const string wire = serialize({met});
+    MetricBatchView batch;
+    ASSERT_TRUE(batch.parse(wire));
+    Plugin::Config config(batch.config());
+    mockee.publish_metric_views(batch.metrics(), config);
+    EXPECT_EQ(vector<string>({"intel/cpp/host0/load=42"}), published);
+}
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+namespace {
+    class ViewPublisher : public MockPublisher {
+    public:
+        vector<string> published;
+
+        void publish_metric_views(const vector<MetricView>& metrics,
+                                  const Plugin::Config& config) override {
+            for (const MetricView& met : metrics) {
+                published.push_back(met.ns_string() + "@" + met.tag_value("dc").to_string());
+            }
+        }
+    };
+}  // namespace
+
+TEST(MetricViewTest, PublisherProxyPublishesViews) {
+    ViewPublisher mockee;
+    EXPECT_CALL(mockee, publish_metrics(_, _)).Times(0);
+    PublisherImpl publisher(&mockee);
+
+    const string wire = serialize({sample_metric(), sample_metric()});
+    Plugin::Proxy::RawPubProcArg args{grpc::Slice(wire)};
+    rpc::ErrReply resp;
+    grpc::Status status = publisher.Publish(nullptr, &args, &resp);
+    EXPECT_EQ(grpc::StatusCode::OK, status.error_code());
+    EXPECT_EQ(vector<string>(2, "intel/cpp/host0/load@eu"), mockee.published);
+
+    Plugin::Proxy::RawPubProcArg broken{grpc::Slice(wire.substr(0, 5))};
+    status = publisher.Publish(nullptr, &broken, &resp);
+    EXPECT_EQ(grpc::StatusCode::INVALID_ARGUMENT, status.error_code());
+}
+#endif
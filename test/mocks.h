@@ -18,6 +18,7 @@ limitations under the License.
 #include "snap/metric.h"
 #include "gmock/gmock.h"
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,40 @@ using Plugin::StringRule;
 using Plugin::Namespace;
 using Plugin::NamespaceElement;
 
+/**
+* RequestCopies checks that a proxy hands the plugin the metrics of the
+* request itself rather than copies of them. send_batches sends requests of
+* 1, 100 and 1000 metrics, and count, called from the mocked plugin method,
+* records how many of the metrics it was given are not from the request.
+*/
+struct RequestCopies {
+  std::set<const rpc::Metric*> requested;
+  std::vector<int> copied;
+
+  void count(const std::vector<Metric>& metrics) {
+    int copies = 0;
+    for (const Metric& met : metrics) {
+      if (!requested.count(met.get_rpc_metric_ptr())) copies++;
+    }
+    copied.push_back(copies);
+  }
+
+  template <class Arg, class Send>
+  void send_batches(const Metric& metric, Send send) {
+    for (int batch : {1, 100, 1000}) {
+      Arg args;
+      requested.clear();
+      for (int i = 0; i < batch; i++) {
+        *args.add_metrics() = *metric.get_rpc_metric_ptr();
+      }
+      for (const rpc::Metric& met : args.metrics()) {
+        requested.insert(&met);
+      }
+      EXPECT_TRUE(send(&args).ok());
+    }
+  }
+};
+
 class MockCollector : public Plugin::CollectorInterface {
 public:
   ConfigPolicy fake_policy{Plugin::StringRule{
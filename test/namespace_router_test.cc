@@ -0,0 +1,85 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/namespace_router.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::NamespaceRouter;
+using std::vector;
+
+TEST(NamespaceRouterTest, RoutesStaticAndDynamicNamespaces) {
+    NamespaceRouter router;
+    vector<std::string> calls;
+    router.add_route(Namespace({"intel", "cpp", "mock", "rando", "int64"}),
+                     [&] (vector<Metric*>& mets) { calls.push_back("int64:" + std::to_string(mets.size())); });
+    router.add_route(Namespace({"intel", "cpp", "mock", "rando", "string"}),
+                     [&] (vector<Metric*>& mets) { calls.push_back("string:" + std::to_string(mets.size())); });
+    router.add_route(Namespace({"intel", "cpp", "mock", "dynamic"}).add_dynamic_element("host").add_static_element("int64"),
+                     [&] (vector<Metric*>& mets) {
+                         for (Metric* met : mets) {
+                             calls.push_back("dynamic:" + met->ns_view()[4].value().to_string());
+                         }
+                     });
+    EXPECT_EQ(3, router.size());
+
+    vector<Metric> metrics;
+    metrics.emplace_back(Namespace({"intel", "cpp", "mock", "rando", "int64"}), "", "");
+    metrics.emplace_back(Namespace({"intel", "cpp", "mock", "dynamic", "host0", "int64"}), "", "");
+    metrics.emplace_back(Namespace({"intel", "cpp", "mock", "rando", "bool"}), "", "");
+    metrics.emplace_back(Namespace({"intel", "cpp", "mock", "rando", "int64"}), "", "");
+    metrics.emplace_back(Namespace({"intel", "cpp", "mock", "dynamic", "*", "int64"}), "", "");
+
+    vector<Metric*> unmatched = router.dispatch(metrics);
+
+    EXPECT_EQ(vector<std::string>({"int64:2", "dynamic:host0", "dynamic:*"}), calls);
+    ASSERT_EQ(1, unmatched.size());
+    EXPECT_EQ(&metrics[2], unmatched[0]);
+}
+
+TEST(NamespaceRouterTest, PrefersStaticElements) {
+    NamespaceRouter router;
+    router.add_route(Namespace({"intel"}).add_dynamic_element("host").add_static_element("load"), nullptr);
+    router.add_route(Namespace({"intel", "all", "load"}), nullptr);
+    router.add_route(Namespace({"intel", "all", "cpu"}), nullptr);
+
+    Metric all(Namespace({"intel", "all", "load"}), "", "");
+    Metric host(Namespace({"intel", "host0", "load"}), "", "");
+    Metric fallback(Namespace({"intel", "all", "mem"}), "", "");
+    Metric prefix(Namespace({"intel", "all"}), "", "");
+
+    EXPECT_EQ(1, router.route(all.ns_view()));
+    EXPECT_EQ(0, router.route(host.ns_view()));
+    EXPECT_EQ(-1, router.route(fallback.ns_view()));
+    EXPECT_EQ(-1, router.route(prefix.ns_view()));
+}
+
+TEST(NamespaceRouterTest, AddingSameRouteReplacesHandler) {
+    NamespaceRouter router;
+    int first = 0, second = 0;
+    router.add_route(Namespace({"intel", "load"}), [&] (vector<Metric*>& mets) { first++; });
+    router.add_route(Namespace({"intel", "load"}), [&] (vector<Metric*>& mets) { second++; });
+
+    vector<Metric> metrics;
+    metrics.emplace_back(Namespace({"intel", "load"}), "", "");
+    router.dispatch(metrics);
+
+    EXPECT_EQ(1, router.size());
+    EXPECT_EQ(0, first);
+    EXPECT_EQ(1, second);
+}
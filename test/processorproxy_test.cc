@@ -74,6 +74,22 @@ TEST(ProcessorProxySuccessTest, ProcessWorks) {
     EXPECT_EQ("/foo/bar", ns_str);
 }
 
+TEST(ProcessorProxySuccessTest, ProcessWrapsRequestInPlace) {
+    MockProcessor mockee;
+    RequestCopies copies;
+    ON_CALL(mockee, process_metrics(_, _))
+            .WillByDefault(Invoke([&] (vector<Metric> &metrics, const ::testing::Unused&) {
+                copies.count(metrics);
+            }));
+
+    ProcessorImpl processor(&mockee);
+    rpc::MetricsReply resp;
+    copies.send_batches<rpc::PubProcArg>(mockee.fake_metric, [&] (rpc::PubProcArg* args) {
+        return processor.Process(nullptr, args, &resp);
+    });
+    EXPECT_EQ(vector<int>({0, 0, 0}), copies.copied);
+}
+
 TEST(ProcessorProxySuccessTest, PingWorks) {
     MockProcessor mockee;
     rpc::ErrReply resp;
@@ -74,6 +74,22 @@ TEST(PublisherProxySuccessTest, PublishWorks) {
     EXPECT_EQ("/foo/bar", ns_str);
 }
 
+TEST(PublisherProxySuccessTest, PublishWrapsRequestInPlace) {
+    MockPublisher mockee;
+    RequestCopies copies;
+    ON_CALL(mockee, publish_metrics(_, _))
+            .WillByDefault(Invoke([&] (vector<Metric> &metrics, const ::testing::Unused&) {
+                copies.count(metrics);
+            }));
+
+    PublisherImpl publisher(&mockee);
+    rpc::ErrReply resp;
+    copies.send_batches<rpc::PubProcArg>(mockee.fake_metric, [&] (rpc::PubProcArg* args) {
+        return publisher.Publish(nullptr, args, &resp);
+    });
+    EXPECT_EQ(vector<int>({0, 0, 0}), copies.copied);
+}
+
 TEST(PublisherProxySuccessTest, PingWorks) {
     MockPublisher mockee;
     rpc::ErrReply resp;
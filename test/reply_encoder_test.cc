@@ -0,0 +1,217 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/metric_frame.h"
+#include "snap/metric_prototype.h"
+#include "snap/plugin.h"
+#include "snap/proxy/collector_proxy.h"
+#include "snap/reply_encoder.h"
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/util/message_differencer.h>
+
+using google::protobuf::util::MessageDifferencer;
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::EncodedReply;
+using Plugin::Metric;
+using Plugin::MetricFrame;
+using Plugin::MetricFrames;
+using Plugin::MetricPrototype;
+using Plugin::Namespace;
+using Plugin::ReplyEncoder;
+using Plugin::Proxy::CollectorImpl;
+using std::chrono::system_clock;
+
+static MetricPrototype disk_prototype() {
+    return MetricPrototype(Namespace({"intel", "disk"}).add_dynamic_element("disk", "disk id")
+                                                       .add_dynamic_element("op")
+                                                       .add_static_element("count"),
+                           "ops", "operations");
+}
+
+static void fill(MetricFrame<uint64_t>& frame, uint64_t base) {
+    system_clock::time_point ts = system_clock::from_time_t(1000000000) +
+                                  std::chrono::nanoseconds(base);
+    for (int disk = 0; disk < 3; disk++) {
+        for (const char* op : {"read", "write"}) {
+            frame.add({frame.encode(0, "sd" + std::to_string(disk)), frame.encode(1, op)},
+                      base + disk, ts);
+        }
+    }
+}
+
+TEST(ReplyEncoderTest, EncodesLikeTheSerializer) {
+    MetricFrame<uint64_t> frame(disk_prototype());
+    fill(frame, 300);
+    Metric met(Namespace({"intel", "load"}), "", "load average");
+    met.set_data(0.5);
+    met.add_tag({"host", "h0"});
+
+    rpc::MetricsReply expected;
+    *expected.add_metrics() = *met.get_rpc_metric_ptr();
+    frame.append_to(expected.mutable_metrics());
+
+    ReplyEncoder encoder;
+    std::string payload;
+    encoder.add(met, &payload);
+    encoder.add(frame, &payload);
+    rpc::MetricsReply encoded;
+    ASSERT_TRUE(encoded.ParseFromString(payload));
+    EXPECT_TRUE(MessageDifferencer::Equals(expected, encoded));
+    EXPECT_EQ("sd2", encoded.metrics(6).namespace_(2).value());
+    EXPECT_EQ("write", encoded.metrics(6).namespace_(3).value());
+    EXPECT_EQ(302, encoded.metrics(6).uint64_data());
+}
+
+TEST(ReplyEncoderTest, CachesStaticFieldsPerSeries) {
+    ReplyEncoder encoder;
+    MetricPrototype prototype = disk_prototype();
+    std::string payload;
+    {
+        MetricFrame<uint64_t> frame(prototype);
+        fill(frame, 1);
+        encoder.add(frame, &payload);
+    }
+    EXPECT_EQ(6, encoder.cached_segments());
+
+    // the next cycle hits the cache, even with a new frame.
+    MetricFrame<uint64_t> frame(prototype);
+    fill(frame, 2);
+    payload.clear();
+    encoder.add(frame, &payload);
+    EXPECT_EQ(6, encoder.cached_segments());
+    rpc::MetricsReply encoded;
+    ASSERT_TRUE(encoded.ParseFromString(payload));
+    ASSERT_EQ(6, encoded.metrics_size());
+    EXPECT_EQ(4, encoded.metrics(5).uint64_data());
+    EXPECT_EQ(2, encoded.metrics(5).timestamp().nsec());
+
+    encoder.clear_cache();
+    EXPECT_EQ(0, encoder.cached_segments());
+}
+
+TEST(ReplyEncoderTest, BoundsTheCache) {
+    ReplyEncoder encoder(4);
+    MetricFrame<uint64_t> frame(disk_prototype());
+    fill(frame, 1);
+    rpc::MetricsReply expected;
+    frame.append_to(expected.mutable_metrics());
+
+    std::string payload;
+    encoder.add(frame, &payload);
+    EXPECT_EQ(2, encoder.cached_segments());
+    rpc::MetricsReply encoded;
+    ASSERT_TRUE(encoded.ParseFromString(payload));
+    EXPECT_TRUE(MessageDifferencer::Equals(expected, encoded));
+}
+
+TEST(ReplyEncoderTest, EncodesFromManyThreads) {
+    ReplyEncoder encoder;
+    MetricFrame<uint64_t> frame(disk_prototype());
+    fill(frame, 1);
+    std::string expected;
+    ReplyEncoder().add(frame, &expected);
+
+    std::vector<std::string> payloads(4);
+    std::vector<std::thread> threads;
+    for (std::string& payload : payloads) {
+        threads.emplace_back([&encoder, &frame, &payload] {
+            for (int i = 0; i < 100; i++) {
+                payload.clear();
+                encoder.add(frame, &payload);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::string& payload : payloads) {
+        EXPECT_EQ(expected, payload);
+    }
+    EXPECT_EQ(6, encoder.cached_segments());
+}
+
+TEST(ReplyEncoderTest, EncodesError) {
+    std::string payload;
+    ReplyEncoder::add_error("nothing to look at", &payload);
+    rpc::MetricsReply encoded;
+    ASSERT_TRUE(encoded.ParseFromString(payload));
+    EXPECT_EQ("nothing to look at", encoded.error());
+}
+
+/**
+* DiskCollector returns one metric from collect_metrics and a frame of
+* per-disk counters from collect_frames.
+*/
+class DiskCollector final : public Plugin::CollectorInterface {
+public:
+    const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+    std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    std::vector<Metric> collect_metrics(std::vector<Metric> &metrics) {
+        std::vector<Metric> result;
+        result.emplace_back(Namespace({"intel", "load"}), "", "");
+        result.back().set_data((int64_t)1);
+        return result;
+    }
+
+    MetricFrames collect_frames(const std::vector<Metric> &metrics) {
+        std::unique_ptr<MetricFrame<uint64_t>> frame(
+            new MetricFrame<uint64_t>(disk_prototype()));
+        fill(*frame, 10);
+        MetricFrames frames;
+        frames.push_back(std::move(frame));
+        return frames;
+    }
+};
+
+TEST(ReplyEncoderTest, CollectorProxyEncodesReply) {
+    DiskCollector plugin;
+    CollectorImpl collector(&plugin);
+    rpc::MetricsArg args;
+    rpc::MetricsReply expected;
+    ASSERT_TRUE(collector.CollectMetrics(nullptr, &args, &expected).ok());
+
+    EncodedReply reply;
+    ASSERT_TRUE(collector.CollectMetrics(nullptr, &args, &reply).ok());
+    rpc::MetricsReply encoded;
+    ASSERT_TRUE(encoded.ParseFromString(reply.payload));
+    EXPECT_EQ(7, encoded.metrics_size());
+    EXPECT_TRUE(MessageDifferencer::Equals(expected, encoded));
+}
+
+#ifdef GRPC_CPP_VERSION_MAJOR
+TEST(ReplyEncoderTest, SerializationTraitsPassPayloadThrough) {
+    EncodedReply reply;
+    ReplyEncoder::add_error("hop", &reply.payload);
+    grpc::ByteBuffer buffer;
+    bool own_buffer = false;
+    ASSERT_TRUE(grpc::SerializationTraits<EncodedReply>::Serialize(
+        reply, &buffer, &own_buffer).ok());
+    EXPECT_EQ(reply.payload.size(), buffer.Length());
+
+    rpc::MetricsReply parsed;
+    ASSERT_TRUE(grpc::SerializationTraits<rpc::MetricsReply>::Deserialize(
+        &buffer, &parsed).ok());
+    EXPECT_EQ("hop", parsed.error());
+}
+#endif
@@ -0,0 +1,206 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/sampling_collector.h"
+#include <snap/proxy/collector_proxy.h>
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Plugin::Config;
+using Plugin::ConfigPolicy;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::PluginException;
+using Plugin::SamplingCollector;
+using Plugin::Proxy::CollectorImpl;
+using std::vector;
+
+string extract_ns(const Metric& metric);
+string extract_ns(const rpc::Metric& metric);
+
+namespace {
+    /**
+    * CountingCollector samples `width` cpus, each reading the number of
+    * the sample, and fails to sample while `failing` is set.
+    */
+    class CountingCollector final : public SamplingCollector {
+    public:
+        std::atomic<int> sampled{0};
+        std::atomic<bool> failing{false};
+
+        CountingCollector(int width, std::chrono::milliseconds interval) : width(width) {
+            register_sampler([this] { return sample(); }, interval);
+        }
+
+        ~CountingCollector() {
+            stop_sampling();
+        }
+
+        const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+        std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+
+    private:
+        int width;
+
+        vector<Metric> sample() {
+            if (failing) {
+                throw PluginException("cpu is gone");
+            }
+            const int64_t n = ++sampled;
+            vector<Metric> metrics;
+            for (int c = 0; c < width; c++) {
+                metrics.emplace_back(Namespace({"intel", "cpu", std::to_string(c), "user"}), "", "");
+                metrics.back().set_data(n);
+            }
+            metrics.emplace_back(Namespace({"intel", "load"}), "", "");
+            metrics.back().set_data(n);
+            return metrics;
+        }
+    };
+
+    class IdleCollector final : public SamplingCollector {
+    public:
+        const ConfigPolicy get_config_policy() { return ConfigPolicy(); }
+
+        std::vector<Metric> get_metric_types(Config cfg) { return {}; }
+    };
+
+    vector<Metric> request(vector<Namespace> namespaces) {
+        vector<Metric> metrics;
+        for (auto& ns : namespaces) {
+            metrics.emplace_back(ns, "", "");
+        }
+        return metrics;
+    }
+
+    template <class Done>
+    bool wait_for(Done done) {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > until) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+}  // namespace
+
+TEST(SamplingCollectorTest, ServesLatestSnapshot) {
+    CountingCollector plugin(2, std::chrono::milliseconds(5));
+    EXPECT_LE(1, plugin.samples());
+    EXPECT_LE(0, plugin.snapshot_age().count());
+
+    vector<Metric> requested = request({Namespace({"intel", "load"})});
+    vector<Metric> first = plugin.collect_metrics(requested);
+    ASSERT_EQ(1, first.size());
+    EXPECT_EQ("/intel/load", extract_ns(first[0]));
+    EXPECT_EQ(1, first[0].tags().count(SamplingCollector::age_tag));
+
+    ASSERT_TRUE(wait_for([&] { return plugin.samples() >= 3; }));
+    vector<Metric> later = plugin.collect_metrics(requested);
+    ASSERT_EQ(1, later.size());
+    EXPECT_LT(first[0].get_int64_data(), later[0].get_int64_data());
+}
+
+TEST(SamplingCollectorTest, ServesMatchingMetrics) {
+    CountingCollector plugin(3, std::chrono::hours(1));
+
+    vector<Metric> requested = request({
+        Namespace({"intel", "cpu"}).add_dynamic_element("cpu").add_static_element("user"),
+        Namespace({"intel", "cpu", "1", "user"}),
+        Namespace({"intel", "cpu", "1", "idle"}),
+    });
+    vector<Metric> result = plugin.collect_metrics(requested);
+    ASSERT_EQ(3, result.size());
+    EXPECT_EQ("/intel/cpu/0/user", extract_ns(result[0]));
+    EXPECT_EQ("/intel/cpu/1/user", extract_ns(result[1]));
+    EXPECT_EQ("/intel/cpu/2/user", extract_ns(result[2]));
+
+    requested = request({Namespace({"intel", "*"})});
+    result = plugin.collect_metrics(requested);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ("/intel/load", extract_ns(result[0]));
+}
+
+TEST(SamplingCollectorTest, KeepsSnapshotWhenSamplingFails) {
+    CountingCollector plugin(1, std::chrono::milliseconds(1));
+    plugin.failing = true;
+    const int sampled = plugin.sampled;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    EXPECT_EQ(sampled, plugin.sampled.load());
+    EXPECT_LE(std::chrono::milliseconds(20), plugin.snapshot_age());
+    vector<Metric> requested = request({Namespace({"intel", "load"})});
+    vector<Metric> result = plugin.collect_metrics(requested);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(sampled, result[0].get_int64_data());
+}
+
+TEST(SamplingCollectorTest, ReportsMissingSampler) {
+    IdleCollector plugin;
+    EXPECT_EQ(0, plugin.samples());
+    EXPECT_GT(0, plugin.snapshot_age().count());
+    vector<Metric> requested = request({Namespace({"intel", "load"})});
+    EXPECT_THROW(plugin.collect_metrics(requested), PluginException);
+}
+
+TEST(SamplingCollectorTest, ServesWholeSnapshots) {
+    CountingCollector plugin(64, std::chrono::milliseconds(0));
+    std::atomic<int> torn(0);
+    vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&] {
+            vector<Metric> requested = request({
+                Namespace({"intel", "cpu"}).add_dynamic_element("cpu").add_static_element("user")});
+            for (int i = 0; i < 200; i++) {
+                vector<Metric> result = plugin.collect_metrics(requested);
+                for (auto& met : result) {
+                    if (met.get_int64_data() != result[0].get_int64_data()) {
+                        torn++;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(0, torn.load());
+    EXPECT_LT(1, plugin.samples());
+}
+
+TEST(SamplingCollectorTest, CollectorProxyServesSnapshot) {
+    CountingCollector plugin(2, std::chrono::hours(1));
+    CollectorImpl collector(&plugin);
+
+    rpc::MetricsArg args;
+    Metric met(Namespace({"intel", "cpu", "1", "user"}), "", "");
+    *args.add_metrics() = *met.get_rpc_metric_ptr();
+    rpc::MetricsReply resp;
+    EXPECT_TRUE(collector.CollectMetrics(nullptr, &args, &resp).ok());
+
+    ASSERT_EQ(1, resp.metrics_size());
+    EXPECT_EQ("/intel/cpu/1/user", extract_ns(resp.metrics(0)));
+    EXPECT_EQ(1, resp.metrics(0).int64_data());
+    EXPECT_EQ(1, resp.metrics(0).tags().count(SamplingCollector::age_tag));
+    EXPECT_EQ(1, plugin.sampled.load());
+}
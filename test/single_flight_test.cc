@@ -0,0 +1,231 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/single_flight.h"
+#include <snap/plugin.h>
+#include <snap/proxy/collector_proxy.h>
+#include "gmock/gmock.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mocks.h"
+
+using Plugin::CollectContext;
+using Plugin::Config;
+using Plugin::Metric;
+using Plugin::Namespace;
+using Plugin::PluginException;
+using Plugin::SingleFlight;
+using Plugin::Proxy::CollectorImpl;
+using ::testing::_;
+using ::testing::Invoke;
+using std::vector;
+
+string extract_ns(const Metric& metric);
+string extract_ns(const rpc::Metric& metric);
+
+namespace {
+    /**
+    * wait_for spins until `done` returns true, for up to a few seconds.
+    */
+    template <class Done>
+    bool wait_for(Done done) {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > until) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+}  // namespace
+
+TEST(SingleFlightTest, KeysBySortedNamespacesAndConfig) {
+    vector<Metric> ab, ba;
+    ab.emplace_back(Namespace({"intel", "a"}), "", "");
+    ab.emplace_back(Namespace({"intel", "b"}), "", "");
+    ba.emplace_back(Namespace({"intel", "b"}), "", "");
+    ba.emplace_back(Namespace({"intel", "a"}), "", "");
+    EXPECT_EQ(SingleFlight::key_of(ab), SingleFlight::key_of(ba));
+
+    rpc::Metric configured = *ba[0].get_rpc_metric_ptr();
+    Config(*configured.mutable_config()).set_string("path", "/dev/sda");
+    ba[0] = Metric(&configured);
+    EXPECT_NE(SingleFlight::key_of(ab), SingleFlight::key_of(ba));
+}
+
+TEST(SingleFlightTest, CoalescesConcurrentCalls) {
+    SingleFlight flights;
+    std::atomic<int> collected(0);
+    auto collect = [&] {
+        collected++;
+        EXPECT_TRUE(wait_for([&] { return flights.coalesced() == 3; }));
+        SingleFlight::Result result;
+        result.metrics.emplace_back(Namespace({"intel", "load"}), "", "");
+        result.metrics[0].set_data((int64_t)7);
+        return result;
+    };
+
+    vector<vector<Metric>> results(4);
+    vector<std::thread> callers;
+    for (size_t i = 0; i < results.size(); i++) {
+        callers.emplace_back([&, i] { results[i] = flights.run("load", collect).metrics; });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+
+    EXPECT_EQ(1, collected.load());
+    for (auto& result : results) {
+        ASSERT_EQ(1, result.size());
+        EXPECT_EQ("/intel/load", extract_ns(result[0]));
+        EXPECT_EQ(7, result[0].get_int64_data());
+    }
+}
+
+TEST(SingleFlightTest, SharesErrors) {
+    SingleFlight flights;
+    std::atomic<int> collected(0);
+    auto collect = [&]() -> SingleFlight::Result {
+        collected++;
+        EXPECT_TRUE(wait_for([&] { return flights.coalesced() == 2; }));
+        throw PluginException("source is gone");
+    };
+
+    std::atomic<int> failed(0);
+    vector<std::thread> callers;
+    for (int i = 0; i < 3; i++) {
+        callers.emplace_back([&] {
+            try {
+                flights.run("load", collect);
+            } catch (PluginException& e) {
+                EXPECT_STREQ("source is gone", e.what());
+                failed++;
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    EXPECT_EQ(1, collected.load());
+    EXPECT_EQ(3, failed.load());
+}
+
+TEST(SingleFlightTest, CollectsCallsInTurn) {
+    SingleFlight flights;
+    int collected = 0;
+    auto collect = [&] {
+        collected++;
+        return SingleFlight::Result();
+    };
+    flights.run("load", collect);
+    flights.run("load", collect);
+    flights.run("idle", collect);
+    EXPECT_EQ(3, collected);
+    EXPECT_EQ(0, flights.coalesced());
+}
+
+TEST(SingleFlightTest, PassesOnCutShortResults) {
+    SingleFlight flights;
+    auto collect = [&] {
+        EXPECT_TRUE(wait_for([&] { return flights.coalesced() == 1; }));
+        SingleFlight::Result result;
+        result.metrics.emplace_back(Namespace({"intel", "load"}), "", "");
+        result.cut_short = true;
+        return result;
+    };
+
+    vector<SingleFlight::Result> results(2);
+    vector<std::thread> callers;
+    for (size_t i = 0; i < results.size(); i++) {
+        callers.emplace_back([&, i] { results[i] = flights.run("load", collect); });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    for (auto& result : results) {
+        EXPECT_TRUE(result.cut_short);
+        EXPECT_EQ(1, result.metrics.size());
+    }
+}
+
+TEST(SingleFlightTest, WaitersGiveUpAtTheirDeadline) {
+    SingleFlight flights;
+    std::atomic<bool> released(false);
+    std::thread leader([&] {
+        flights.run("load", [&] {
+            EXPECT_TRUE(wait_for([&] { return released.load(); }));
+            return SingleFlight::Result();
+        });
+    });
+    EXPECT_TRUE(wait_for([&] {
+        // joins the flight once it started, then times out.
+        SingleFlight::Result late = flights.run("load", [] { return SingleFlight::Result(); },
+            CollectContext(CollectContext::Clock::now() + std::chrono::milliseconds(20)));
+        return flights.coalesced() == 1 && late.cut_short && late.metrics.empty();
+    }));
+    released = true;
+    leader.join();
+}
+
+TEST(SingleFlightTest, CollectorProxyCoalescesRequests) {
+    MockCollector mockee;
+    Plugin::Meta meta(Plugin::Collector, "mock", 1);
+    meta.coalesce_collects = true;
+    CollectorImpl collector(&mockee, &meta);
+    ASSERT_NE(nullptr, collector.single_flight());
+
+    std::atomic<int> calls(0);
+    auto reporter = [&] (vector<Metric> &metrics) {
+        calls++;
+        EXPECT_TRUE(wait_for([&] { return collector.single_flight()->coalesced() == 2; }));
+        for (auto& met : metrics) {
+            met.set_data((int64_t)metrics.size());
+        }
+        return metrics;
+    };
+    ON_CALL(mockee, collect_metrics(_))
+            .WillByDefault(Invoke(reporter));
+
+    vector<rpc::MetricsReply> resps(3);
+    vector<std::thread> callers;
+    for (size_t i = 0; i < resps.size(); i++) {
+        callers.emplace_back([&, i] {
+            rpc::MetricsArg args;
+            vector<string> sources = {"sda", "sdb"};
+            if (i == 1) {
+                std::swap(sources[0], sources[1]);
+            }
+            for (auto& source : sources) {
+                Metric met(Namespace({"intel", "disk", source}), "", "");
+                *args.add_metrics() = *met.get_rpc_metric_ptr();
+            }
+            EXPECT_TRUE(collector.CollectMetrics(nullptr, &args, &resps[i]).ok());
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+
+    EXPECT_EQ(1, calls.load());
+    for (auto& resp : resps) {
+        ASSERT_EQ(2, resp.metrics_size());
+        EXPECT_EQ(2, resp.metrics(0).int64_data());
+        EXPECT_EQ(2, resp.metrics(1).int64_data());
+    }
+}
@@ -0,0 +1,103 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/metric.h"
+#include "snap/string_pool.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using Plugin::InternedString;
+using Plugin::Namespace;
+using Plugin::NamespaceElement;
+using Plugin::StringPool;
+
+TEST(StringPoolTest, InternSharesStorage) {
+    StringPool pool;
+    InternedString first = pool.intern("intel");
+    InternedString second = pool.intern(std::string("in") + "tel");
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.id(), second.id());
+    EXPECT_EQ(&first.str(), &second.str());
+    InternedString other = pool.intern("cpp");
+    EXPECT_NE(first, other);
+    EXPECT_EQ(2, pool.size());
+}
+
+TEST(StringPoolTest, EmptyStringIsNotStored) {
+    StringPool pool;
+    InternedString empty = pool.intern("");
+
+    EXPECT_EQ(InternedString(), empty);
+    EXPECT_EQ("", empty.str());
+    EXPECT_EQ(0, pool.size());
+}
+
+TEST(StringPoolTest, DropsStringsWithTheirLastHandle) {
+    StringPool pool;
+    {
+        InternedString first = pool.intern("12345");
+        InternedString copy = first;
+        EXPECT_EQ(1, pool.size());
+        first = InternedString();
+        EXPECT_EQ(1, pool.size());
+        EXPECT_EQ("12345", copy.str());
+    }
+    EXPECT_EQ(0, pool.size());
+
+    InternedString again = pool.intern("12345");
+    EXPECT_EQ("12345", again.str());
+    EXPECT_EQ(1, pool.size());
+}
+
+TEST(StringPoolTest, HandlesOutliveThePool) {
+    InternedString kept;
+    {
+        StringPool pool;
+        kept = pool.intern("rando");
+    }
+    EXPECT_EQ("rando", kept.str());
+}
+
+TEST(StringPoolTest, PlainHandlesAreNotShared) {
+    InternedString first("intel");
+    InternedString second(std::string("in") + "tel");
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first.id(), second.id());
+    EXPECT_NE(first, InternedString("cpp"));
+    EXPECT_EQ(InternedString(), InternedString(""));
+}
+
+TEST(StringPoolTest, NamespacesAreInternedOnRequest) {
+    Namespace first({"intel", "cpp", "mock"});
+    Namespace second({"intel", "cpp", "mock"});
+    first.add_dynamic_element("host", "name of the host");
+    second.add_dynamic_element("host", "name of the host");
+    EXPECT_NE(&first[0].get_value(), &second[0].get_value());
+
+    StringPool pool;
+    first.intern(pool);
+    second.intern(pool);
+    for (int i = 0; i < first.size(); i++) {
+        EXPECT_EQ(&first[i].get_value(), &second[i].get_value());
+        EXPECT_EQ(&first[i].get_name(), &second[i].get_name());
+        EXPECT_EQ(&first[i].get_description(), &second[i].get_description());
+    }
+    EXPECT_EQ(6, pool.size());
+    EXPECT_EQ("host", second[3].get_name());
+    EXPECT_TRUE(second[3].is_dynamic());
+    EXPECT_FALSE(second[0].is_dynamic());
+    EXPECT_EQ(first, second);
+}
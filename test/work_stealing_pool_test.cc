@@ -0,0 +1,93 @@
+/*
+http://www.apache.org/licenses/LICENSE-2.0.txt
+Copyright 2017 Intel Corporation
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "snap/work_stealing_pool.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using Plugin::WorkStealingPool;
+
+TEST(WorkStealingPoolTest, RunsEveryTask) {
+    WorkStealingPool pool(3);
+    EXPECT_EQ(3, pool.size());
+
+    std::vector<int> done(100, 0);
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < done.size(); i++) {
+        tasks.emplace_back([&done, i] { done[i]++; });
+    }
+    pool.run(tasks);
+    for (int count : done) {
+        EXPECT_EQ(1, count);
+    }
+    pool.run({});
+}
+
+TEST(WorkStealingPoolTest, RunsTasksInParallel) {
+    WorkStealingPool pool(3);
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    std::vector<std::function<void()>> tasks(4, [&] {
+        int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        running--;
+    });
+    pool.run(tasks);
+    // Up to three pool threads plus the calling one.
+    EXPECT_LE(2, peak.load());
+    EXPECT_GE(4, peak.load());
+}
+
+TEST(WorkStealingPoolTest, RethrowsOnceAllTasksReturned) {
+    WorkStealingPool pool(2);
+    std::atomic<int> done(0);
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 8; i++) {
+        tasks.emplace_back([&done, i] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            done++;
+            if (i == 2) {
+                throw std::runtime_error("task 2 failed");
+            }
+        });
+    }
+    EXPECT_THROW(pool.run(tasks), std::runtime_error);
+    EXPECT_EQ(8, done.load());
+}
+
+TEST(WorkStealingPoolTest, TakesBatchesFromSeveralThreads) {
+    WorkStealingPool pool(2);
+    std::atomic<int> done(0);
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 4; c++) {
+        callers.emplace_back([&pool, &done] {
+            for (int round = 0; round < 50; round++) {
+                std::vector<std::function<void()>> tasks(5, [&done] { done++; });
+                pool.run(tasks);
+            }
+        });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+    EXPECT_EQ(4 * 50 * 5, done.load());
+}